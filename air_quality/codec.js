@@ -1,3 +1,66 @@
+// Loop profile (fPort 9, firmware built with -DLOOP_PROFILER): loops per
+// sample, profiler overhead (0.01 %), then 6 bytes per stage: id, count,
+// p50 and p95 log2 buckets as two nibbles, max (16 us units)
+const PROFILE_STAGES = [
+    "loop", "sensors", "hm330x", "gas", "modem", "console", "uplink"
+];
+
+function profileBucketLimit(bucket) {
+    // Exclusive upper bound in us; the last bucket is open-ended
+    return bucket < 15 ? Math.pow(2, bucket + 4) : null;
+}
+
+function decodeProfile(bytes) {
+    const profile = {
+        sampleRate: bytes[0],
+        overheadPercent: ((bytes[1] << 8) | bytes[2]) / 100,
+        stages: {}
+    };
+    for (let i = 3; i + 6 <= bytes.length; i += 6) {
+        const name = PROFILE_STAGES[bytes[i]] || "stage" + bytes[i];
+        profile.stages[name] = {
+            count: (bytes[i + 1] << 8) | bytes[i + 2],
+            p50BelowMicros: profileBucketLimit(bytes[i + 3] >> 4),
+            p95BelowMicros: profileBucketLimit(bytes[i + 3] & 0x0f),
+            maxMicros: ((bytes[i + 4] << 8) | bytes[i + 5]) * 16
+        };
+    }
+    return profile;
+}
+
+// Memory report (fPort 10): heap max, stack max, minimum and current free
+// RAM (2 bytes each, in bytes), flags (bit 0: stack and heap have met)
+function decodeMemory(bytes) {
+    return {
+        heapMaxBytes: (bytes[0] << 8) | bytes[1],
+        stackMaxBytes: (bytes[2] << 8) | bytes[3],
+        freeMinBytes: (bytes[4] << 8) | bytes[5],
+        freeNowBytes: (bytes[6] << 8) | bytes[7],
+        collision: Boolean(bytes[8] & 0x01)
+    };
+}
+
+// Window summary (fPort 4, site setting summary=1): HM330X frames since the
+// previous uplink, then for PM2.5 and PM10 the min and max (μg/m³) and the
+// mean and standard deviation (0.1 μg/m³), the gas sensor value and the
+// alert state, 2 bytes each but the last
+function decodeSummary(bytes) {
+    const summary = { samples: (bytes[0] << 8) | bytes[1] };
+    ["pm25", "pm10"].forEach((name, i) => {
+        const index = 2 + i * 8;
+        summary[name] = {
+            min: (bytes[index] << 8) | bytes[index + 1],
+            max: (bytes[index + 2] << 8) | bytes[index + 3],
+            mean: readTenths(bytes, index + 4),
+            stdDev: readTenths(bytes, index + 6)
+        };
+    });
+    summary.aqiValue = (bytes[18] << 8) | bytes[19];
+    summary.alertState = bytes[20];
+    summary.airQualityStatus = getAirQualityStatus(bytes[20]);
+    return summary;
+}
+
 // TTN V3 / ChirpStack V4 compatible decoder
 function decodeUplink(input) {
     const { bytes, fPort: port } = input;
@@ -8,6 +71,33 @@ function decodeUplink(input) {
         errors: []
     };
 
+    if (port === 10) {
+        if (bytes.length < 9) {
+            response.errors.push("Not enough bytes in payload");
+        } else {
+            response.data = decodeMemory(bytes);
+        }
+        return response;
+    }
+
+    if (port === 4) {
+        if (bytes.length < 21) {
+            response.errors.push("Not enough bytes in payload");
+        } else {
+            response.data = decodeSummary(bytes);
+        }
+        return response;
+    }
+
+    if (port === 9) {
+        if (bytes.length < 3) {
+            response.errors.push("Not enough bytes in payload");
+        } else {
+            response.data = decodeProfile(bytes);
+        }
+        return response;
+    }
+
     if (bytes.length < 7) {
         response.errors.push("Not enough bytes in payload");
         return response;
@@ -29,6 +119,24 @@ function decodeUplink(input) {
             alertAQI: Boolean(alertState & 4),
             airQualityStatus: getAirQualityStatus(alertState)
         };
+
+        // Aggregates computed on the node, in 0.1 μg/m³ (0xFFFF = not enough data)
+        if (bytes.length >= 16) {
+            const nowCastPM25 = readTenths(bytes, 7);
+            const nowCastPM10 = readTenths(bytes, 9);
+            const dayMeanPM25 = readTenths(bytes, 11);
+            const dayMeanPM10 = readTenths(bytes, 13);
+            const aqiCategory = bytes[15];
+
+            Object.assign(response.data, {
+                nowCastPM25,
+                nowCastPM10,
+                dayMeanPM25,
+                dayMeanPM10,
+                aqiCategory: aqiCategory === 0xFF ? null : aqiCategory,
+                aqiCategoryName: AQI_CATEGORIES[aqiCategory] || "Unknown"
+            });
+        }
     } catch (error) {
         response.errors.push(`Decoding failed: ${error.message}`);
     }
@@ -36,6 +144,20 @@ function decodeUplink(input) {
     return response;
 }
 
+const AQI_CATEGORIES = [
+    "Good",
+    "Moderate",
+    "Unhealthy for Sensitive Groups",
+    "Unhealthy",
+    "Very Unhealthy",
+    "Hazardous"
+];
+
+function readTenths(bytes, index) {
+    const raw = (bytes[index] << 8) | bytes[index + 1];
+    return raw === 0xFFFF ? null : raw / 10;
+}
+
 function getAirQualityStatus(alertState) {
     if (alertState === 0) return "Good";
     if (alertState & 4) return "Very Poor";
@@ -0,0 +1,91 @@
+#include "AdaptiveSampler.h"
+
+AdaptiveSampler::AdaptiveSampler(const float *steps, uint8_t channelCount,
+                                 unsigned long minInterval,
+                                 unsigned long maxInterval) {
+  this->steps = steps;
+  this->channelCount = channelCount > SAMPLER_MAX_CHANNELS
+                           ? SAMPLER_MAX_CHANNELS
+                           : channelCount;
+  configure(minInterval, maxInterval);
+  start(0);
+}
+
+void AdaptiveSampler::configure(unsigned long minInterval,
+                                unsigned long maxInterval) {
+  this->minInterval = minInterval;
+  this->maxInterval = maxInterval < minInterval ? minInterval : maxInterval;
+  interval = this->minInterval;
+}
+
+void AdaptiveSampler::start(unsigned long now) {
+  startTime = now;
+  lastSample = now - minInterval;
+  sampleCount = 0;
+  interval = minInterval;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    lastValues[i] = NAN;
+    rates[i] = 0;
+  }
+}
+
+bool AdaptiveSampler::isDue(unsigned long now) {
+  return now - lastSample >= interval;
+}
+
+unsigned long AdaptiveSampler::getTimeUntilDue(unsigned long now) {
+  unsigned long elapsed = now - lastSample;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+void AdaptiveSampler::sampled(const float *values, unsigned long now) {
+  unsigned long elapsed = now - lastSample;
+  lastSample = now;
+  sampleCount++;
+  if (elapsed == 0) {
+    elapsed = 1;
+  }
+
+  // Until every channel has a reference value, nothing is known of its rate
+  bool primed = true;
+  float fastest = 0;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    // A channel without a reading keeps its rate for this interval
+    if (isnan(values[i])) {
+      primed &= !isnan(lastValues[i]);
+    } else if (isnan(lastValues[i])) {
+      primed = false;
+      lastValues[i] = values[i];
+    } else {
+      float rate = fabs(values[i] - lastValues[i]) / steps[i] / elapsed;
+      if (rate > rates[i]) {
+        rates[i] = rate;
+      } else {
+        rates[i] += (rate - rates[i]) * SAMPLER_DECAY;
+      }
+      lastValues[i] = values[i];
+    }
+    if (rates[i] > fastest) {
+      fastest = rates[i];
+    }
+  }
+
+  // One step at the fastest rate, within the floor and ceiling
+  if (!primed || fastest * minInterval >= 1) {
+    interval = minInterval;
+  } else if (fastest * maxInterval <= 1) {
+    interval = maxInterval;
+  } else {
+    interval = (unsigned long)(1 / fastest);
+  }
+}
+
+float AdaptiveSampler::getDutyRatio(unsigned long now) {
+  unsigned long elapsed = now - startTime;
+  if (elapsed < minInterval) {
+    return 1.0;
+  }
+
+  float ratio = (float)sampleCount * minInterval / elapsed;
+  return ratio > 1.0 ? 1.0 : ratio;
+}
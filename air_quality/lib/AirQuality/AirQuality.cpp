@@ -1,26 +1,89 @@
 #include "AirQuality.h"
+#include "LoopProfiler.h"
+#include "SensorTrace.h"
 
-AirQuality::AirQuality(byte aqiPin)
+constexpr AlertRule AIR_QUALITY_ALERT_RULES[] = {
+    {FIELD_PM25, ALERT_ABOVE, ALERT_VALUE(PM25_THRESHOLD), ALERT_VALUE(PM25_HYSTERESIS),
+     ALERT_HOLD_TIME, ALERT_PM25},
+    {FIELD_PM10, ALERT_ABOVE, ALERT_VALUE(PM10_THRESHOLD), ALERT_VALUE(PM10_HYSTERESIS),
+     ALERT_HOLD_TIME, ALERT_PM10},
+    {FIELD_AQI_QUALITY, ALERT_BELOW, ALERT_VALUE(AQI_ALERT_BELOW), ALERT_VALUE(0),
+     ALERT_HOLD_TIME, ALERT_AQI},
+};
+
+constexpr float PARTICLE_SAMPLE_STEPS[] = {PM25_SAMPLE_STEP, PM10_SAMPLE_STEP};
+
+static uint8_t putUint16(uint8_t *payload, uint16_t value)
+{
+    payload[0] = value >> 8;
+    payload[1] = value & 0xFF;
+    return 2;
+}
+
+AirQuality::AirQuality(byte aqiPin, byte particleSetPin)
+    : particleSampler(PARTICLE_SAMPLE_STEPS, 2, PARTICLE_MIN_CYCLE, PARTICLE_MAX_CYCLE),
+      burst1_0(PM_OUTLIER_SCALE, PM_OUTLIER_MIN),
+      burst2_5(PM_OUTLIER_SCALE, PM_OUTLIER_MIN),
+      burst10(PM_OUTLIER_SCALE, PM_OUTLIER_MIN),
+      alerts(AIR_QUALITY_ALERT_RULES,
+             sizeof(AIR_QUALITY_ALERT_RULES) / sizeof(AIR_QUALITY_ALERT_RULES[0]))
 {
-    aqiSensor = new AirQualitySensor(aqiPin);
+    this->aqiPin = aqiPin;
+    this->particleSetPin = particleSetPin;
+    dutyCycling = true;
+    outlierCount = 0;
     pm1_0 = 0;
     pm2_5 = 0;
     pm10 = 0;
     aqiValue = 0;
     aqiQuality = 0;
     alertState = ALERT_NONE;
+    particleFrameValid = false;
+    frameErrors = 0;
 }
 
 bool AirQuality::begin()
 {
+    pinMode(particleSetPin, OUTPUT);
+    setParticleSensorAwake(true);
+
     bool particleStatus = initParticleSensor();
-    bool aqiStatus = initAqiSensor(A0);
+    bool aqiStatus = initAqiSensor(aqiPin);
 
     delay(2000);
 
+    particleScheduler.start(millis());
+
     return particleStatus && aqiStatus;
 }
 
+void AirQuality::setDutyCycling(bool enabled)
+{
+    dutyCycling = enabled;
+    resetBurst();
+    setParticleSensorAwake(!enabled);
+    particleScheduler.start(millis());
+}
+
+void AirQuality::setParticleCycleLimits(unsigned long minCycle, unsigned long maxCycle)
+{
+    particleSampler.configure(minCycle, maxCycle);
+    particleScheduler.setCycleTime(particleSampler.getInterval());
+}
+
+void AirQuality::resetBurst()
+{
+    burst1_0.reset();
+    burst2_5.reset();
+    burst10.reset();
+}
+
+void AirQuality::setParticleSensorAwake(bool awake)
+{
+    // HM3301 SET pin: high runs the fan and laser, low puts it to sleep
+    digitalWrite(particleSetPin, awake ? HIGH : LOW);
+}
+
 bool AirQuality::initParticleSensor()
 {
     bool status = particleSensor.init() == 0;
@@ -37,7 +100,7 @@ bool AirQuality::initParticleSensor()
 
 bool AirQuality::initAqiSensor(byte pin)
 {
-    bool status = aqiSensor->init();
+    bool status = gasAdc.begin(pin);
     if (status)
     {
         Serial.println(F("Air Quality Sensor initialized successfully"));
@@ -51,39 +114,186 @@ bool AirQuality::initAqiSensor(byte pin)
 
 bool AirQuality::readSensors()
 {
+    PROFILE_SCOPE(PROFILE_STAGE_SENSORS);
     bool success = true;
 
-    if (particleSensor.read_sensor_value(particleBuffer, 29))
+    if (dutyCycling)
     {
-        Serial.println(F("HM330X read failed!"));
-        success = false;
+        unsigned long now = millis();
+        switch (particleScheduler.update(now))
+        {
+        case PARTICLE_WAKE:
+            setParticleSensorAwake(true);
+            break;
+        case PARTICLE_READ:
+            success = readParticleFrame();
+            break;
+        case PARTICLE_READ_LAST:
+            success = readParticleFrame();
+            publishParticleBurst();
+            setParticleSensorAwake(false);
+
+            Serial.print(F("HM330X duty: "));
+            Serial.print(particleScheduler.getDutyRatio(now) * 100);
+            Serial.print(F("%, ~"));
+            Serial.print(particleScheduler.estimateEnergyPerSample(now));
+            Serial.println(F(" mJ/sample"));
+            break;
+        default:
+            break;
+        }
     }
     else
     {
-        pm1_0 = (uint16_t)particleBuffer[4 * 2] << 8 | particleBuffer[4 * 2 + 1];
-        pm2_5 = (uint16_t)particleBuffer[5 * 2] << 8 | particleBuffer[5 * 2 + 1];
-        pm10 = (uint16_t)particleBuffer[6 * 2] << 8 | particleBuffer[6 * 2 + 1];
+        success = readParticleFrame();
+        publishParticleBurst();
     }
 
-    aqiValue = aqiSensor->getValue();
-    aqiQuality = aqiSensor->slope();
+    gasAdc.update(millis());
+    aqiValue = gasAdc.getValue();
+    aqiQuality = gasAdc.slope();
 
     checkThresholds();
 
     return success;
 }
 
+bool AirQuality::readParticleFrame()
+{
+    PROFILE_EVENT(PROFILE_STAGE_HM330X);
+    const HM330XFrame *frame = HM330XFrame::view(particleBuffer);
+
+    particleFrameValid = false;
+    if (particleSensor.read_sensor_value(particleBuffer, HM330X_FRAME_SIZE))
+    {
+        Serial.println(F("HM330X read failed!"));
+    }
+    else
+    {
+        // Traced before validation so replays see the corrupt frames too
+        SENSOR_TRACE_BEGIN("hm330x");
+        SENSOR_TRACE_HEX(particleBuffer, HM330X_FRAME_SIZE);
+        SENSOR_TRACE_END();
+
+        particleFrameValid = frame->isValid();
+        if (!particleFrameValid)
+        {
+            Serial.println(F("HM330X frame checksum mismatch!"));
+        }
+    }
+
+    if (!particleFrameValid)
+    {
+        frameErrors++;
+        return false;
+    }
+
+    burst1_0.add(frame->pm1_0Standard);
+    burst2_5.add(frame->pm2_5Standard);
+    burst10.add(frame->pm10Standard);
+    return true;
+}
+
+void AirQuality::publishParticleBurst()
+{
+    // A burst without a single valid frame keeps the previous values
+    if (burst2_5.getCount() == 0)
+        return;
+
+    pm1_0 = burstMean(burst1_0, nullptr);
+    pm2_5 = burstMean(burst2_5, &pm25Window);
+    pm10 = burstMean(burst10, &pm10Window);
+    pmAggregator.addSample(pm2_5, pm10, millis());
+
+    // Shorter cycles while PM moves, longer ones while it holds steady
+    float values[] = {(float)pm2_5, (float)pm10};
+    particleSampler.sampled(values, millis());
+    particleScheduler.setCycleTime(particleSampler.getInterval());
+
+    resetBurst();
+}
+
+uint16_t AirQuality::burstMean(BurstFilter &burst, WindowStats *window)
+{
+    // Judged once the whole burst is in, so an outlier is caught even among
+    // its first frames
+    uint8_t count = burst.getCount();
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint16_t value = burst.get(i);
+        if (burst.isOutlier(value))
+        {
+            value = burst.median();
+            outlierCount++;
+        }
+        sum += value;
+        if (window)
+            window->add(value);
+    }
+    return (sum + count / 2) / count;
+}
+
 void AirQuality::checkThresholds()
 {
-    alertState = ALERT_NONE;
+    AlertValue values[AIR_QUALITY_FIELD_COUNT];
+    values[FIELD_PM25] = ALERT_INT(pm2_5);
+    values[FIELD_PM10] = ALERT_INT(pm10);
+    values[FIELD_AQI_QUALITY] = ALERT_INT(aqiQuality);
+
+    alertState = alerts.evaluate(values, millis());
+}
 
-    if (pm2_5 > PM25_THRESHOLD)
-        alertState |= ALERT_PM25;
+uint8_t AirQuality::buildSummary(uint8_t *payload)
+{
+    WindowStats *windows[] = {&pm25Window, &pm10Window};
+    uint16_t current[] = {pm2_5, pm10};
 
-    if (pm10 > PM10_THRESHOLD)
-        alertState |= ALERT_PM10;
+    uint8_t length = putUint16(payload, pm25Window.getCount());
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        WindowStats &stats = *windows[i];
+        if (stats.getCount() == 0)
+        {
+            length += putUint16(payload + length, current[i]);
+            length += putUint16(payload + length, current[i]);
+            length += putUint16(payload + length, current[i] * 10);
+            length += putUint16(payload + length, 0);
+        }
+        else
+        {
+            length += putUint16(payload + length, stats.getMin());
+            length += putUint16(payload + length, stats.getMax());
+            length += putUint16(payload + length, round(stats.getMean() * 10));
+            length += putUint16(payload + length, round(stats.getStdDev() * 10));
+        }
+    }
+    length += putUint16(payload + length, aqiValue);
+    payload[length++] = alertState;
+    return length;
+}
 
-    if (aqiQuality == AirQualitySensor::HIGH_POLLUTION ||
-        aqiQuality == AirQualitySensor::FORCE_SIGNAL)
-        alertState |= ALERT_AQI;
+void AirQuality::resetWindow()
+{
+    pm25Window.reset();
+    pm10Window.reset();
+}
+
+void AirQuality::saveSnapshot(AirQualitySnapshot &snapshot)
+{
+    pmAggregator.saveSnapshot(snapshot.pm, millis());
+    snapshot.pm1_0 = pm1_0;
+    snapshot.pm2_5 = pm2_5;
+    snapshot.pm10 = pm10;
+    snapshot.alertsRaised = alerts.getRaised();
+}
+
+void AirQuality::restoreSnapshot(const AirQualitySnapshot &snapshot)
+{
+    pmAggregator.restoreSnapshot(snapshot.pm, millis());
+    pm1_0 = snapshot.pm1_0;
+    pm2_5 = snapshot.pm2_5;
+    pm10 = snapshot.pm10;
+    alerts.restoreRaised(snapshot.alertsRaised);
+    alertState = alerts.getAlertState();
 }
@@ -2,49 +2,170 @@
 #define AIR_QUALITY_H
 
 #include <Arduino.h>
+#include "AdaptiveSampler.h"
+#include "AlertEngine.h"
+#include "GasSensorAdc.h"
+#include "HM330XFrame.h"
+#include "OutlierFilter.h"
+#include "ParticleScheduler.h"
+#include "PMAggregator.h"
 #include "Seeed_HM330X.h"
 #include "Air_Quality_Sensor.h"
+#include "WindowStats.h"
 
 #define PM25_THRESHOLD 25 // μg/m3 (WHO recommandation)
 #define PM10_THRESHOLD 50 // μg/m3 (WHO recommandation)
 #define AQI_HIGH_THRESHOLD AirQualitySensor::HIGH_POLLUTION
+// Slope categories run from FORCE_SIGNAL (0) to FRESH_AIR (3); anything below
+// LOW_POLLUTION (2) is HIGH_POLLUTION or worse.
+#define AQI_ALERT_BELOW 2
+
+#define PM25_HYSTERESIS 3
+#define PM10_HYSTERESIS 5
+#define ALERT_HOLD_TIME 10000 // ms
+
+// Adaptive particle cycle: defaults of its floor and ceiling, and the change
+// of each PM reading worth a shorter cycle
+#define PARTICLE_MIN_CYCLE 30000  // ms, twice the warm-up and burst
+#define PARTICLE_MAX_CYCLE 300000 // ms
+#define PM25_SAMPLE_STEP 2        // μg/m3
+#define PM10_SAMPLE_STEP 3        // μg/m3
+
+// A burst's PM values further from its median than PM_OUTLIER_SCALE median
+// absolute deviations, and than PM_OUTLIER_MIN, count as the median in its
+// mean. Each burst is judged on its own frames, since PM may have moved a lot
+// over the minutes between two bursts; the continuous mode, one frame per
+// value, is not filtered.
+#define PM_OUTLIER_SCALE 4 // MADs, about 2.7 standard deviations
+#define PM_OUTLIER_MIN 10  // μg/m3
+
+typedef HampelFilter<uint16_t, PARTICLE_BURST_SAMPLES> BurstFilter;
+
+// Summary frame: window frame count, then for PM2.5 and PM10 the min and max
+// (μg/m3) and the mean and standard deviation (0.1 μg/m3), 2 bytes each, then
+// the gas sensor value and the alert state
+#define AIR_QUALITY_SUMMARY_SIZE 21
 
 #define ALERT_NONE 0
 #define ALERT_PM25 1
 #define ALERT_PM10 2
 #define ALERT_AQI 4
 
+enum AirQualityField : uint8_t
+{
+    FIELD_PM25,
+    FIELD_PM10,
+    FIELD_AQI_QUALITY,
+    AIR_QUALITY_FIELD_COUNT
+};
+
+// Warm-restart state: the PM history, the last burst, held until the next
+// one as between any two bursts, and the alerts raised
+struct AirQualitySnapshot
+{
+    PMSnapshot pm;
+    uint16_t pm1_0;
+    uint16_t pm2_5;
+    uint16_t pm10;
+    uint8_t alertsRaised;
+};
+
 class AirQuality
 {
 private:
     HM330X particleSensor;
-    AirQualitySensor *aqiSensor;
+    GasSensorAdc gasAdc;
+    byte aqiPin;
 
-    uint8_t particleBuffer[30];
+    byte particleSetPin;
+    bool dutyCycling;
+    ParticleScheduler particleScheduler;
+    AdaptiveSampler particleSampler; // sets the scheduler's cycle length
+    // Valid frames of the current burst
+    BurstFilter burst1_0;
+    BurstFilter burst2_5;
+    BurstFilter burst10;
+    uint16_t outlierCount;
+
+    uint8_t particleBuffer[HM330X_FRAME_SIZE];
+    bool particleFrameValid;
+    uint16_t frameErrors;
+    PMAggregator pmAggregator;
+    // Published frames since the last uplink, outliers replaced
+    WindowStats pm25Window;
+    WindowStats pm10Window;
 
     uint16_t pm1_0;
     uint16_t pm2_5;
     uint16_t pm10;
-    byte aqiValue;
+    uint16_t aqiValue;
     char aqiQuality;
 
+    AlertEngine alerts;
     uint8_t alertState;
 
     bool initParticleSensor();
     bool initAqiSensor(byte pin);
+    bool readParticleFrame();
+    void publishParticleBurst();
+    void setParticleSensorAwake(bool awake);
+    void resetBurst();
+    uint16_t burstMean(BurstFilter &burst, WindowStats *window);
     void checkThresholds();
 
 public:
-    AirQuality(byte aqiPin);
+    AirQuality(byte aqiPin, byte particleSetPin);
     bool begin();
     bool readSensors();
+    // Replaces the compile-time alert threshold of a field
+    void setThreshold(AirQualityField field, float threshold)
+    {
+        alerts.setThreshold(field, ALERT_VALUE(threshold));
+    }
+
+    // Fills payload with AIR_QUALITY_SUMMARY_SIZE bytes on the current
+    // window; an empty one, as between two bursts, reports the last burst
+    // with a count of 0
+    uint8_t buildSummary(uint8_t *payload);
+    // Starts a new window, at each uplink
+    void resetWindow();
+
+    void saveSnapshot(AirQualitySnapshot &snapshot);
+    void restoreSnapshot(const AirQualitySnapshot &snapshot);
 
     uint16_t getPM1_0() { return pm1_0; }
     uint16_t getPM2_5() { return pm2_5; }
     uint16_t getPM10() { return pm10; }
-    byte getAqiValue() { return aqiValue; }
+    uint16_t getAqiValue() { return aqiValue; }
     char getAqiQuality() { return aqiQuality; }
     uint8_t getAlertState() { return alertState; }
+    uint16_t getFrameErrors() { return frameErrors; }
+    // PM values of burst frames counted as the burst median since boot
+    uint16_t getOutlierCount() { return outlierCount; }
+
+    // Duty cycling sleeps the HM330X between bursts; off keeps it always on
+    // and publishes every read, as before.
+    void setDutyCycling(bool enabled);
+    ParticleScheduler &getParticleScheduler() { return particleScheduler; }
+    AdaptiveSampler &getParticleSampler() { return particleSampler; }
+    // Floor and ceiling of the duty cycle's length; it restarts at the floor
+    void setParticleCycleLimits(unsigned long minCycle, unsigned long maxCycle);
+
+    // Sleeps the CPU during gas sensor conversions for a cleaner ADC reading
+    void setAdcNoiseReduction(bool enabled) { gasAdc.setNoiseReduction(enabled); }
+
+    // Aggregates in 0.1 ug/m3, PM_NO_DATA until enough hours are collected
+    uint16_t getNowCastPM2_5() { return pmAggregator.getNowCast(PM_CHANNEL_2_5); }
+    uint16_t getNowCastPM10() { return pmAggregator.getNowCast(PM_CHANNEL_10); }
+    uint16_t getDayMeanPM2_5() { return pmAggregator.getDayMean(PM_CHANNEL_2_5); }
+    uint16_t getDayMeanPM10() { return pmAggregator.getDayMean(PM_CHANNEL_10); }
+    uint8_t getAqiCategory() { return pmAggregator.getAqiCategory(); }
+
+    // Last checksum-valid frame, or nullptr if the latest read failed.
+    const HM330XFrame *getParticleFrame()
+    {
+        return particleFrameValid ? HM330XFrame::view(particleBuffer) : nullptr;
+    }
 };
 
 #endif // AIR_QUALITY_H
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef ALERT_ENGINE_H
+#define ALERT_ENGINE_H
+
+#include <Arduino.h>
+
+#define ALERT_MAX_RULES 8
+
+// With FIXED_POINT, values and thresholds are compared as Q16.16 numbers;
+// ALERT_VALUE() turns a rule's constant into either form at compile time, and
+// ALERT_INT() a whole reading without going through float
+#ifdef FIXED_POINT
+#include <FixedPoint.h>
+typedef Q16_16 AlertValue;
+#define ALERT_VALUE(x) Q16_16::fromFloat(x)
+#define ALERT_INT(x) Q16_16::fromInt(x)
+#else
+typedef float AlertValue;
+#define ALERT_VALUE(x) (x)
+#define ALERT_INT(x) (float)(x)
+#endif
+
+enum AlertCompare : uint8_t { ALERT_ABOVE, ALERT_BELOW };
+
+// One row of a node's alert table. The rule raises once the value has been
+// past `threshold` for `holdTime` ms, and clears once it has been back past
+// `threshold` by more than `hysteresis` for `holdTime` ms.
+struct AlertRule {
+  uint8_t field;        // index into the values given to evaluate()
+  AlertCompare compare; // direction in which the value raises the alert
+  AlertValue threshold;
+  AlertValue hysteresis;
+  uint16_t holdTime; // ms
+  uint8_t mask;      // bits set in the alert state while raised
+};
+
+class AlertEngine {
+private:
+  const AlertRule *rules;
+  uint8_t ruleCount;
+  // Copied from the rules, so a site setting can override them
+  AlertValue thresholds[ALERT_MAX_RULES];
+
+  uint8_t alertState;
+  uint8_t raised;  // bit i set while rule i is raised
+  uint8_t pending; // bit i set while rule i waits out its hold time
+  unsigned long pendingSince[ALERT_MAX_RULES];
+
+public:
+  AlertEngine(const AlertRule *rules, uint8_t ruleCount);
+  uint8_t evaluate(const AlertValue *values, unsigned long now);
+  void reset();
+  // Moves the threshold of every rule on field; the hysteresis band follows
+  void setThreshold(uint8_t field, AlertValue threshold);
+  // Rules raised, bit i for rule i, so a warm restart can carry them over
+  uint8_t getRaised() { return raised; }
+  void restoreRaised(uint8_t raised);
+  // True while a rule waits out its hold time
+  bool isPending() { return pending != 0; }
+
+  uint8_t getAlertState() { return alertState; }
+};
+
+#endif // ALERT_ENGINE_H
@@ -0,0 +1,202 @@
+#include "ConfigStore.h"
+#include <EEPROM.h>
+
+struct ConfigHeader {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t size;
+};
+
+// Bitwise: the block is read once per boot
+uint16_t ConfigStore::crc16(uint16_t crc, uint8_t data) {
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+ConfigStore::ConfigStore(void *data, uint8_t size, const void *defaults,
+                         const ConfigField *fields, uint8_t fieldCount,
+                         uint8_t version) {
+  this->data = (uint8_t *)data;
+  this->size = size;
+  this->defaults = defaults;
+  this->fields = fields;
+  this->fieldCount = fieldCount;
+  this->version = version;
+}
+
+bool ConfigStore::begin() {
+  ConfigHeader header;
+  EEPROM.get(CONFIG_ADDRESS, header);
+  bool valid = header.magic == CONFIG_MAGIC && header.version == version &&
+               header.size == size;
+
+  if (valid) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < sizeof(header); i++) {
+      crc = crc16(crc, ((uint8_t *)&header)[i]);
+    }
+    int address = CONFIG_ADDRESS + sizeof(header);
+    for (uint8_t i = 0; i < size; i++) {
+      data[i] = EEPROM.read(address + i);
+      crc = crc16(crc, data[i]);
+    }
+    uint16_t storedCrc;
+    EEPROM.get(address + size, storedCrc);
+    valid = crc == storedCrc;
+  }
+
+  if (!valid) {
+    Serial.println(F("No valid settings in EEPROM, using defaults"));
+    restoreDefaults();
+  }
+  return valid;
+}
+
+void ConfigStore::save() {
+  ConfigHeader header = {CONFIG_MAGIC, version, size};
+  uint16_t crc = 0xFFFF;
+  int address = CONFIG_ADDRESS;
+  for (uint8_t i = 0; i < sizeof(header); i++) {
+    uint8_t value = ((uint8_t *)&header)[i];
+    crc = crc16(crc, value);
+    EEPROM.update(address++, value);
+  }
+  for (uint8_t i = 0; i < size; i++) {
+    crc = crc16(crc, data[i]);
+    EEPROM.update(address++, data[i]);
+  }
+  // Written last: a reset during the update leaves a block that fails the
+  // check and falls back to the defaults
+  EEPROM.put(address, crc);
+}
+
+void ConfigStore::restoreDefaults() {
+  memcpy_P(data, defaults, size);
+  save();
+}
+
+bool ConfigStore::findField(const char *name, ConfigField &field) {
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    memcpy_P(&field, &fields[i], sizeof(field));
+    if (strcmp(field.name, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ConfigStore::set(const char *name, const char *value) {
+  ConfigField field;
+  if (!findField(name, field)) {
+    return false;
+  }
+
+  char *end;
+  double number = strtod(value, &end);
+  while (*end == ' ' || *end == '\r' || *end == '\n') {
+    end++;
+  }
+  if (end == value || *end != '\0' || number < field.minimum ||
+      number > field.maximum) {
+    return false;
+  }
+
+  uint8_t *member = data + field.offset;
+  switch (field.type) {
+  case CONFIG_UINT8:
+    *member = (uint8_t)number;
+    break;
+  case CONFIG_UINT16: {
+    uint16_t integer = (uint16_t)number;
+    memcpy(member, &integer, sizeof(integer));
+    break;
+  }
+  case CONFIG_UINT32: {
+    uint32_t integer = (uint32_t)number;
+    memcpy(member, &integer, sizeof(integer));
+    break;
+  }
+  case CONFIG_FLOAT: {
+    float real = (float)number;
+    memcpy(member, &real, sizeof(real));
+    break;
+  }
+  }
+  save();
+  return true;
+}
+
+void ConfigStore::printValue(Print &out, const ConfigField &field) {
+  const uint8_t *member = data + field.offset;
+  switch (field.type) {
+  case CONFIG_UINT8:
+    out.print(*member);
+    break;
+  case CONFIG_UINT16: {
+    uint16_t integer;
+    memcpy(&integer, member, sizeof(integer));
+    out.print(integer);
+    break;
+  }
+  case CONFIG_UINT32: {
+    uint32_t integer;
+    memcpy(&integer, member, sizeof(integer));
+    out.print(integer);
+    break;
+  }
+  case CONFIG_FLOAT: {
+    float real;
+    memcpy(&real, member, sizeof(real));
+    out.print(real);
+    break;
+  }
+  }
+}
+
+void ConfigStore::dump(Print &out) {
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    ConfigField field;
+    memcpy_P(&field, &fields[i], sizeof(field));
+    out.print(field.name);
+    out.print(F(" = "));
+    printValue(out, field);
+    out.println();
+  }
+}
+
+bool ConfigStore::handleCommand(const char *line) {
+  if (strncmp(line, "config", 6) == 0) {
+    if (strncmp(line + 6, " reset", 6) == 0) {
+      restoreDefaults();
+      Serial.println(F("Settings reset to defaults"));
+    }
+    dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "set ", 4) != 0) {
+    return false;
+  }
+
+  // set <name> <value>
+  const char *name = line + 4;
+  const char *value = strchr(name, ' ');
+  char fieldName[CONFIG_NAME_SIZE];
+  if (value && value - name < CONFIG_NAME_SIZE) {
+    memcpy(fieldName, name, value - name);
+    fieldName[value - name] = '\0';
+    if (set(fieldName, value + 1)) {
+      ConfigField field;
+      findField(fieldName, field);
+      Serial.print(fieldName);
+      Serial.print(F(" = "));
+      printValue(Serial, field);
+      Serial.println();
+      return true;
+    }
+  }
+  Serial.println(F("Invalid setting; \"config\" lists them"));
+  return true;
+}
@@ -0,0 +1,191 @@
+#include "GasSensorAdc.h"
+#include "Air_Quality_Sensor.h"
+#include "LoopProfiler.h"
+#include "SensorTrace.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
+volatile uint16_t GasSensorAdc::ring[AQI_ADC_RING_SIZE];
+volatile uint8_t GasSensorAdc::ringHead = 0;
+volatile uint32_t GasSensorAdc::accumulator = 0;
+volatile uint16_t GasSensorAdc::conversions = 0;
+
+#if defined(__AVR__)
+// Clearing the compare flag lets the next Timer1 match trigger again
+ISR(ADC_vect)
+{
+    TIFR1 = _BV(OCF1B);
+    GasSensorAdc::onConversion(ADC);
+}
+#endif
+
+GasSensorAdc::GasSensorAdc()
+{
+    pin = A0;
+    noiseReduction = false;
+    currentVoltage = 0;
+    lastVoltage = 0;
+    standardVoltage = 0;
+    voltageSum = 0;
+    voltageCount = 0;
+    lastSlopeUpdate = 0;
+    lastStandardUpdate = 0;
+    quality = AirQualitySensor::FRESH_AIR;
+}
+
+void GasSensorAdc::onConversion(uint16_t sample)
+{
+    accumulator += sample;
+    if (++conversions < AQI_ADC_DECIMATION)
+        return;
+
+    ring[ringHead] = accumulator >> AQI_ADC_EXTRA_BITS;
+    ringHead = (ringHead + 1) % AQI_ADC_RING_SIZE;
+    accumulator = 0;
+    conversions = 0;
+}
+
+bool GasSensorAdc::begin(uint8_t pin)
+{
+    this->pin = pin;
+    pinMode(pin, INPUT);
+
+    // Seed the ring so readers never average an empty window
+    uint16_t reading = analogRead(pin);
+    accumulator = 0;
+    conversions = 0;
+    uint16_t first = reading << AQI_ADC_EXTRA_BITS;
+    for (uint8_t i = 0; i < AQI_ADC_RING_SIZE; i++)
+        ring[i] = first;
+
+    currentVoltage = lastVoltage = standardVoltage = getVoltage();
+    lastSlopeUpdate = lastStandardUpdate = millis();
+
+    startConversions();
+    return reading > AQI_SENSOR_MIN && reading < AQI_SENSOR_MAX;
+}
+
+void GasSensorAdc::startConversions()
+{
+#if defined(__AVR__)
+    // Timer1 in CTC mode at 250 kHz, no interrupt of its own: each compare
+    // match B starts a conversion. AVcc reference, channel from the Arduino
+    // pin, 125 kHz ADC clock, conversion interrupt.
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+    OCR1A = AQI_ADC_TRIGGER_PERIOD / 4 - 1;
+    OCR1B = OCR1A;
+    TCNT1 = 0;
+    TIMSK1 = 0;
+    TIFR1 = _BV(OCF1B);
+
+    ADMUX = _BV(REFS0) | ((pin - A0) & 0x07);
+    ADCSRB = _BV(ADTS2) | _BV(ADTS0); // Timer1 compare match B
+    ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) |
+             _BV(ADPS0);
+#else
+    lastTrigger = micros();
+#endif
+}
+
+void GasSensorAdc::setNoiseReduction(bool enabled)
+{
+    noiseReduction = enabled;
+#if defined(__AVR__)
+    if (enabled)
+    {
+        ADCSRA &= ~_BV(ADATE);
+        TCCR1B = 0;
+        while (ADCSRA & _BV(ADSC))
+            ;
+    }
+    else
+    {
+        startConversions();
+    }
+#endif
+}
+
+void GasSensorAdc::sampleInSleep()
+{
+#if defined(__AVR__)
+    // Entering ADC noise reduction sleep starts a conversion; the ADC ISR
+    // wakes the CPU. Timer0 is halted meanwhile, so millis() loses about
+    // 0.1 ms per conversion. Any other interrupt may wake us early, hence
+    // the wait on ADSC.
+    set_sleep_mode(SLEEP_MODE_ADC);
+    for (uint8_t i = 0; i < AQI_NOISE_REDUCTION_BURST; i++)
+    {
+        sleep_enable();
+        sleep_cpu();
+        sleep_disable();
+        while (ADCSRA & _BV(ADSC))
+            ;
+    }
+#endif
+}
+
+float GasSensorAdc::getVoltage()
+{
+    uint32_t sum = 0;
+
+    noInterrupts();
+    for (uint8_t i = 0; i < AQI_ADC_RING_SIZE; i++)
+        sum += ring[i];
+    interrupts();
+
+    return (float)sum / ((uint32_t)AQI_ADC_RING_SIZE << AQI_ADC_EXTRA_BITS);
+}
+
+void GasSensorAdc::update(unsigned long now)
+{
+    PROFILE_SCOPE(PROFILE_STAGE_GAS);
+#if defined(__AVR__)
+    if (noiseReduction)
+        sampleInSleep();
+#else
+    // No ADC interrupt off-target: the conversions Timer1 would have
+    // triggered since the last update, in virtual time
+    while (micros() - lastTrigger >= AQI_ADC_TRIGGER_PERIOD)
+    {
+        lastTrigger += AQI_ADC_TRIGGER_PERIOD;
+        onConversion(analogRead(pin));
+    }
+#endif
+
+    if (now - lastSlopeUpdate < AQI_SLOPE_INTERVAL)
+        return;
+    lastSlopeUpdate = now;
+
+    lastVoltage = currentVoltage;
+    currentVoltage = getVoltage();
+
+    SENSOR_TRACE_BEGIN("aqi");
+    SENSOR_TRACE_FIELD(currentVoltage);
+    SENSOR_TRACE_END();
+
+    voltageSum += currentVoltage;
+    voltageCount++;
+    if (now - lastStandardUpdate > AQI_STANDARD_UPDATE)
+    {
+        standardVoltage = voltageSum / voltageCount;
+        voltageSum = 0;
+        voltageCount = 0;
+        lastStandardUpdate = now;
+    }
+
+    // Same thresholds as AirQualitySensor::slope(), in 10-bit ADC units
+    float rise = currentVoltage - lastVoltage;
+    float drift = currentVoltage - standardVoltage;
+
+    if (rise > 400 || currentVoltage > 700)
+        quality = AirQualitySensor::FORCE_SIGNAL;
+    else if (drift > 150)
+        quality = AirQualitySensor::HIGH_POLLUTION;
+    else if (rise > 200 || drift > 50)
+        quality = AirQualitySensor::LOW_POLLUTION;
+    else
+        quality = AirQualitySensor::FRESH_AIR;
+}
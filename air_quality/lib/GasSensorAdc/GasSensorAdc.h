@@ -0,0 +1,69 @@
+#ifndef GAS_SENSOR_ADC_H
+#define GAS_SENSOR_ADC_H
+
+#include <Arduino.h>
+
+// 4^n conversions give n extra bits: 64 conversions -> 13-bit samples. Timer1
+// starts a conversion every AQI_ADC_TRIGGER_PERIOD, so 4 samples per second,
+// and the ring spans the second between two slope classifications.
+#define AQI_ADC_EXTRA_BITS 3
+#define AQI_ADC_DECIMATION (1 << (2 * AQI_ADC_EXTRA_BITS))
+#define AQI_ADC_TRIGGER_PERIOD 3904 // us, 256 Hz in Timer1 ticks of 4 us
+#define AQI_ADC_RING_SIZE 4
+#define AQI_NOISE_REDUCTION_BURST 16 // conversions per update() when sleeping
+
+// First reading outside this window: sensor missing or shorted (same check
+// as the Seeed driver), in 10-bit ADC units
+#define AQI_SENSOR_MIN 10
+#define AQI_SENSOR_MAX 798
+
+#define AQI_SLOPE_INTERVAL 1000         // ms between slope comparisons
+#define AQI_STANDARD_UPDATE 500000UL    // ms between baseline refreshes
+
+// Timer-triggered, interrupt-driven acquisition of the Grove air quality
+// sensor. Timer1 starts the conversions at the rate the smoothing needs, so
+// the CPU is only woken 256 times a second; the ADC ISR accumulates them and
+// pushes decimated samples into a ring, and readers only average the ring.
+// slope() mirrors the classification of AirQualitySensor::slope() on the
+// smoothed signal, at a fixed 1 s pace instead of once per caller.
+class GasSensorAdc
+{
+private:
+    static volatile uint16_t ring[AQI_ADC_RING_SIZE];
+    static volatile uint8_t ringHead;
+    static volatile uint32_t accumulator;
+    static volatile uint16_t conversions;
+
+    uint8_t pin;
+    bool noiseReduction;
+
+    float currentVoltage;
+    float lastVoltage;
+    float standardVoltage;
+    float voltageSum;
+    uint16_t voltageCount;
+    unsigned long lastSlopeUpdate;
+    unsigned long lastStandardUpdate;
+    int quality;
+#if !defined(__AVR__)
+    unsigned long lastTrigger; // us, stands in for Timer1
+#endif
+
+    void startConversions();
+    void sampleInSleep();
+
+public:
+    GasSensorAdc();
+    // False if the sensor does not answer; conversions start either way
+    bool begin(uint8_t pin);
+    void update(unsigned long now);
+    void setNoiseReduction(bool enabled);
+
+    float getVoltage(); // ring mean, in 10-bit ADC units
+    int getValue() { return (int)(getVoltage() + 0.5); }
+    int slope() { return quality; }
+
+    static void onConversion(uint16_t sample);
+};
+
+#endif // GAS_SENSOR_ADC_H
@@ -0,0 +1,17 @@
+#include "HM330XFrame.h"
+
+bool HM330XFrame::isValid() const
+{
+    const uint8_t *raw = reinterpret_cast<const uint8_t *>(this);
+    uint8_t sum = 0;
+    uint8_t any = 0;
+
+    for (uint8_t i = 0; i < HM330X_FRAME_SIZE - 1; i++)
+    {
+        sum += raw[i];
+        any |= raw[i];
+    }
+
+    // A bus read that returned nothing but zeros also passes the checksum.
+    return any != 0 && sum == checksum;
+}
@@ -0,0 +1,49 @@
+#ifndef HM330X_FRAME_H
+#define HM330X_FRAME_H
+
+#include <Arduino.h>
+
+#define HM330X_FRAME_SIZE 29
+
+// Big-endian 16-bit field, readable in place whatever the MCU byte order.
+struct HM330XWord
+{
+    uint8_t high;
+    uint8_t low;
+
+    operator uint16_t() const { return (uint16_t)high << 8 | low; }
+} __attribute__((packed));
+
+// Overlay for the 29-byte frame returned by HM330X::read_sensor_value().
+// Concentrations are in ug/m3, "standard" being the CF=1 calibration and
+// "atmospheric" the ambient one. Counts are particles per size bin.
+struct HM330XFrame
+{
+    HM330XWord reserved;
+    HM330XWord sensorNumber;
+    HM330XWord pm1_0Standard;
+    HM330XWord pm2_5Standard;
+    HM330XWord pm10Standard;
+    HM330XWord pm1_0Atmospheric;
+    HM330XWord pm2_5Atmospheric;
+    HM330XWord pm10Atmospheric;
+    HM330XWord count0_3um;
+    HM330XWord count0_5um;
+    HM330XWord count1_0um;
+    HM330XWord count2_5um;
+    HM330XWord count5_0um;
+    HM330XWord count10um;
+    uint8_t checksum;
+
+    static const HM330XFrame *view(const uint8_t *buffer)
+    {
+        return reinterpret_cast<const HM330XFrame *>(buffer);
+    }
+
+    bool isValid() const;
+} __attribute__((packed));
+
+static_assert(sizeof(HM330XFrame) == HM330X_FRAME_SIZE,
+              "HM330XFrame must overlay the raw sensor frame exactly");
+
+#endif // HM330X_FRAME_H
@@ -1,25 +1,29 @@
 #include "LoRaManager.h"
+#include "LoopProfiler.h"
 
-LoRaManager::LoRaManager(byte rxPin, byte txPin) {
-  loraSerial = new SoftwareSerial(rxPin, txPin);
+LoRaManager::LoRaManager(byte rxPin, byte txPin) : loraSerial(rxPin, txPin) {
   previousTTN = millis();
   uplinkInterval = 10000;
   receiveCallback = false;
   getDataStatus = false;
   networkJoinedStatus = false;
+  modemSleepEnabled = false;
+  modemAsleep = false;
+  lastModemActivity = 0;
 
-  inputString.reserve(200);
-  stringComplete = false;
+  consoleIndex = 0;
   rxbuff_index = 0;
+  commandHandler = nullptr;
 }
 
 void LoRaManager::begin() {
-  loraSerial->begin(9600);
-  loraSerial->println("ATZ");
+  loraSerial.begin(9600);
+  loraSerial.println(F("ATZ"));
 }
 
 void LoRaManager::handleLoRaMessages() {
-  loraSerial->listen();
+  PROFILE_SCOPE(PROFILE_STAGE_MODEM);
+  loraSerial.listen();
 
   unsigned long currentTime = millis();
   if ((currentTime - previousTTN >= uplinkInterval) &&
@@ -36,80 +40,109 @@ void LoRaManager::handleLoRaMessages() {
     getDataStatus = true;
     delay(1000);
 
-    loraSerial->println("AT+CFG");
+    wakeModem();
+    loraSerial.println(F("AT+CFG"));
   }
 
   processLoRaData();
+
+  // Not needed again before the next uplink
+  if (modemSleepEnabled && !modemAsleep && networkJoinedStatus &&
+      !receiveCallback && millis() - lastModemActivity >= LA66_SLEEP_DELAY) {
+    loraSerial.println(F(LA66_SLEEP_COMMAND));
+    modemAsleep = true;
+  }
+}
+
+void LoRaManager::wakeModem() {
+  if (modemAsleep) {
+    loraSerial.println();
+    delay(LA66_WAKE_TIME);
+    modemAsleep = false;
+  }
+  lastModemActivity = millis();
 }
 
 void LoRaManager::processLoRaData() {
-  while (loraSerial->available()) {
-    char inChar = (char)loraSerial->read();
-    inputString += inChar;
+  while (loraSerial.available()) {
+    char inChar = (char)loraSerial.read();
+    lastModemActivity = millis();
 
+    // A line longer than the buffer is dropped
+    if (rxbuff_index >= sizeof(rxbuff) - 1) {
+      rxbuff_index = 0;
+    }
     rxbuff[rxbuff_index++] = inChar;
 
-    if (rxbuff_index > 128)
-      break;
-
     if (inChar == '\n' || inChar == '\r') {
-      stringComplete = true;
       rxbuff[rxbuff_index] = '\0';
+      rxbuff_index = 0;
+      // Modem lines are echoed, except the downlink exchange
+      bool echo = !getDataStatus;
 
       if (strncmp(rxbuff, "JOINED", 6) == 0) {
         networkJoinedStatus = true;
-        Serial.println("Network joined!");
+        Serial.println(F("Network joined!"));
       }
 
       if (strncmp(rxbuff, "Dragino LA66 Device", 19) == 0) {
         networkJoinedStatus = false;
-        Serial.println("Network connection reset");
+        modemAsleep = false;
+        Serial.println(F("Network connection reset"));
       }
 
       if (strncmp(rxbuff, "Run AT+RECVB=? to see detail", 28) == 0) {
         receiveCallback = true;
-        stringComplete = false;
-        inputString = "\0";
+        echo = false;
       }
 
       if (strncmp(rxbuff, "AT+RECVB=", 9) == 0) {
-        stringComplete = false;
-        inputString = "\0";
-        Serial.print("\r\nGet downlink data(FPort & Payload) ");
+        echo = false;
+        Serial.print(F("\r\nGet downlink data(FPort & Payload) "));
         Serial.println(&rxbuff[9]);
       }
 
-      rxbuff_index = 0;
-
-      if (getDataStatus == true) {
-        stringComplete = false;
-        inputString = "\0";
+      if (echo) {
+        Serial.print(rxbuff);
       }
     }
   }
-
-  if (stringComplete) {
-    Serial.print(inputString);
-
-    inputString = "\0";
-    stringComplete = false;
-  }
 }
 
 void LoRaManager::sendAirQualityData(uint16_t pm25, uint16_t pm10, int aqiValue,
-                                     uint8_t alertState) {
+                                     uint8_t alertState, uint16_t nowCast25,
+                                     uint16_t nowCast10, uint16_t dayMean25,
+                                     uint16_t dayMean10, uint8_t aqiCategory) {
   if (!networkJoinedStatus) {
-    Serial.println("Network not joined, cannot send data");
+    Serial.println(F("Network not joined, cannot send data"));
     return;
   }
 
   Serial.println(F("\n===== SENDING AIR QUALITY DATA ====="));
-  Serial.println("PM2.5: " + String(pm25) + " μg/m³");
-  Serial.println("PM10: " + String(pm10) + " μg/m³");
-  Serial.println("AQI Value: " + String(aqiValue));
-  Serial.println("Alert State: " + String(alertState));
-
-  uint8_t payload[7];
+  Serial.print(F("PM2.5: "));
+  Serial.print(pm25);
+  Serial.println(F(" μg/m³"));
+  Serial.print(F("PM10: "));
+  Serial.print(pm10);
+  Serial.println(F(" μg/m³"));
+  Serial.print(F("AQI Value: "));
+  Serial.println(aqiValue);
+  Serial.print(F("Alert State: "));
+  Serial.println(alertState);
+  Serial.print(F("NowCast PM2.5/PM10: "));
+  Serial.print(nowCast25);
+  Serial.print('/');
+  Serial.print(nowCast10);
+  Serial.println(F(" (0.1 μg/m³)"));
+  Serial.print(F("24h PM2.5/PM10: "));
+  Serial.print(dayMean25);
+  Serial.print('/');
+  Serial.print(dayMean10);
+  Serial.println(F(" (0.1 μg/m³)"));
+  Serial.print(F("AQI Category: "));
+  Serial.println(aqiCategory);
+
+  uint8_t payload[AIR_QUALITY_PAYLOAD_SIZE];
   payload[0] = (pm25 >> 8) & 0xFF;
   payload[1] = pm25 & 0xFF;
   payload[2] = (pm10 >> 8) & 0xFF;
@@ -117,35 +150,84 @@ void LoRaManager::sendAirQualityData(uint16_t pm25, uint16_t pm10, int aqiValue,
   payload[4] = (aqiValue >> 8) & 0xFF;
   payload[5] = aqiValue & 0xFF;
   payload[6] = alertState & 0xFF;
+  payload[7] = (nowCast25 >> 8) & 0xFF;
+  payload[8] = nowCast25 & 0xFF;
+  payload[9] = (nowCast10 >> 8) & 0xFF;
+  payload[10] = nowCast10 & 0xFF;
+  payload[11] = (dayMean25 >> 8) & 0xFF;
+  payload[12] = dayMean25 & 0xFF;
+  payload[13] = (dayMean10 >> 8) & 0xFF;
+  payload[14] = dayMean10 & 0xFF;
+  payload[15] = aqiCategory;
 
   Serial.print(F("Raw payload: "));
-  for (int i = 0; i < 7; i++) {
+  for (int i = 0; i < AIR_QUALITY_PAYLOAD_SIZE; i++) {
     Serial.print(payload[i], HEX);
-    Serial.print(" ");
+    Serial.print(' ');
   }
   Serial.println();
 
-  char hexPayload[15] = {0};
-  for (int i = 0; i < 7; i++) {
-    sprintf(&hexPayload[i * 2], "%02X", payload[i]);
+  Serial.print(F("Sending command: "));
+  printSendCommand(Serial, 2, payload, AIR_QUALITY_PAYLOAD_SIZE);
+  wakeModem();
+  printSendCommand(loraSerial, 2, payload, AIR_QUALITY_PAYLOAD_SIZE);
+}
+
+bool LoRaManager::sendPayload(uint8_t port, const uint8_t *payload,
+                              uint8_t length) {
+  if (!networkJoinedStatus) {
+    Serial.println(F("Network not joined, cannot send data"));
+    return false;
   }
 
-  char sensor_data_buff[128] = {0};
-  sprintf(sensor_data_buff, "AT+SENDB=%d,%d,%d,%s", 1, 2, 7, hexPayload);
+  Serial.println(F("===== SEND DATA TO TTN"));
+
+  Serial.print(F("Raw payload: "));
+  for (int i = 0; i < length; i++) {
+    Serial.print(payload[i], HEX);
+    Serial.print(' ');
+  }
+  Serial.println();
 
-  Serial.println("Sending command: " + String(sensor_data_buff));
-  loraSerial->println(sensor_data_buff);
+  wakeModem();
+  printSendCommand(loraSerial, port, payload, length);
+  return true;
+}
+
+void LoRaManager::printSendCommand(Print &out, uint8_t port,
+                                   const uint8_t *payload, uint8_t length) {
+  // Streamed rather than formatted into a buffer first
+  out.print(F("AT+SENDB=1,"));
+  out.print(port);
+  out.print(',');
+  out.print(length);
+  out.print(',');
+  for (uint8_t i = 0; i < length; i++) {
+    out.print(payload[i] >> 4, HEX);
+    out.print(payload[i] & 0x0F, HEX);
+  }
+  out.println();
 }
 
 bool LoRaManager::isNetworkJoined() { return networkJoinedStatus; }
 
 void LoRaManager::processSerialCommands() {
+  PROFILE_SCOPE(PROFILE_STAGE_CONSOLE);
   while (Serial.available()) {
     char inChar = (char)Serial.read();
-    inputString += inChar;
-    if (inChar == '\n' || inChar == '\r') {
-      loraSerial->print(inputString);
-      inputString = "\0";
+    bool endOfLine = inChar == '\n' || inChar == '\r';
+
+    // Long lines are cut, keeping room for the line end
+    if (consoleIndex < sizeof(consoleLine) - 2 || endOfLine) {
+      consoleLine[consoleIndex++] = inChar;
+    }
+    if (endOfLine) {
+      consoleLine[consoleIndex] = '\0';
+      consoleIndex = 0;
+      if (!commandHandler || !commandHandler(consoleLine)) {
+        wakeModem();
+        loraSerial.print(consoleLine);
+      }
     }
   }
 }
@@ -0,0 +1,39 @@
+#ifndef PROFILE_STAGES_H
+#define PROFILE_STAGES_H
+
+#include <Arduino.h>
+
+// Stage ids are sent in the diagnostic uplink; keep codec.js in step
+enum ProfileStageId : uint8_t {
+  PROFILE_STAGE_LOOP,    // loop() without the trailing delay
+  PROFILE_STAGE_SENSORS, // readSensors(), alerts included
+  PROFILE_STAGE_HM330X,  // HM330X frame read over I2C
+  PROFILE_STAGE_GAS,     // gas sensor ADC conversion
+  PROFILE_STAGE_MODEM,   // LA66 line parsing
+  PROFILE_STAGE_CONSOLE, // serial console commands
+  PROFILE_STAGE_UPLINK,  // payload, console printing and AT+SENDB
+  PROFILE_STAGE_COUNT
+};
+
+static inline const __FlashStringHelper *profileStageName(uint8_t stage) {
+  switch (stage) {
+  case PROFILE_STAGE_LOOP:
+    return F("loop");
+  case PROFILE_STAGE_SENSORS:
+    return F("sensors");
+  case PROFILE_STAGE_HM330X:
+    return F("hm330x");
+  case PROFILE_STAGE_GAS:
+    return F("gas");
+  case PROFILE_STAGE_MODEM:
+    return F("modem");
+  case PROFILE_STAGE_CONSOLE:
+    return F("console");
+  case PROFILE_STAGE_UPLINK:
+    return F("uplink");
+  default:
+    return F("?");
+  }
+}
+
+#endif // PROFILE_STAGES_H
@@ -0,0 +1,157 @@
+#ifndef OUTLIER_FILTER_H
+#define OUTLIER_FILTER_H
+
+#include <Arduino.h>
+
+// Robust filters for raw sensor readings, on the last N values of any type
+// with ordering, + and - (float, long, uint16_t, Q16_16, Q24_8...). Nothing
+// is allocated: a window is one array kept sorted plus the age of each
+// entry, N * (sizeof(T) + 1) + 1 bytes, and each update is O(N) like
+// BaselineEstimator's, without its second copy in arrival order.
+template <typename T, uint8_t N> class SortedWindow {
+  static_assert(N >= 3 && N < 128, "window of 3 to 127 values");
+
+protected:
+  T sorted[N];
+  uint8_t ages[N]; // of each sorted entry, 0 for the newest
+  uint8_t count;
+
+  // Without abs(), so unsigned and fixed-point values work too
+  static T distance(T a, T b) { return a > b ? a - b : b - a; }
+
+public:
+  SortedWindow() : count(0) {}
+  void reset() { count = 0; }
+
+  // Drops the oldest value once the window is full, then inserts the new one
+  // in order
+  void add(T value) {
+    uint8_t size = count;
+    if (count == N) {
+      uint8_t i = 0;
+      while (ages[i] != N - 1) {
+        i++;
+      }
+      for (; i < N - 1; i++) {
+        sorted[i] = sorted[i + 1];
+        ages[i] = ages[i + 1];
+      }
+      size--;
+    } else {
+      count++;
+    }
+
+    for (uint8_t i = 0; i < size; i++) {
+      ages[i]++;
+    }
+    uint8_t i = size;
+    while (i > 0 && value < sorted[i - 1]) {
+      sorted[i] = sorted[i - 1];
+      ages[i] = ages[i - 1];
+      i--;
+    }
+    sorted[i] = value;
+    ages[i] = 0;
+  }
+
+  uint8_t getCount() const { return count; }
+  bool isFull() const { return count == N; }
+  // Smallest value for rank 0, largest for getCount() - 1
+  T get(uint8_t rank) const { return sorted[rank]; }
+
+  // Lower of the two middle values for an even count, so integer types never
+  // round; T() while empty
+  T median() const { return count ? sorted[(count - 1) / 2] : T(); }
+};
+
+// Median of the last N values. Up to (N - 1) / 2 spikes in a row never get
+// through, but a real step shows that many readings late.
+template <typename T, uint8_t N>
+class RunningMedian : public SortedWindow<T, N> {
+public:
+  T filter(T value) {
+    this->add(value);
+    return this->median();
+  }
+};
+
+// Mean of the last N values without the TRIM lowest and TRIM highest, fewer
+// while the window fills. The sum runs in T, which must hold N values.
+template <typename T, uint8_t N, uint8_t TRIM>
+class TrimmedMean : public SortedWindow<T, N> {
+  static_assert(2 * TRIM < N, "at least one value left after trimming");
+
+public:
+  T filter(T value) {
+    this->add(value);
+    return mean();
+  }
+
+  T mean() const {
+    if (this->count == 0) {
+      return T();
+    }
+    uint8_t trim = 2 * TRIM < this->count ? TRIM : (this->count - 1) / 2;
+    T sum = this->sorted[trim];
+    for (uint8_t i = trim + 1; i < this->count - trim; i++) {
+      sum += this->sorted[i];
+    }
+    return (T)(sum / (this->count - 2 * trim));
+  }
+};
+
+// Hampel identifier: a value further from the window median than `scale`
+// median absolute deviations (MAD), and than `minDeviation`, is replaced by
+// the median; any other value passes unchanged. A scale of 4.45 is three
+// standard deviations of Gaussian noise. The floor keeps a window of equal
+// readings, common on coarse sensors (MAD 0), from rejecting every change.
+// Outliers stay in the window, so a lasting step passes once it fills half
+// of it. Nothing is an outlier until the window holds 3 values. For a batch,
+// such as a burst of readings, add() them all and check each with
+// isOutlier(): an outlier is then caught wherever it lies in the batch.
+template <typename T, uint8_t N>
+class HampelFilter : public SortedWindow<T, N> {
+private:
+  T scale;
+  T minDeviation;
+
+  // Deviations grow outward from the median's slot in the sorted window, so
+  // merging both sides reaches their median in O(N), without a second sort
+  T deviationMedian(T center) const {
+    int8_t below = (this->count - 1) / 2;
+    uint8_t above = below + 1;
+    T deviation = T();
+    for (uint8_t i = 0; i <= (this->count - 1) / 2; i++) {
+      if (above >= this->count ||
+          (below >= 0 && this->distance(this->sorted[below], center) <=
+                             this->distance(this->sorted[above], center))) {
+        deviation = this->distance(this->sorted[below--], center);
+      } else {
+        deviation = this->distance(this->sorted[above++], center);
+      }
+    }
+    return deviation;
+  }
+
+public:
+  HampelFilter(T scale, T minDeviation)
+      : scale(scale), minDeviation(minDeviation) {}
+
+  bool isOutlier(T value) const {
+    if (this->count < 3) {
+      return false;
+    }
+    T center = this->median();
+    T deviation = this->distance(value, center);
+    return deviation > minDeviation &&
+           deviation > (T)(deviationMedian(center) * scale);
+  }
+
+  // The value, or the window median if it is an outlier
+  T filter(T value) {
+    this->add(value);
+    return isOutlier(value) ? this->median() : value;
+  }
+};
+
+#endif // OUTLIER_FILTER_H
@@ -0,0 +1,187 @@
+#include "PMAggregator.h"
+
+// Upper bounds of each AQI category in 0.1 ug/m3, EPA 2024 breakpoints.
+// Anything above the last entry is Hazardous.
+constexpr uint16_t PM25_BREAKPOINTS[] = {90, 354, 554, 1254, 2254};
+constexpr uint16_t PM10_BREAKPOINTS[] = {540, 1540, 2540, 3540, 4240};
+constexpr uint8_t BREAKPOINT_COUNT =
+    sizeof(PM25_BREAKPOINTS) / sizeof(PM25_BREAKPOINTS[0]);
+
+PMAggregator::PMAggregator()
+{
+    for (uint8_t c = 0; c < PM_CHANNEL_COUNT; c++)
+    {
+        for (uint8_t h = 0; h < PM_DAY_HOURS; h++)
+            hourly[c][h] = PM_NO_DATA;
+        daySum[c] = 0;
+        hourSum[c] = 0;
+    }
+    hourCount = 0;
+    dayHours = 0;
+    head = 0;
+    hourStart = 0;
+}
+
+void PMAggregator::addSample(uint16_t pm2_5, uint16_t pm10, unsigned long now)
+{
+    // Hours without a single sample are closed as gaps
+    while (now - hourStart >= PM_HOUR_MS)
+    {
+        closeHour();
+        hourStart += PM_HOUR_MS;
+    }
+
+    hourSum[PM_CHANNEL_2_5] += pm2_5;
+    hourSum[PM_CHANNEL_10] += pm10;
+    hourCount++;
+}
+
+void PMAggregator::closeHour()
+{
+    head = (head + 1) % PM_DAY_HOURS;
+    bool evicted = hourly[0][head] != PM_NO_DATA;
+
+    for (uint8_t c = 0; c < PM_CHANNEL_COUNT; c++)
+    {
+        if (evicted)
+            daySum[c] -= hourly[c][head];
+
+        if (hourCount > 0)
+        {
+            hourly[c][head] = (hourSum[c] * 10 + hourCount / 2) / hourCount;
+            daySum[c] += hourly[c][head];
+        }
+        else
+        {
+            hourly[c][head] = PM_NO_DATA;
+        }
+        hourSum[c] = 0;
+    }
+
+    if (evicted)
+        dayHours--;
+    if (hourCount > 0)
+        dayHours++;
+    hourCount = 0;
+}
+
+void PMAggregator::saveSnapshot(PMSnapshot &snapshot, unsigned long now)
+{
+    memcpy(snapshot.hourly, hourly, sizeof(hourly));
+    memcpy(snapshot.hourSum, hourSum, sizeof(hourSum));
+    snapshot.hourCount = hourCount;
+    snapshot.head = head;
+    snapshot.hourElapsed = now - hourStart;
+}
+
+void PMAggregator::restoreSnapshot(const PMSnapshot &snapshot, unsigned long now)
+{
+    if (snapshot.head >= PM_DAY_HOURS || snapshot.hourElapsed >= PM_HOUR_MS)
+        return;
+
+    memcpy(hourly, snapshot.hourly, sizeof(hourly));
+    memcpy(hourSum, snapshot.hourSum, sizeof(hourSum));
+    hourCount = snapshot.hourCount;
+    head = snapshot.head;
+    hourStart = now - snapshot.hourElapsed;
+
+    dayHours = 0;
+    for (uint8_t c = 0; c < PM_CHANNEL_COUNT; c++)
+        daySum[c] = 0;
+    for (uint8_t h = 0; h < PM_DAY_HOURS; h++)
+    {
+        if (hourly[0][h] == PM_NO_DATA)
+            continue;
+        for (uint8_t c = 0; c < PM_CHANNEL_COUNT; c++)
+            daySum[c] += hourly[c][h];
+        dayHours++;
+    }
+}
+
+uint16_t PMAggregator::getNowCast(PMChannel channel)
+{
+    const uint16_t *buckets = hourly[channel];
+
+    // NowCast needs two of the three most recent hours
+    uint8_t recent = 0;
+    for (uint8_t i = 0; i < 3; i++)
+        if (buckets[(head + PM_DAY_HOURS - i) % PM_DAY_HOURS] != PM_NO_DATA)
+            recent++;
+    if (recent < 2)
+        return PM_NO_DATA;
+
+    uint16_t minValue = PM_NO_DATA;
+    uint16_t maxValue = 0;
+    for (uint8_t i = 0; i < NOWCAST_HOURS; i++)
+    {
+        uint16_t value = buckets[(head + PM_DAY_HOURS - i) % PM_DAY_HOURS];
+        if (value == PM_NO_DATA)
+            continue;
+        if (value < minValue)
+            minValue = value;
+        if (value > maxValue)
+            maxValue = value;
+    }
+
+    float weight = maxValue > 0 ? (float)minValue / maxValue : 1.0;
+    if (weight < 0.5)
+        weight = 0.5;
+
+    float factor = 1.0;
+    float weightedSum = 0;
+    float weightTotal = 0;
+    for (uint8_t i = 0; i < NOWCAST_HOURS; i++)
+    {
+        uint16_t value = buckets[(head + PM_DAY_HOURS - i) % PM_DAY_HOURS];
+        if (value != PM_NO_DATA)
+        {
+            weightedSum += factor * value;
+            weightTotal += factor;
+        }
+        factor *= weight;
+    }
+
+    return (uint16_t)(weightedSum / weightTotal + 0.5);
+}
+
+uint16_t PMAggregator::getDayMean(PMChannel channel)
+{
+    if (dayHours < PM_DAY_MIN_HOURS)
+        return PM_NO_DATA;
+    return (daySum[channel] + dayHours / 2) / dayHours;
+}
+
+uint8_t PMAggregator::categoryFor(PMChannel channel, uint16_t concentration)
+{
+    if (concentration == PM_NO_DATA)
+        return AQI_CATEGORY_NONE;
+
+    const uint16_t *breakpoints;
+    if (channel == PM_CHANNEL_2_5)
+    {
+        breakpoints = PM25_BREAKPOINTS;
+    }
+    else
+    {
+        // PM10 is truncated to whole ug/m3 before lookup
+        breakpoints = PM10_BREAKPOINTS;
+        concentration -= concentration % 10;
+    }
+
+    uint8_t category = 0;
+    while (category < BREAKPOINT_COUNT && concentration > breakpoints[category])
+        category++;
+    return category;
+}
+
+uint8_t PMAggregator::getAqiCategory()
+{
+    uint8_t pm25Category = categoryFor(PM_CHANNEL_2_5, getNowCast(PM_CHANNEL_2_5));
+    uint8_t pm10Category = categoryFor(PM_CHANNEL_10, getNowCast(PM_CHANNEL_10));
+
+    if (pm25Category == AQI_CATEGORY_NONE)
+        return pm10Category;
+    if (pm10Category == AQI_CATEGORY_NONE)
+        return pm25Category;
+    return pm25Category > pm10Category ? pm25Category : pm10Category;
+}
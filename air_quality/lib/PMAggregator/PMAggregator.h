@@ -0,0 +1,71 @@
+#ifndef PM_AGGREGATOR_H
+#define PM_AGGREGATOR_H
+
+#include <Arduino.h>
+
+#define PM_HOUR_MS 3600000UL
+#define PM_DAY_HOURS 24
+#define PM_DAY_MIN_HOURS 18 // 75 % completeness for a 24-hour mean
+#define NOWCAST_HOURS 12
+#define PM_NO_DATA 0xFFFF // concentrations are in 0.1 ug/m3 units
+
+// EPA AQI categories, from Good to Hazardous
+#define AQI_CATEGORY_GOOD 0
+#define AQI_CATEGORY_MODERATE 1
+#define AQI_CATEGORY_SENSITIVE 2
+#define AQI_CATEGORY_UNHEALTHY 3
+#define AQI_CATEGORY_VERY_UNHEALTHY 4
+#define AQI_CATEGORY_HAZARDOUS 5
+#define AQI_CATEGORY_NONE 0xFF
+
+enum PMChannel : uint8_t
+{
+    PM_CHANNEL_2_5,
+    PM_CHANNEL_10,
+    PM_CHANNEL_COUNT
+};
+
+// Warm-restart state: the buckets and the running hour. The 24-hour sums
+// are rebuilt from the buckets.
+struct PMSnapshot
+{
+    uint16_t hourly[PM_CHANNEL_COUNT][PM_DAY_HOURS];
+    uint32_t hourSum[PM_CHANNEL_COUNT];
+    uint16_t hourCount;
+    uint8_t head;
+    uint32_t hourElapsed; // ms into the running hour
+};
+
+// Hourly buckets over the last 24 hours for PM2.5 and PM10. Samples only
+// touch the running hour sums; closing an hour updates the 24-hour sums, so
+// both stay O(1) per sample. NowCast walks the 12 newest buckets on demand.
+class PMAggregator
+{
+private:
+    uint16_t hourly[PM_CHANNEL_COUNT][PM_DAY_HOURS]; // newest at `head`
+    uint32_t daySum[PM_CHANNEL_COUNT];
+    uint32_t hourSum[PM_CHANNEL_COUNT];
+    uint16_t hourCount;
+    uint8_t dayHours;
+    uint8_t head;
+    unsigned long hourStart;
+
+    void closeHour();
+
+public:
+    PMAggregator();
+    void addSample(uint16_t pm2_5, uint16_t pm10, unsigned long now);
+
+    uint16_t getNowCast(PMChannel channel);
+    uint16_t getDayMean(PMChannel channel);
+    uint8_t getAqiCategory();
+
+    void saveSnapshot(PMSnapshot &snapshot, unsigned long now);
+    // The time the node was down is not known, so the history resumes
+    // where the snapshot left it
+    void restoreSnapshot(const PMSnapshot &snapshot, unsigned long now);
+
+    static uint8_t categoryFor(PMChannel channel, uint16_t concentration);
+};
+
+#endif // PM_AGGREGATOR_H
@@ -0,0 +1,85 @@
+#include "ParticleScheduler.h"
+
+ParticleScheduler::ParticleScheduler(unsigned long cycleTime,
+                                     unsigned long warmupTime,
+                                     uint8_t burstSamples,
+                                     unsigned long burstInterval)
+{
+    this->cycleTime = cycleTime;
+    this->warmupTime = warmupTime;
+    this->burstSamples = burstSamples > 0 ? burstSamples : 1;
+    this->burstInterval = burstInterval;
+
+    phase = PARTICLE_SLEEPING;
+    samplesTaken = 0;
+    cycleStart = 0;
+    nextRead = 0;
+    wakeTime = 0;
+    startTime = 0;
+    awakeTime = 0;
+}
+
+void ParticleScheduler::start(unsigned long now)
+{
+    // The first cycle begins immediately
+    startTime = now;
+    awakeTime = 0;
+    cycleStart = now - cycleTime;
+    phase = PARTICLE_SLEEPING;
+}
+
+ParticleAction ParticleScheduler::update(unsigned long now)
+{
+    switch (phase)
+    {
+    case PARTICLE_SLEEPING:
+        if (now - cycleStart < cycleTime)
+            return PARTICLE_IDLE;
+
+        // Skip whole cycles missed while the loop was busy
+        cycleStart += (now - cycleStart) / cycleTime * cycleTime;
+        phase = PARTICLE_WARMING_UP;
+        wakeTime = now;
+        return PARTICLE_WAKE;
+
+    case PARTICLE_WARMING_UP:
+        if (now - wakeTime < warmupTime)
+            return PARTICLE_IDLE;
+
+        phase = PARTICLE_SAMPLING;
+        samplesTaken = 0;
+        nextRead = now;
+        // fall through
+
+    case PARTICLE_SAMPLING:
+        if ((long)(now - nextRead) < 0)
+            return PARTICLE_IDLE;
+
+        nextRead += burstInterval;
+        if (++samplesTaken < burstSamples)
+            return PARTICLE_READ;
+
+        phase = PARTICLE_SLEEPING;
+        awakeTime += now - wakeTime;
+        return PARTICLE_READ_LAST;
+    }
+
+    return PARTICLE_IDLE;
+}
+
+float ParticleScheduler::getDutyRatio(unsigned long now)
+{
+    unsigned long elapsed = now - startTime;
+    unsigned long awake = awakeTime;
+    if (phase != PARTICLE_SLEEPING)
+        awake += now - wakeTime;
+
+    return elapsed > 0 ? (float)awake / elapsed : 1.0;
+}
+
+float ParticleScheduler::estimateEnergyPerSample(unsigned long now)
+{
+    float duty = getDutyRatio(now);
+    float averagePower = duty * HM330X_ACTIVE_MW + (1 - duty) * HM330X_SLEEP_MW;
+    return averagePower * cycleTime / 1000.0;
+}
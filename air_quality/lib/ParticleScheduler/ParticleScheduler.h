@@ -0,0 +1,67 @@
+#ifndef PARTICLE_SCHEDULER_H
+#define PARTICLE_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define PARTICLE_CYCLE_MS 60000      // one averaged sample per minute
+#define PARTICLE_WARMUP_MS 10000     // fan and laser settling after wake-up
+#define PARTICLE_BURST_SAMPLES 5
+#define PARTICLE_BURST_INTERVAL 1000 // ms between reads of a burst
+
+// Typical HM3301 supply power, used for the energy estimate only
+#define HM330X_ACTIVE_MW 375.0 // 75 mA at 5 V
+#define HM330X_SLEEP_MW 1.0
+
+enum ParticlePhase : uint8_t
+{
+    PARTICLE_SLEEPING,
+    PARTICLE_WARMING_UP,
+    PARTICLE_SAMPLING
+};
+
+enum ParticleAction : uint8_t
+{
+    PARTICLE_IDLE,
+    PARTICLE_WAKE,      // power the sensor up, warm-up starts now
+    PARTICLE_READ,      // take one sample of the burst
+    PARTICLE_READ_LAST  // take the last sample, then average and sleep
+};
+
+// Each cycle wakes the sensor, lets it warm up, reads a short burst and puts
+// it back to sleep until the next cycle. Purely time-driven, so it can be
+// stepped with any clock.
+class ParticleScheduler
+{
+private:
+    unsigned long cycleTime;
+    unsigned long warmupTime;
+    unsigned long burstInterval;
+    uint8_t burstSamples;
+
+    ParticlePhase phase;
+    uint8_t samplesTaken;
+    unsigned long cycleStart;
+    unsigned long nextRead;
+    unsigned long wakeTime;
+
+    unsigned long startTime;
+    unsigned long awakeTime;
+
+public:
+    ParticleScheduler(unsigned long cycleTime = PARTICLE_CYCLE_MS,
+                      unsigned long warmupTime = PARTICLE_WARMUP_MS,
+                      uint8_t burstSamples = PARTICLE_BURST_SAMPLES,
+                      unsigned long burstInterval = PARTICLE_BURST_INTERVAL);
+
+    void start(unsigned long now);
+    ParticleAction update(unsigned long now);
+
+    // Length of the cycles from the current one on
+    void setCycleTime(unsigned long cycleTime) { this->cycleTime = cycleTime; }
+
+    ParticlePhase getPhase() { return phase; }
+    float getDutyRatio(unsigned long now);
+    float estimateEnergyPerSample(unsigned long now); // mJ
+};
+
+#endif // PARTICLE_SCHEDULER_H
@@ -0,0 +1,162 @@
+#include "PowerManager.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// Timer0 counters from wiring.c; the timer stops while powered down
+extern volatile unsigned long timer0_millis;
+extern volatile unsigned long timer0_overflow_count;
+
+ISR(WDT_vect) { PowerManager::onWatchdog(); }
+
+static void startWatchdog(uint8_t prescaler) {
+  uint8_t bits = (prescaler & 0x07) | (prescaler & 0x08 ? _BV(WDP3) : 0);
+  uint8_t oldSREG = SREG;
+  cli();
+  wdt_reset();
+  MCUSR &= ~_BV(WDRF);
+  // Interrupt only: a missed wake-up must not reset the node
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = _BV(WDIE) | bits;
+  SREG = oldSREG;
+}
+#elif defined(ARDUINO_HOST)
+#include <ArduinoHost.h>
+#endif
+
+volatile bool PowerManager::watchdogFired = false;
+
+PowerManager::PowerManager() {
+  watchdogPeriod = POWER_WDT_PERIOD;
+  clockRemainder = 0;
+  for (uint8_t i = 0; i < POWER_MODE_COUNT; i++) {
+    modeTime[i] = 0;
+  }
+}
+
+void PowerManager::begin() {
+#if defined(__AVR__)
+  // The watchdog oscillator is only within 10% of 128 kHz
+  watchdogFired = false;
+  unsigned long start = micros();
+  startWatchdog(0);
+  while (!watchdogFired) {
+  }
+  watchdogPeriod = micros() - start;
+  wdt_disable();
+#endif
+}
+
+void PowerManager::sleep(unsigned long ms, bool powerDownAllowed) {
+  if (powerDownAllowed && ms >= POWER_DOWN_MIN) {
+    unsigned long slept = powerDown(ms);
+    // Less than a watchdog period left; an early wake-up returns at once
+    if (ms - slept < POWER_DOWN_MIN) {
+      idle(ms - slept);
+    }
+  } else {
+    idle(ms);
+  }
+}
+
+void PowerManager::idle(unsigned long ms) {
+#if defined(__AVR__)
+  unsigned long start = millis();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  // Timer0 wakes the CPU every 1.024 ms at the latest
+  while (millis() - start < ms) {
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+  }
+#elif defined(ARDUINO_HOST)
+  ArduinoHost::sleep(ArduinoHost::HOST_SLEEP_IDLE, ms);
+#else
+  delay(ms);
+#endif
+  modeTime[POWER_IDLE] += ms;
+}
+
+unsigned long PowerManager::powerDown(unsigned long ms) {
+  unsigned long slept = 0; // us
+#if defined(__AVR__)
+  // The UART stops with the clock: let the last bytes out first
+  Serial.flush();
+  uint8_t adcState = ADCSRA;
+  ADCSRA &= ~_BV(ADEN);
+
+  unsigned long target = min(ms, 3600000UL) * 1000;
+  while (true) {
+    // Longest watchdog timeout left within the target
+    uint8_t prescaler = POWER_WDT_MAX_PRESCALER;
+    while (prescaler > 0 && (watchdogPeriod << prescaler) > target - slept) {
+      prescaler--;
+    }
+    unsigned long period = watchdogPeriod << prescaler;
+    if (period > target - slept) {
+      break;
+    }
+
+    watchdogFired = false;
+    startWatchdog(prescaler);
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    cli();
+    sleep_enable();
+    sleep_bod_disable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    wdt_disable();
+
+    if (!watchdogFired) {
+      // Woken by another interrupt; the watchdog count cannot be read, so
+      // half the period is the best estimate
+      slept += period / 2;
+      break;
+    }
+    slept += period;
+  }
+
+  ADCSRA = adcState;
+  advanceClock(slept);
+#else
+  slept = ms / POWER_DOWN_MIN * POWER_DOWN_MIN * 1000;
+#if defined(ARDUINO_HOST)
+  ArduinoHost::sleep(ArduinoHost::HOST_SLEEP_POWER_DOWN, slept / 1000);
+#else
+  delay(slept / 1000);
+#endif
+#endif
+  modeTime[POWER_DOWN] += slept / 1000;
+  return slept / 1000;
+}
+
+void PowerManager::advanceClock(unsigned long us) {
+#if defined(__AVR__)
+  clockRemainder += us;
+  uint8_t oldSREG = SREG;
+  cli();
+  timer0_millis += clockRemainder / 1000;
+  // micros() follows to within one overflow
+  timer0_overflow_count += us / 1024;
+  SREG = oldSREG;
+  clockRemainder %= 1000;
+#else
+  (void)us;
+#endif
+}
+
+void PowerManager::dump(Print &out) {
+  unsigned long asleep = modeTime[POWER_IDLE] + modeTime[POWER_DOWN];
+  out.print(F("Awake: "));
+  out.print(millis() - asleep);
+  out.print(F(" ms, idle: "));
+  out.print(modeTime[POWER_IDLE]);
+  out.print(F(" ms, power-down: "));
+  out.print(modeTime[POWER_DOWN]);
+  out.println(F(" ms"));
+  out.print(F("Watchdog period: "));
+  out.print(watchdogPeriod);
+  out.println(F(" us"));
+}
@@ -0,0 +1,44 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+#define POWER_WDT_PERIOD 16000UL  // us, nominal shortest watchdog timeout
+#define POWER_WDT_MAX_PRESCALER 9 // 16 ms << 9: the 8 s timeout
+#define POWER_DOWN_MIN 16         // ms, shorter sleeps are spent idle
+
+enum PowerMode : uint8_t { POWER_IDLE, POWER_DOWN, POWER_MODE_COUNT };
+
+// Sleeps the ATmega between scheduled work instead of spinning in delay().
+// Idle only stops the CPU: timers, UARTs and interrupts keep running, so it
+// is safe anywhere. Power-down stops every clock and is timed by the
+// watchdog, whose period begin() measures against Timer0; millis() is then
+// moved forward by the time slept. Only the watchdog and pin interrupts wake
+// it, so the caller must know the console and the modem are quiet.
+class PowerManager {
+private:
+  static volatile bool watchdogFired;
+  unsigned long watchdogPeriod; // us, measured POWER_WDT_PERIOD
+  unsigned long clockRemainder; // us slept not yet added to millis()
+  unsigned long modeTime[POWER_MODE_COUNT]; // ms
+
+  void advanceClock(unsigned long us);
+
+public:
+  PowerManager();
+  static void onWatchdog() { watchdogFired = true; }
+
+  void begin();
+  // Sleeps about ms, powered down if allowed, idle otherwise
+  void sleep(unsigned long ms, bool powerDownAllowed);
+  void idle(unsigned long ms);
+  // Returns the ms slept: less than asked if another interrupt woke the MCU
+  // or if what is left is shorter than one watchdog period
+  unsigned long powerDown(unsigned long ms);
+
+  unsigned long getTime(PowerMode mode) { return modeTime[mode]; }
+  unsigned long getWatchdogPeriod() { return watchdogPeriod; }
+  void dump(Print &out);
+};
+
+#endif // POWER_MANAGER_H
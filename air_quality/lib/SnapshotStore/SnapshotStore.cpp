@@ -0,0 +1,125 @@
+#include "SnapshotStore.h"
+#include <ConfigStore.h>
+#include <EEPROM.h>
+
+struct SnapshotHeader {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t size;
+  uint16_t sequence;
+};
+
+SnapshotStore::SnapshotStore(void *data, uint8_t size, uint8_t version) {
+  this->data = (uint8_t *)data;
+  this->size = size;
+  this->version = version;
+  slotCount = 0;
+  nextSlot = 0;
+  sequence = 0;
+  loaded = false;
+}
+
+int SnapshotStore::slotAddress(uint8_t slot) {
+  return SNAPSHOT_ADDRESS +
+         slot * (sizeof(SnapshotHeader) + size + sizeof(uint16_t));
+}
+
+bool SnapshotStore::readSlot(uint8_t slot, uint16_t &sequence, bool load) {
+  SnapshotHeader header;
+  int address = slotAddress(slot);
+  EEPROM.get(address, header);
+  if (header.magic != SNAPSHOT_MAGIC || header.version != version ||
+      header.size != size) {
+    return false;
+  }
+
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < sizeof(header); i++) {
+    crc = ConfigStore::crc16(crc, ((uint8_t *)&header)[i]);
+  }
+  address += sizeof(header);
+  for (uint8_t i = 0; i < size; i++) {
+    uint8_t value = EEPROM.read(address + i);
+    crc = ConfigStore::crc16(crc, value);
+    if (load) {
+      data[i] = value;
+    }
+  }
+  uint16_t storedCrc;
+  EEPROM.get(address + size, storedCrc);
+  sequence = header.sequence;
+  return crc == storedCrc;
+}
+
+bool SnapshotStore::begin() {
+  int slotSize = slotAddress(1) - slotAddress(0);
+  int count = (EEPROM.length() - SNAPSHOT_ADDRESS) / slotSize;
+  slotCount = count > 255 ? 255 : count;
+
+  // Sequence numbers wrap, so the newest is the one the others are behind
+  uint8_t newest = 0;
+  loaded = false;
+  for (uint8_t slot = 0; slot < slotCount; slot++) {
+    uint16_t slotSequence;
+    if (readSlot(slot, slotSequence, false) &&
+        (!loaded || (int16_t)(slotSequence - sequence) > 0)) {
+      newest = slot;
+      sequence = slotSequence;
+      loaded = true;
+    }
+  }
+
+  if (!loaded) {
+    Serial.println(F("No snapshot in EEPROM, starting cold"));
+    return false;
+  }
+  readSlot(newest, sequence, true);
+  nextSlot = (newest + 1) % slotCount;
+  Serial.print(F("Restored snapshot "));
+  Serial.println(sequence);
+  return true;
+}
+
+void SnapshotStore::save() {
+  if (slotCount == 0) {
+    return;
+  }
+
+  SnapshotHeader header = {SNAPSHOT_MAGIC, version, size, ++sequence};
+  uint16_t crc = 0xFFFF;
+  int address = slotAddress(nextSlot);
+  for (uint8_t i = 0; i < sizeof(header); i++) {
+    uint8_t value = ((uint8_t *)&header)[i];
+    crc = ConfigStore::crc16(crc, value);
+    EEPROM.update(address++, value);
+  }
+  for (uint8_t i = 0; i < size; i++) {
+    crc = ConfigStore::crc16(crc, data[i]);
+    EEPROM.update(address++, data[i]);
+  }
+  // Written last, as in ConfigStore
+  EEPROM.put(address, crc);
+
+  nextSlot = (nextSlot + 1) % slotCount;
+  loaded = true;
+}
+
+void SnapshotStore::clear() {
+  for (uint8_t slot = 0; slot < slotCount; slot++) {
+    EEPROM.update(slotAddress(slot), 0xFF);
+  }
+  loaded = false;
+}
+
+void SnapshotStore::dump(Print &out) {
+  if (!loaded) {
+    out.println(F("No snapshot"));
+    return;
+  }
+  out.print(F("Snapshot "));
+  out.print(sequence);
+  out.print(F(", slot "));
+  out.print((nextSlot + slotCount - 1) % slotCount);
+  out.print(F(" of "));
+  out.println(slotCount);
+}
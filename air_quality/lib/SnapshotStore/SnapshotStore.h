@@ -0,0 +1,47 @@
+#ifndef SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <Arduino.h>
+
+// First slot, leaving room for a settings block of up to 122 bytes at
+// CONFIG_ADDRESS
+#define SNAPSHOT_ADDRESS 128
+#define SNAPSHOT_MAGIC 0x5353 // "SS"
+
+// Warm-restart state kept in EEPROM: filter estimates, calibrations and
+// running histories the node would otherwise spend seconds to hours
+// rebuilding after a watchdog reset or a brown-out. The EEPROM past the
+// settings is split into slots, each holding a header with a sequence
+// number, the node's state struct and a CRC-16 of both. Snapshots go to the
+// slots in turn, which spreads the wear, and begin() loads the newest slot
+// that passes its check: a reset in the middle of a write falls back to the
+// previous snapshot. As with ConfigStore, the version must change whenever
+// the struct does.
+class SnapshotStore {
+private:
+  uint8_t *data;
+  uint8_t size;
+  uint8_t version;
+  uint8_t slotCount;
+  uint8_t nextSlot;
+  uint16_t sequence; // of the newest snapshot written or loaded
+  bool loaded;
+
+  int slotAddress(uint8_t slot);
+  // Checks the slot and returns its sequence number; copies its state into
+  // the struct if load is set
+  bool readSlot(uint8_t slot, uint16_t &sequence, bool load);
+
+public:
+  SnapshotStore(void *data, uint8_t size, uint8_t version);
+  // Loads the newest valid snapshot into the struct; returns false, and
+  // leaves the struct alone, if there is none
+  bool begin();
+  // Writes the struct to the next slot
+  void save();
+  // Invalidates every slot, so the next boot starts cold
+  void clear();
+  void dump(Print &out);
+};
+
+#endif // SNAPSHOT_STORE_H
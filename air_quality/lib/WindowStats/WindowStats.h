@@ -0,0 +1,33 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <Arduino.h>
+
+// Minimum, maximum, mean and standard deviation of the values seen since the
+// last reset, in one pass and a few bytes whatever the number of values:
+// Welford's update keeps the mean and the sum of squared deviations from it,
+// which stays accurate where a sum of squares would cancel out in float.
+class WindowStats {
+private:
+  uint16_t count;
+  float mean;
+  float m2; // sum of squared deviations from the mean
+  float minimum;
+  float maximum;
+
+public:
+  WindowStats() { reset(); }
+  void reset();
+  // NaN is ignored; past 65535 values only the extremes move
+  void add(float value);
+
+  uint16_t getCount() { return count; }
+  // NaN while the window is empty
+  float getMin() { return count ? minimum : NAN; }
+  float getMax() { return count ? maximum : NAN; }
+  float getMean() { return count ? mean : NAN; }
+  // Of the window itself, not an estimate for a larger population
+  float getStdDev();
+};
+
+#endif // WINDOW_STATS_H
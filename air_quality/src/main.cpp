@@ -1,46 +1,239 @@
 #include <Arduino.h>
+#include "ConfigStore.h"
 #include "LoRaManager.h"
+#include "LoopProfiler.h"
+#include "MemoryMonitor.h"
+#include "PowerManager.h"
+#include "SnapshotStore.h"
 #include "AirQuality.h"
 
 #define LORA_RX_PIN 10
 #define LORA_TX_PIN 11
 #define AQI_SENSOR_PIN A0
+#define PARTICLE_SET_PIN 4
+
+#define PROFILE_SAMPLE_RATE 1 // loop() is slow enough to time every pass
+// ms between diagnostic uplinks; memory and loop profile reports alternate
+#define DIAGNOSTIC_INTERVAL 1800000UL
+#define SNAPSHOT_INTERVAL 900000UL // ms between warm-restart snapshots
+
+// uno_lowpower: the modem sleeps between uplinks. The MCU only idles between
+// passes, since the gas sensor ADC and the particle schedule need its clocks.
+#ifdef LOW_POWER
+#define MODEM_SLEEP true
+#else
+#define MODEM_SLEEP false
+#endif
+
+#define SEND_INTERVAL 10000 // ms, default of send_interval
+#define SUMMARY_FRAMES 0    // default of summary: plain data frames
+
+// Site settings, kept in EEPROM and changed with "set <name> <value>"
+#define CONFIG_VERSION 3
+struct NodeConfig
+{
+  uint32_t sendInterval; // ms
+  float pm25Threshold;   // μg/m³
+  float pm10Threshold;   // μg/m³
+  uint32_t minCycle;     // ms, of the HM330X duty cycle
+  uint32_t maxCycle;     // ms
+  uint8_t summaryFrames; // 1 sends the window statistics instead
+};
+const NodeConfig DEFAULT_CONFIG PROGMEM = {SEND_INTERVAL, PM25_THRESHOLD, PM10_THRESHOLD,
+                                           PARTICLE_MIN_CYCLE, PARTICLE_MAX_CYCLE, SUMMARY_FRAMES};
+const ConfigField CONFIG_FIELDS[] PROGMEM = {
+    {"send_interval", offsetof(NodeConfig, sendInterval), CONFIG_UINT32, 5000, 3600000},
+    {"pm25_max", offsetof(NodeConfig, pm25Threshold), CONFIG_FLOAT, 1, 1000},
+    {"pm10_max", offsetof(NodeConfig, pm10Threshold), CONFIG_FLOAT, 1, 1000},
+    {"sample_min", offsetof(NodeConfig, minCycle), CONFIG_UINT32, 15000, 600000},
+    {"sample_max", offsetof(NodeConfig, maxCycle), CONFIG_UINT32, 15000, 3600000},
+    {"summary", offsetof(NodeConfig, summaryFrames), CONFIG_UINT8, 0, 1},
+};
+
+NodeConfig config;
+ConfigStore configStore(&config, sizeof(config), &DEFAULT_CONFIG, CONFIG_FIELDS,
+                        sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]), CONFIG_VERSION);
+
+// PM history and alert state, restored after a reset
+#define SNAPSHOT_VERSION 1
+AirQualitySnapshot snapshot;
+SnapshotStore snapshotStore(&snapshot, sizeof(snapshot), SNAPSHOT_VERSION);
 
 unsigned long lastSendTime = 0;
-const unsigned long SEND_INTERVAL = 10000;
+unsigned long lastSnapshotTime = 0;
 
 LoRaManager loraManager(LORA_RX_PIN, LORA_TX_PIN);
-AirQuality airQuality(AQI_SENSOR_PIN);
+AirQuality airQuality(AQI_SENSOR_PIN, PARTICLE_SET_PIN);
+
+MemoryMonitor memoryMonitor;
+PowerManager powerManager;
+
+unsigned long lastDiagnosticTime = 0;
+uint8_t diagnosticCount = 0;
+
+#ifdef LOOP_PROFILER
+LoopProfiler loopProfiler;
+#endif
+
+// Hands the settings to the objects that keep their own copy
+void applyConfig()
+{
+  airQuality.setThreshold(FIELD_PM25, config.pm25Threshold);
+  airQuality.setThreshold(FIELD_PM10, config.pm10Threshold);
+  airQuality.setParticleCycleLimits(config.minCycle, config.maxCycle);
+}
+
+void saveSnapshot()
+{
+  airQuality.saveSnapshot(snapshot);
+  snapshotStore.save();
+  lastSnapshotTime = millis();
+}
+
+// "config" and "set" manage the site settings, "snapshot" saves the
+// warm-restart state now and "snapshot clear" forgets it, "mem" prints the
+// RAM watermarks and "power" the time spent asleep; with the profiler,
+// "profile" prints the loop histograms and "profile reset" clears them
+bool onConsoleCommand(const char *line)
+{
+  if (configStore.handleCommand(line))
+  {
+    applyConfig();
+    return true;
+  }
+  if (strncmp(line, "snapshot", 8) == 0)
+  {
+    if (strncmp(line + 8, " clear", 6) == 0)
+    {
+      snapshotStore.clear();
+      Serial.println(F("Snapshots cleared"));
+    }
+    else
+    {
+      saveSnapshot();
+    }
+    snapshotStore.dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "mem", 3) == 0)
+  {
+    memoryMonitor.dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "power", 5) == 0)
+  {
+    powerManager.dump(Serial);
+    return true;
+  }
+#ifdef LOOP_PROFILER
+  if (strncmp(line, "profile", 7) == 0)
+  {
+    if (strncmp(line + 7, " reset", 6) == 0)
+    {
+      loopProfiler.reset();
+      Serial.println(F("Profile cleared"));
+    }
+    else
+    {
+      loopProfiler.dump(Serial);
+    }
+    return true;
+  }
+#endif
+  return false;
+}
+
+void sendDiagnostics()
+{
+  // Odd slots carry the loop profile, or nothing without the profiler, so
+  // memory reports are hourly either way
+  if (diagnosticCount++ % 2)
+  {
+#ifdef LOOP_PROFILER
+    uint8_t payload[PROFILE_REPORT_MAX];
+    uint8_t length = loopProfiler.buildReport(payload, sizeof(payload));
+    loraManager.sendPayload(PROFILE_PORT, payload, length);
+    loopProfiler.reset();
+#endif
+    return;
+  }
+
+  uint8_t payload[MEMORY_REPORT_SIZE];
+  memoryMonitor.sample();
+  loraManager.sendPayload(MEMORY_PORT, payload, memoryMonitor.buildReport(payload));
+}
 
 void setup()
 {
   Serial.begin(9600);
+  configStore.begin();
+  applyConfig();
   Serial.println(F("Starting Air Quality Monitoring System"));
 
   if (!airQuality.begin())
     Serial.println(F("Failed to initialize air quality sensors!"));
+  if (snapshotStore.begin())
+    airQuality.restoreSnapshot(snapshot);
 
   loraManager.begin();
+  loraManager.setCommandHandler(onConsoleCommand);
+  loraManager.setModemSleep(MODEM_SLEEP);
+  powerManager.begin();
+#ifdef LOOP_PROFILER
+  loopProfiler.begin(PROFILE_SAMPLE_RATE);
+#endif
   Serial.println(F("Setup completed"));
 }
 
 void loop()
 {
-  if (airQuality.readSensors())
   {
-    loraManager.handleLoRaMessages();
-    loraManager.processSerialCommands();
-
-    unsigned long currentTime = millis();
-    if ((currentTime - lastSendTime >= SEND_INTERVAL) && loraManager.isNetworkJoined())
+    // Timed without the sleep below
+    PROFILE_LOOP();
+    if (airQuality.readSensors())
     {
-      lastSendTime = currentTime;
-      loraManager.sendAirQualityData(
-          airQuality.getPM2_5(),
-          airQuality.getPM10(),
-          airQuality.getAqiValue(),
-          airQuality.getAlertState());
+      loraManager.handleLoRaMessages();
+      loraManager.processSerialCommands();
+
+      unsigned long currentTime = millis();
+      memoryMonitor.update(currentTime);
+      if ((currentTime - lastSendTime >= config.sendInterval) && loraManager.isNetworkJoined())
+      {
+        PROFILE_EVENT(PROFILE_STAGE_UPLINK);
+        lastSendTime = currentTime;
+        if (config.summaryFrames)
+        {
+          uint8_t payload[AIR_QUALITY_SUMMARY_SIZE];
+          loraManager.sendPayload(SUMMARY_PORT, payload, airQuality.buildSummary(payload));
+        }
+        else
+        {
+          loraManager.sendAirQualityData(
+              airQuality.getPM2_5(),
+              airQuality.getPM10(),
+              airQuality.getAqiValue(),
+              airQuality.getAlertState(),
+              airQuality.getNowCastPM2_5(),
+              airQuality.getNowCastPM10(),
+              airQuality.getDayMeanPM2_5(),
+              airQuality.getDayMeanPM10(),
+              airQuality.getAqiCategory());
+        }
+        airQuality.resetWindow();
+      }
+
+      // Midway between two data uplinks, so both fit the duty cycle
+      if (currentTime - lastDiagnosticTime >= DIAGNOSTIC_INTERVAL &&
+          currentTime - lastSendTime >= config.sendInterval / 2 &&
+          loraManager.isNetworkJoined())
+      {
+        lastDiagnosticTime = currentTime;
+        sendDiagnostics();
+      }
+
+      if (currentTime - lastSnapshotTime >= SNAPSHOT_INTERVAL)
+        saveSnapshot();
     }
   }
-  delay(100);
-}
\ No newline at end of file
+  powerManager.idle(100);
+}
@@ -0,0 +1,141 @@
+#include <Air_Quality_Sensor.h>
+#include <ArduinoHost.h>
+#include <GasSensorAdc.h>
+#include <unity.h>
+
+#define AQI_PIN A0
+#define LOOP_STEP 100 // ms, as the node's loop
+
+// Gas sensor output recorded once a second (TRACE aqi), 10-bit units: clean
+// air, a pollution episode, then a strong signal
+static const uint16_t RECORDED[] = {
+    121, 120, 119, 121, 122, 120, 118, 120, 121, 120, 119, 120, 122, 121,
+    120, 250, 390, 402, 398, 401, 399, 400, 403, 397, 400, 401, 398, 720,
+    735, 731, 728, 400, 399, 401, 120, 121, 119, 120, 118, 121};
+#define RECORDED_COUNT (sizeof(RECORDED) / sizeof(RECORDED[0]))
+
+static GasSensorAdc *adc;
+
+// Runs the node's 100 ms loop for `duration` ms with the input held
+static void runFor(unsigned long duration)
+{
+    for (unsigned long t = 0; t < duration; t += LOOP_STEP)
+    {
+        ArduinoHost::advanceMillis(LOOP_STEP);
+        adc->update(millis());
+    }
+}
+
+void setUp()
+{
+    ArduinoHost::reset();
+    ArduinoHost::setAnalog(AQI_PIN, 120);
+    static GasSensorAdc instance;
+    instance = GasSensorAdc();
+    adc = &instance;
+}
+
+void tearDown() {}
+
+void test_begin_checks_the_sensor()
+{
+    TEST_ASSERT_TRUE(adc->begin(AQI_PIN));
+    TEST_ASSERT_EQUAL(120, adc->getValue());
+    ArduinoHost::setAnalog(AQI_PIN, 0);
+    TEST_ASSERT_FALSE(adc->begin(AQI_PIN));
+    ArduinoHost::setAnalog(AQI_PIN, 1023);
+    TEST_ASSERT_FALSE(adc->begin(AQI_PIN));
+}
+
+// Conversions follow the Timer1 rate: the ring is refreshed once a second,
+// whatever the loop does
+void test_ring_spans_one_second()
+{
+    adc->begin(AQI_PIN);
+    ArduinoHost::setAnalog(AQI_PIN, 200);
+    runFor(500);
+    TEST_ASSERT_FLOAT_WITHIN(1, 160, adc->getVoltage());
+    runFor(500);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 200, adc->getVoltage());
+
+    // One late update catches up on the conversions it missed
+    ArduinoHost::setAnalog(AQI_PIN, 300);
+    ArduinoHost::advanceMillis(1000);
+    adc->update(millis());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 300, adc->getVoltage());
+}
+
+// Decimation keeps the fraction a single 10-bit read loses
+void test_oversampling_resolves_below_one_lsb()
+{
+    adc->begin(AQI_PIN);
+    for (uint16_t i = 0; i < AQI_ADC_DECIMATION * AQI_ADC_RING_SIZE; i++)
+        GasSensorAdc::onConversion(i % 4 == 0 ? 301 : 300);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 300.25, adc->getVoltage());
+}
+
+void test_noise_is_averaged_out()
+{
+    adc->begin(AQI_PIN);
+    uint32_t seed = 7;
+    for (uint16_t i = 0; i < AQI_ADC_DECIMATION * AQI_ADC_RING_SIZE; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        GasSensorAdc::onConversion(250 + (int)((seed >> 16) % 17) - 8);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 250, adc->getVoltage());
+}
+
+void test_slope_keeps_a_one_second_pace()
+{
+    adc->begin(AQI_PIN);
+    runFor(2000);
+    TEST_ASSERT_EQUAL(AirQualitySensor::FRESH_AIR, adc->slope());
+    ArduinoHost::setAnalog(AQI_PIN, 800);
+    runFor(900);
+    TEST_ASSERT_EQUAL(AirQualitySensor::FRESH_AIR, adc->slope());
+    runFor(1100);
+    TEST_ASSERT_EQUAL(AirQualitySensor::FORCE_SIGNAL, adc->slope());
+}
+
+// Replays the recorded stream and checks the classification of each episode
+void test_recorded_stream()
+{
+    adc->begin(AQI_PIN);
+    int worst[RECORDED_COUNT];
+    for (uint8_t i = 0; i < RECORDED_COUNT; i++)
+    {
+        ArduinoHost::setAnalog(AQI_PIN, RECORDED[i]);
+        worst[i] = AirQualitySensor::FRESH_AIR;
+        for (uint8_t step = 0; step < 1000 / LOOP_STEP; step++)
+        {
+            ArduinoHost::advanceMillis(LOOP_STEP);
+            adc->update(millis());
+            if (adc->slope() < worst[i])
+                worst[i] = adc->slope();
+        }
+    }
+
+    // Clean air: sensor noise alone never leaves FRESH_AIR
+    for (uint8_t i = 0; i < 15; i++)
+        TEST_ASSERT_EQUAL(AirQualitySensor::FRESH_AIR, worst[i]);
+    // The episode is seen as high pollution, 280 units over the baseline
+    for (uint8_t i = 17; i < 27; i++)
+        TEST_ASSERT_EQUAL(AirQualitySensor::HIGH_POLLUTION, worst[i]);
+    for (uint8_t i = 28; i < 31; i++)
+        TEST_ASSERT_EQUAL(AirQualitySensor::FORCE_SIGNAL, worst[i]);
+    TEST_ASSERT_EQUAL(AirQualitySensor::FRESH_AIR, worst[RECORDED_COUNT - 1]);
+    TEST_ASSERT_EQUAL(RECORDED[RECORDED_COUNT - 1], adc->getValue());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_checks_the_sensor);
+    RUN_TEST(test_ring_spans_one_second);
+    RUN_TEST(test_oversampling_resolves_below_one_lsb);
+    RUN_TEST(test_noise_is_averaged_out);
+    RUN_TEST(test_slope_keeps_a_one_second_pace);
+    RUN_TEST(test_recorded_stream);
+    return UNITY_END();
+}
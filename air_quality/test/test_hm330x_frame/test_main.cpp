@@ -0,0 +1,216 @@
+#include <AirQuality.h>
+#include <ArduinoHost.h>
+#include <HM330XFrame.h>
+#include <string.h>
+#include <unity.h>
+
+// PM1.0 10, PM2.5 12, PM10 20 (standard), 9/11/18 (atmospheric), then the six
+// particle counts
+static const uint8_t FRAME[HM330X_FRAME_SIZE] = {
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x0A, 0x00, 0x0C, 0x00, 0x14, 0x00,
+    0x09, 0x00, 0x0B, 0x00, 0x12, 0x04, 0xD2, 0x01, 0x2C, 0x00, 0x64,
+    0x00, 0x0A, 0x00, 0x02, 0x00, 0x01, 0x00};
+
+static uint8_t buffer[HM330X_FRAME_SIZE + 1];
+
+// HM330X on the I2C bus, answering with `buffer` cut to `length` bytes
+class FrameSource : public ArduinoHost::I2cDevice
+{
+public:
+    size_t length = HM330X_FRAME_SIZE;
+
+    void receive(const uint8_t *data, size_t length)
+    {
+        (void)data;
+        (void)length;
+    }
+    size_t request(uint8_t *out, size_t requested)
+    {
+        size_t count = requested < length ? requested : length;
+        memcpy(out, buffer, count);
+        return count;
+    }
+};
+
+static FrameSource source;
+
+static void sealChecksum(uint8_t *frame)
+{
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < HM330X_FRAME_SIZE - 1; i++)
+    {
+        sum += frame[i];
+    }
+    frame[HM330X_FRAME_SIZE - 1] = sum;
+}
+
+// Deterministic byte stream for the fuzz cases
+static uint32_t seed;
+
+static uint8_t nextByte()
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+void setUp()
+{
+    memcpy(buffer, FRAME, HM330X_FRAME_SIZE);
+    sealChecksum(buffer);
+    seed = 1;
+}
+
+void tearDown() {}
+
+void test_fields_are_big_endian()
+{
+    const HM330XFrame *frame = HM330XFrame::view(buffer);
+    TEST_ASSERT_TRUE(frame->isValid());
+    TEST_ASSERT_EQUAL_UINT16(1, frame->sensorNumber);
+    TEST_ASSERT_EQUAL_UINT16(10, frame->pm1_0Standard);
+    TEST_ASSERT_EQUAL_UINT16(12, frame->pm2_5Standard);
+    TEST_ASSERT_EQUAL_UINT16(20, frame->pm10Standard);
+    TEST_ASSERT_EQUAL_UINT16(9, frame->pm1_0Atmospheric);
+    TEST_ASSERT_EQUAL_UINT16(11, frame->pm2_5Atmospheric);
+    TEST_ASSERT_EQUAL_UINT16(18, frame->pm10Atmospheric);
+    TEST_ASSERT_EQUAL_UINT16(1234, frame->count0_3um);
+    TEST_ASSERT_EQUAL_UINT16(300, frame->count0_5um);
+    TEST_ASSERT_EQUAL_UINT16(100, frame->count1_0um);
+    TEST_ASSERT_EQUAL_UINT16(10, frame->count2_5um);
+    TEST_ASSERT_EQUAL_UINT16(2, frame->count5_0um);
+    TEST_ASSERT_EQUAL_UINT16(1, frame->count10um);
+}
+
+void test_view_does_not_copy()
+{
+    const HM330XFrame *frame = HM330XFrame::view(buffer);
+    TEST_ASSERT_TRUE((const void *)frame == (const void *)buffer);
+    buffer[7] = 0x0D;
+    TEST_ASSERT_EQUAL_UINT16(13, frame->pm2_5Standard);
+}
+
+void test_unaligned_view()
+{
+    memmove(buffer + 1, buffer, HM330X_FRAME_SIZE);
+    const HM330XFrame *frame = HM330XFrame::view(buffer + 1);
+    TEST_ASSERT_TRUE(frame->isValid());
+    TEST_ASSERT_EQUAL_UINT16(20, frame->pm10Standard);
+}
+
+void test_checksum_mismatch()
+{
+    buffer[HM330X_FRAME_SIZE - 1]++;
+    TEST_ASSERT_FALSE(HM330XFrame::view(buffer)->isValid());
+}
+
+void test_all_zero_frame()
+{
+    memset(buffer, 0, HM330X_FRAME_SIZE);
+    TEST_ASSERT_FALSE(HM330XFrame::view(buffer)->isValid());
+}
+
+void test_every_single_bit_flip()
+{
+    for (uint8_t i = 0; i < HM330X_FRAME_SIZE; i++)
+    {
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            buffer[i] ^= 1 << bit;
+            TEST_ASSERT_FALSE(HM330XFrame::view(buffer)->isValid());
+            buffer[i] ^= 1 << bit;
+        }
+    }
+}
+
+// A short bus read leaves the rest of a cleared buffer at zero
+void test_truncated_frames()
+{
+    uint8_t truncated[HM330X_FRAME_SIZE];
+    for (uint8_t length = 0; length < HM330X_FRAME_SIZE; length++)
+    {
+        memset(truncated, 0, sizeof(truncated));
+        memcpy(truncated, buffer, length);
+        TEST_ASSERT_FALSE(HM330XFrame::view(truncated)->isValid());
+    }
+}
+
+// Random buffers pass exactly when they are not all zero and their sum
+// matches, the last byte being forced right on every other one
+void test_fuzz_random_frames()
+{
+    uint16_t valid = 0;
+    for (uint16_t round = 0; round < 10000; round++)
+    {
+        uint8_t sum = 0;
+        uint8_t any = 0;
+        for (uint8_t i = 0; i < HM330X_FRAME_SIZE; i++)
+        {
+            buffer[i] = round % 4 == 0 ? nextByte() & 0x01 : nextByte();
+        }
+        if (round % 2)
+        {
+            sealChecksum(buffer);
+        }
+        for (uint8_t i = 0; i < HM330X_FRAME_SIZE - 1; i++)
+        {
+            sum += buffer[i];
+            any |= buffer[i];
+        }
+        bool expected = any != 0 && sum == buffer[HM330X_FRAME_SIZE - 1];
+        TEST_ASSERT_EQUAL(expected, HM330XFrame::view(buffer)->isValid());
+        valid += expected;
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(5000, valid);
+}
+
+// Through AirQuality in continuous mode: every bad read is counted and
+// keeps the last good values
+void test_air_quality_counts_bad_frames()
+{
+    ArduinoHost::setSerialOutput(false);
+    ArduinoHost::attachI2cDevice(0x40, &source);
+    AirQuality airQuality(A0, 4);
+    airQuality.begin();
+    airQuality.setDutyCycling(false);
+
+    airQuality.readSensors();
+    TEST_ASSERT_EQUAL_UINT16(0, airQuality.getFrameErrors());
+    TEST_ASSERT_EQUAL_UINT16(12, airQuality.getPM2_5());
+    TEST_ASSERT_NOT_NULL(airQuality.getParticleFrame());
+
+    buffer[8] = 0x02;
+    TEST_ASSERT_FALSE(airQuality.readSensors());
+    TEST_ASSERT_NULL(airQuality.getParticleFrame());
+
+    memset(buffer, 0, HM330X_FRAME_SIZE);
+    TEST_ASSERT_FALSE(airQuality.readSensors());
+
+    setUp();
+    source.length = 20;
+    TEST_ASSERT_FALSE(airQuality.readSensors());
+    source.length = HM330X_FRAME_SIZE;
+
+    TEST_ASSERT_EQUAL_UINT16(3, airQuality.getFrameErrors());
+    TEST_ASSERT_EQUAL_UINT16(12, airQuality.getPM2_5());
+    TEST_ASSERT_EQUAL_UINT16(20, airQuality.getPM10());
+
+    buffer[7] = 30;
+    sealChecksum(buffer);
+    TEST_ASSERT_TRUE(airQuality.readSensors());
+    TEST_ASSERT_EQUAL_UINT16(30, airQuality.getPM2_5());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fields_are_big_endian);
+    RUN_TEST(test_view_does_not_copy);
+    RUN_TEST(test_unaligned_view);
+    RUN_TEST(test_checksum_mismatch);
+    RUN_TEST(test_all_zero_frame);
+    RUN_TEST(test_every_single_bit_flip);
+    RUN_TEST(test_truncated_frames);
+    RUN_TEST(test_fuzz_random_frames);
+    RUN_TEST(test_air_quality_counts_bad_frames);
+    return UNITY_END();
+}
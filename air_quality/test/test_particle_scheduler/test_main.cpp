@@ -0,0 +1,168 @@
+#include <ParticleScheduler.h>
+#include <unity.h>
+
+#define LOOP_STEP 100 // ms, as the node's loop
+
+struct Action
+{
+    unsigned long time;
+    ParticleAction action;
+};
+
+static Action actions[64];
+static uint8_t actionCount;
+
+// Steps the scheduler from `from` to `to` and records every non-idle action
+static void run(ParticleScheduler &scheduler, unsigned long from, unsigned long to)
+{
+    actionCount = 0;
+    for (unsigned long now = from; now != to; now += LOOP_STEP)
+    {
+        ParticleAction action = scheduler.update(now);
+        if (action != PARTICLE_IDLE && actionCount < 64)
+            actions[actionCount++] = {now, action};
+    }
+}
+
+void setUp() { actionCount = 0; }
+
+void tearDown() {}
+
+void test_first_cycle_starts_at_once()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(5000);
+    TEST_ASSERT_EQUAL(PARTICLE_WAKE, scheduler.update(5000));
+    TEST_ASSERT_EQUAL(PARTICLE_WARMING_UP, scheduler.getPhase());
+}
+
+void test_warm_up_then_burst_then_sleep()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    run(scheduler, 0, 60000);
+
+    TEST_ASSERT_EQUAL(1 + PARTICLE_BURST_SAMPLES, actionCount);
+    TEST_ASSERT_EQUAL(PARTICLE_WAKE, actions[0].action);
+    TEST_ASSERT_EQUAL(0, actions[0].time);
+    for (uint8_t i = 0; i < PARTICLE_BURST_SAMPLES; i++)
+    {
+        TEST_ASSERT_EQUAL(PARTICLE_WARMUP_MS + i * PARTICLE_BURST_INTERVAL, actions[1 + i].time);
+        TEST_ASSERT_EQUAL(i + 1 < PARTICLE_BURST_SAMPLES ? PARTICLE_READ : PARTICLE_READ_LAST,
+                          actions[1 + i].action);
+    }
+    TEST_ASSERT_EQUAL(PARTICLE_SLEEPING, scheduler.getPhase());
+}
+
+void test_cycles_keep_their_period()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    run(scheduler, 0, 3 * PARTICLE_CYCLE_MS + LOOP_STEP);
+
+    uint8_t wakes = 0;
+    for (uint8_t i = 0; i < actionCount; i++)
+    {
+        if (actions[i].action == PARTICLE_WAKE)
+        {
+            TEST_ASSERT_EQUAL(wakes * PARTICLE_CYCLE_MS, actions[i].time);
+            wakes++;
+        }
+    }
+    TEST_ASSERT_EQUAL(4, wakes);
+}
+
+void test_missed_cycles_are_skipped()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    run(scheduler, 0, 20000);
+    // The loop stalls for two and a half cycles: one late cycle, from 120 s
+    TEST_ASSERT_EQUAL(PARTICLE_WAKE, scheduler.update(170000));
+    run(scheduler, 170100, 184100);
+    TEST_ASSERT_EQUAL(PARTICLE_BURST_SAMPLES, actionCount);
+    TEST_ASSERT_EQUAL(PARTICLE_READ_LAST, actions[actionCount - 1].action);
+    // The 180 s cycle starts late too, then the grid is back
+    run(scheduler, 184100, 240000 + LOOP_STEP);
+    TEST_ASSERT_EQUAL(PARTICLE_WAKE, actions[0].action);
+    TEST_ASSERT_EQUAL(184100, actions[0].time);
+    TEST_ASSERT_EQUAL(PARTICLE_WAKE, actions[actionCount - 1].action);
+    TEST_ASSERT_EQUAL(240000, actions[actionCount - 1].time);
+}
+
+void test_late_reads_keep_the_burst_cadence()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    scheduler.update(0);
+    TEST_ASSERT_EQUAL(PARTICLE_READ, scheduler.update(10000));
+    TEST_ASSERT_EQUAL(PARTICLE_IDLE, scheduler.update(10999));
+    TEST_ASSERT_EQUAL(PARTICLE_READ, scheduler.update(11300));
+    // Due at 12000 whatever the lateness of the previous read
+    TEST_ASSERT_EQUAL(PARTICLE_IDLE, scheduler.update(11999));
+    TEST_ASSERT_EQUAL(PARTICLE_READ, scheduler.update(12000));
+}
+
+void test_cycle_time_change()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    run(scheduler, 0, 20000);
+    scheduler.setCycleTime(30000);
+    run(scheduler, 20000, 60000 + LOOP_STEP);
+    TEST_ASSERT_EQUAL(PARTICLE_WAKE, actions[0].action);
+    TEST_ASSERT_EQUAL(30000, actions[0].time);
+}
+
+void test_duty_ratio_and_energy()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    run(scheduler, 0, 10 * PARTICLE_CYCLE_MS);
+
+    // Awake from the wake-up to the last read of each burst
+    const float awake = PARTICLE_WARMUP_MS + (PARTICLE_BURST_SAMPLES - 1) * PARTICLE_BURST_INTERVAL;
+    const float duty = awake / PARTICLE_CYCLE_MS;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, duty, scheduler.getDutyRatio(10 * PARTICLE_CYCLE_MS));
+
+    float power = duty * HM330X_ACTIVE_MW + (1 - duty) * HM330X_SLEEP_MW;
+    TEST_ASSERT_FLOAT_WITHIN(0.5, power * PARTICLE_CYCLE_MS / 1000,
+                             scheduler.estimateEnergyPerSample(10 * PARTICLE_CYCLE_MS));
+    // Always on, as without duty cycling: 375 mW over a whole cycle
+    TEST_ASSERT_LESS_THAN(HM330X_ACTIVE_MW * PARTICLE_CYCLE_MS / 1000 / 3,
+                          scheduler.estimateEnergyPerSample(10 * PARTICLE_CYCLE_MS));
+}
+
+void test_duty_ratio_counts_the_running_cycle()
+{
+    ParticleScheduler scheduler;
+    scheduler.start(0);
+    run(scheduler, 0, 5000);
+    // Still warming up: awake all along
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 1.0, scheduler.getDutyRatio(4900));
+}
+
+void test_across_millis_wrap()
+{
+    ParticleScheduler scheduler;
+    unsigned long start = ~0UL - 30000;
+    scheduler.start(start);
+    run(scheduler, start, start + 2 * PARTICLE_CYCLE_MS);
+    TEST_ASSERT_EQUAL(2 * (1 + PARTICLE_BURST_SAMPLES), actionCount);
+    TEST_ASSERT_EQUAL(start + PARTICLE_CYCLE_MS, actions[1 + PARTICLE_BURST_SAMPLES].time);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_cycle_starts_at_once);
+    RUN_TEST(test_warm_up_then_burst_then_sleep);
+    RUN_TEST(test_cycles_keep_their_period);
+    RUN_TEST(test_missed_cycles_are_skipped);
+    RUN_TEST(test_late_reads_keep_the_burst_cadence);
+    RUN_TEST(test_cycle_time_change);
+    RUN_TEST(test_duty_ratio_and_energy);
+    RUN_TEST(test_duty_ratio_counts_the_running_cycle);
+    RUN_TEST(test_across_millis_wrap);
+    return UNITY_END();
+}
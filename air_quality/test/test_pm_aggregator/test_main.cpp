@@ -0,0 +1,227 @@
+#include <PMAggregator.h>
+#include <math.h>
+#include <unity.h>
+
+static PMAggregator aggregator;
+static unsigned long clock;
+static uint8_t carried; // samples of the running hour already added
+
+// One sample a minute for an hour
+static void feedHour(uint16_t pm2_5, uint16_t pm10)
+{
+    for (uint8_t minute = carried; minute < 60; minute++)
+    {
+        aggregator.addSample(pm2_5, pm10, clock);
+        clock += 60000;
+    }
+    carried = 0;
+}
+
+// Closes the last hour fed with the first sample of the next one
+static void closeRunningHour(uint16_t pm2_5 = 0, uint16_t pm10 = 0)
+{
+    aggregator.addSample(pm2_5, pm10, clock);
+    clock += 60000;
+    carried = 1;
+}
+
+// EPA NowCast over hourly means in 0.1 ug/m3, newest first, -1 for a gap
+static double referenceNowCast(const int *hours, uint8_t count)
+{
+    double minValue = 1e9;
+    double maxValue = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (hours[i] < 0)
+            continue;
+        minValue = fmin(minValue, hours[i]);
+        maxValue = fmax(maxValue, hours[i]);
+    }
+    double weight = maxValue > 0 ? fmax(minValue / maxValue, 0.5) : 1.0;
+    double sum = 0;
+    double total = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (hours[i] >= 0)
+        {
+            sum += pow(weight, i) * hours[i];
+            total += pow(weight, i);
+        }
+    }
+    return sum / total;
+}
+
+void setUp()
+{
+    aggregator = PMAggregator();
+    clock = 0;
+    carried = 0;
+}
+
+void tearDown() {}
+
+void test_no_nowcast_before_two_hours()
+{
+    feedHour(120, 200);
+    TEST_ASSERT_EQUAL_UINT16(PM_NO_DATA, aggregator.getNowCast(PM_CHANNEL_2_5));
+    closeRunningHour(120, 200);
+    TEST_ASSERT_EQUAL_UINT16(PM_NO_DATA, aggregator.getNowCast(PM_CHANNEL_2_5));
+    TEST_ASSERT_EQUAL_UINT8(AQI_CATEGORY_NONE, aggregator.getAqiCategory());
+    feedHour(120, 200);
+    closeRunningHour();
+    TEST_ASSERT_EQUAL_UINT16(1200, aggregator.getNowCast(PM_CHANNEL_2_5));
+    TEST_ASSERT_EQUAL_UINT16(2000, aggregator.getNowCast(PM_CHANNEL_10));
+}
+
+void test_nowcast_weight_is_clamped()
+{
+    feedHour(10, 10);
+    feedHour(40, 40);
+    closeRunningHour();
+    // min/max = 0.25 -> 0.5: (400 + 0.5 * 100) / 1.5
+    TEST_ASSERT_EQUAL_UINT16(300, aggregator.getNowCast(PM_CHANNEL_2_5));
+}
+
+void test_nowcast_matches_reference()
+{
+    static const uint16_t SERIES[] = {12, 15, 20, 35, 60, 55, 41, 30, 22, 18, 16, 14, 13, 25};
+    const uint8_t count = sizeof(SERIES) / sizeof(SERIES[0]);
+    int hours[NOWCAST_HOURS];
+    for (uint8_t h = 0; h < count; h++)
+    {
+        feedHour(SERIES[h], SERIES[h] * 2);
+        uint16_t next = h + 1 < count ? SERIES[h + 1] : 0;
+        closeRunningHour(next, next * 2);
+        if (h < 2)
+            continue;
+        uint8_t used = h + 1 < NOWCAST_HOURS ? h + 1 : NOWCAST_HOURS;
+        for (uint8_t i = 0; i < used; i++)
+            hours[i] = SERIES[h - i] * 10;
+        TEST_ASSERT_FLOAT_WITHIN(0.5, referenceNowCast(hours, used),
+                                 aggregator.getNowCast(PM_CHANNEL_2_5));
+    }
+}
+
+void test_gap_hours_are_skipped()
+{
+    feedHour(30, 30);
+    clock += 2 * PM_HOUR_MS; // two hours without a sample
+    feedHour(20, 20);
+    feedHour(20, 20);
+    closeRunningHour();
+    int hours[] = {200, 200, -1, -1, 300};
+    TEST_ASSERT_FLOAT_WITHIN(0.5, referenceNowCast(hours, 5),
+                             aggregator.getNowCast(PM_CHANNEL_2_5));
+}
+
+void test_nowcast_needs_two_of_three_recent_hours()
+{
+    feedHour(30, 30);
+    feedHour(30, 30);
+    clock += 2 * PM_HOUR_MS;
+    feedHour(30, 30);
+    closeRunningHour();
+    TEST_ASSERT_EQUAL_UINT16(PM_NO_DATA, aggregator.getNowCast(PM_CHANNEL_2_5));
+}
+
+void test_day_mean_completeness_and_eviction()
+{
+    for (uint8_t h = 0; h < PM_DAY_MIN_HOURS - 1; h++)
+        feedHour(10, 20);
+    closeRunningHour(28, 56);
+    TEST_ASSERT_EQUAL_UINT16(PM_NO_DATA, aggregator.getDayMean(PM_CHANNEL_2_5));
+
+    feedHour(28, 56);
+    closeRunningHour(50, 80);
+    // 17 hours at 10 and one at 28
+    TEST_ASSERT_EQUAL_UINT16((17 * 100 + 280 + 9) / 18,
+                             aggregator.getDayMean(PM_CHANNEL_2_5));
+
+    // A full day later only the newest 24 hours count
+    for (uint8_t h = 0; h < PM_DAY_HOURS; h++)
+        feedHour(50, 80);
+    closeRunningHour();
+    TEST_ASSERT_EQUAL_UINT16(500, aggregator.getDayMean(PM_CHANNEL_2_5));
+    TEST_ASSERT_EQUAL_UINT16(800, aggregator.getDayMean(PM_CHANNEL_10));
+}
+
+void test_pm25_breakpoints()
+{
+    static const uint16_t UPPER[] = {90, 354, 554, 1254, 2254};
+    TEST_ASSERT_EQUAL_UINT8(AQI_CATEGORY_GOOD, PMAggregator::categoryFor(PM_CHANNEL_2_5, 0));
+    for (uint8_t category = 0; category < 5; category++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(category, PMAggregator::categoryFor(PM_CHANNEL_2_5, UPPER[category]));
+        TEST_ASSERT_EQUAL_UINT8(category + 1,
+                                PMAggregator::categoryFor(PM_CHANNEL_2_5, UPPER[category] + 1));
+    }
+    TEST_ASSERT_EQUAL_UINT8(AQI_CATEGORY_HAZARDOUS, PMAggregator::categoryFor(PM_CHANNEL_2_5, 0xFFFE));
+    TEST_ASSERT_EQUAL_UINT8(AQI_CATEGORY_NONE, PMAggregator::categoryFor(PM_CHANNEL_2_5, PM_NO_DATA));
+}
+
+void test_pm10_breakpoints_truncate_to_whole_units()
+{
+    static const uint16_t UPPER[] = {540, 1540, 2540, 3540, 4240};
+    for (uint8_t category = 0; category < 5; category++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(category, PMAggregator::categoryFor(PM_CHANNEL_10, UPPER[category]));
+        TEST_ASSERT_EQUAL_UINT8(category, PMAggregator::categoryFor(PM_CHANNEL_10, UPPER[category] + 9));
+        TEST_ASSERT_EQUAL_UINT8(category + 1,
+                                PMAggregator::categoryFor(PM_CHANNEL_10, UPPER[category] + 10));
+    }
+}
+
+void test_aqi_category_is_the_worse_channel()
+{
+    feedHour(10, 100);
+    feedHour(10, 100);
+    closeRunningHour(60, 20);
+    // PM10 NowCast 100 ug/m3
+    TEST_ASSERT_EQUAL_UINT8(AQI_CATEGORY_MODERATE, aggregator.getAqiCategory());
+    feedHour(60, 20);
+    feedHour(60, 20);
+    closeRunningHour();
+    // PM2.5 NowCast 50 ug/m3, PM10 36 ug/m3
+    TEST_ASSERT_EQUAL_UINT8(AQI_CATEGORY_SENSITIVE, aggregator.getAqiCategory());
+}
+
+void test_snapshot_round_trip()
+{
+    for (uint8_t h = 0; h < 20; h++)
+        feedHour(10 + h, 30 + h);
+    aggregator.addSample(99, 99, clock);
+
+    PMSnapshot snapshot;
+    aggregator.saveSnapshot(snapshot, clock + 1000);
+    PMAggregator restored;
+    restored.restoreSnapshot(snapshot, 500000);
+
+    TEST_ASSERT_EQUAL_UINT16(aggregator.getNowCast(PM_CHANNEL_2_5), restored.getNowCast(PM_CHANNEL_2_5));
+    TEST_ASSERT_EQUAL_UINT16(aggregator.getDayMean(PM_CHANNEL_10), restored.getDayMean(PM_CHANNEL_10));
+    // The running hour resumes 1 s in: neither closes it 1 ms before its
+    // end, both do at its end, with the same sum
+    aggregator.addSample(99, 99, clock + PM_HOUR_MS - 1);
+    restored.addSample(99, 99, 500000 - 1000 + PM_HOUR_MS - 1);
+    uint16_t before = restored.getNowCast(PM_CHANNEL_2_5);
+    TEST_ASSERT_EQUAL_UINT16(aggregator.getNowCast(PM_CHANNEL_2_5), before);
+    aggregator.addSample(0, 0, clock + PM_HOUR_MS);
+    restored.addSample(0, 0, 500000 - 1000 + PM_HOUR_MS);
+    TEST_ASSERT_NOT_EQUAL(before, restored.getNowCast(PM_CHANNEL_2_5));
+    TEST_ASSERT_EQUAL_UINT16(aggregator.getNowCast(PM_CHANNEL_2_5), restored.getNowCast(PM_CHANNEL_2_5));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_nowcast_before_two_hours);
+    RUN_TEST(test_nowcast_weight_is_clamped);
+    RUN_TEST(test_nowcast_matches_reference);
+    RUN_TEST(test_gap_hours_are_skipped);
+    RUN_TEST(test_nowcast_needs_two_of_three_recent_hours);
+    RUN_TEST(test_day_mean_completeness_and_eviction);
+    RUN_TEST(test_pm25_breakpoints);
+    RUN_TEST(test_pm10_breakpoints_truncate_to_whole_units);
+    RUN_TEST(test_aqi_category_is_the_worse_channel);
+    RUN_TEST(test_snapshot_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,6 @@
+#ifndef _ADAFRUIT_SENSOR_H
+#define _ADAFRUIT_SENSOR_H
+
+// Unified sensor types are not used by the nodes; present for the include.
+
+#endif // _ADAFRUIT_SENSOR_H
@@ -0,0 +1,49 @@
+#include "Air_Quality_Sensor.h"
+
+const int AirQualitySensor::FORCE_SIGNAL = 0;
+const int AirQualitySensor::HIGH_POLLUTION = 1;
+const int AirQualitySensor::LOW_POLLUTION = 2;
+const int AirQualitySensor::FRESH_AIR = 3;
+
+AirQualitySensor::AirQualitySensor(int pin) : _pin(pin) {
+  _lastVoltage = 0;
+  _currentVoltage = 0;
+  _standardVoltage = 0;
+  _voltageSum = 0;
+  _volSumCount = 0;
+}
+
+bool AirQualitySensor::init(void) {
+  // Same plausibility window as the Seeed driver
+  int initVoltage = analogRead(_pin);
+  if (10 < initVoltage && initVoltage < 798) {
+    _currentVoltage = initVoltage;
+    _lastVoltage = _currentVoltage;
+    _standardVoltage = initVoltage;
+    return true;
+  }
+  return false;
+}
+
+int AirQualitySensor::slope(void) {
+  _lastVoltage = _currentVoltage;
+  _currentVoltage = analogRead(_pin);
+
+  _voltageSum += _currentVoltage;
+  _volSumCount += 1;
+
+  if (_currentVoltage - _lastVoltage > 400 || _currentVoltage > 700) {
+    return FORCE_SIGNAL;
+  } else if ((_currentVoltage - _lastVoltage > 400 &&
+              _currentVoltage < 700) ||
+             _currentVoltage - _standardVoltage > 150) {
+    return HIGH_POLLUTION;
+  } else if ((_currentVoltage - _lastVoltage > 200 &&
+              _currentVoltage < 700) ||
+             _currentVoltage - _standardVoltage > 50) {
+    return LOW_POLLUTION;
+  }
+  return FRESH_AIR;
+}
+
+int AirQualitySensor::getValue(void) { return _currentVoltage; }
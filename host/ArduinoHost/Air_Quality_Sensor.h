@@ -0,0 +1,29 @@
+#ifndef __GROVE_AIR_QUALITY_SENSOR_H__
+#define __GROVE_AIR_QUALITY_SENSOR_H__
+
+#include "Arduino.h"
+
+// Stand-in for the Seeed driver reading ArduinoHost::setAnalog, without the
+// 20 s heating delay of init().
+class AirQualitySensor {
+public:
+  AirQualitySensor(int pin);
+  bool init(void);
+  int slope(void);
+  int getValue(void);
+
+  static const int FORCE_SIGNAL;
+  static const int HIGH_POLLUTION;
+  static const int LOW_POLLUTION;
+  static const int FRESH_AIR;
+
+protected:
+  int _pin;
+  int _lastVoltage;
+  int _currentVoltage;
+  int _standardVoltage;
+  long _voltageSum;
+  int _volSumCount;
+};
+
+#endif // __GROVE_AIR_QUALITY_SENSOR_H__
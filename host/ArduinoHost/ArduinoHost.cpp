@@ -0,0 +1,291 @@
+#include "ArduinoHost.h"
+
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+
+namespace ArduinoHost {
+
+struct Event {
+  uint64_t at;
+  EventHandler handler;
+  void *context;
+};
+
+struct I2cBinding {
+  uint8_t address;
+  I2cDevice *device;
+};
+
+#define HOST_MAX_I2C_DEVICES 8
+
+static uint64_t currentTime = 0;
+static Event events[HOST_MAX_EVENTS];
+static uint8_t eventCount = 0;
+static uint64_t sleepTime[HOST_SLEEP_MODE_COUNT];
+
+static uint8_t pinLevels[HOST_MAX_PINS];
+static int analogValues[HOST_MAX_PINS];
+static PinWriteHandler pinWriteHandler = nullptr;
+
+static void (*interruptHandlers[2])(void) = {nullptr, nullptr};
+static int interruptModes[2];
+static bool interruptsEnabled = true;
+static bool interruptsPending[2];
+
+static I2cBinding i2cDevices[HOST_MAX_I2C_DEVICES];
+static uint8_t i2cDeviceCount = 0;
+
+SerialTxHandler softwareSerialHandler = nullptr;
+
+float dhtTemperature = 20.0;
+float dhtHumidity = 50.0;
+
+void reset() {
+  currentTime = 0;
+  eventCount = 0;
+  memset(sleepTime, 0, sizeof(sleepTime));
+  memset(pinLevels, 0, sizeof(pinLevels));
+  memset(analogValues, 0, sizeof(analogValues));
+  interruptHandlers[0] = interruptHandlers[1] = nullptr;
+  interruptsPending[0] = interruptsPending[1] = false;
+  interruptsEnabled = true;
+}
+
+uint64_t now() { return currentTime; }
+
+static void runEvents(uint64_t until) {
+  // Events run in time order, each seeing the clock at its own instant
+  while (eventCount > 0) {
+    uint8_t next = 0;
+    for (uint8_t i = 1; i < eventCount; i++) {
+      if (events[i].at < events[next].at) {
+        next = i;
+      }
+    }
+    if (events[next].at > until) {
+      break;
+    }
+
+    Event event = events[next];
+    events[next] = events[--eventCount];
+    if (event.at > currentTime) {
+      currentTime = event.at;
+    }
+    event.handler(event.context);
+  }
+  currentTime = until;
+}
+
+void advanceMicros(uint64_t us) { runEvents(currentTime + us); }
+
+void advanceMillis(unsigned long ms) { advanceMicros((uint64_t)ms * 1000); }
+
+void sleep(uint8_t mode, unsigned long ms) {
+  if (mode < HOST_SLEEP_MODE_COUNT) {
+    sleepTime[mode] += (uint64_t)ms * 1000;
+  }
+  advanceMillis(ms);
+}
+
+uint64_t getSleepTime(uint8_t mode) {
+  return mode < HOST_SLEEP_MODE_COUNT ? sleepTime[mode] : 0;
+}
+
+bool schedule(uint64_t at, EventHandler handler, void *context) {
+  if (eventCount >= HOST_MAX_EVENTS) {
+    return false;
+  }
+  events[eventCount].at = at;
+  events[eventCount].handler = handler;
+  events[eventCount].context = context;
+  eventCount++;
+  return true;
+}
+
+void setDigital(uint8_t pin, uint8_t level) {
+  if (pin >= HOST_MAX_PINS) {
+    return;
+  }
+  uint8_t previous = pinLevels[pin];
+  pinLevels[pin] = level ? HIGH : LOW;
+
+  int interrupt = digitalPinToInterrupt(pin);
+  if (interrupt == NOT_AN_INTERRUPT || !interruptHandlers[interrupt] ||
+      previous == pinLevels[pin]) {
+    return;
+  }
+
+  int mode = interruptModes[interrupt];
+  if (mode == CHANGE || (mode == RISING && pinLevels[pin] == HIGH) ||
+      (mode == FALLING && pinLevels[pin] == LOW)) {
+    // Like the interrupt flag on the board, one edge is held while masked
+    if (interruptsEnabled) {
+      interruptHandlers[interrupt]();
+    } else {
+      interruptsPending[interrupt] = true;
+    }
+  }
+}
+
+uint8_t getDigital(uint8_t pin) {
+  return pin < HOST_MAX_PINS ? pinLevels[pin] : LOW;
+}
+
+void setAnalog(uint8_t pin, int value) {
+  if (pin < HOST_MAX_PINS) {
+    analogValues[pin] = value;
+  }
+}
+
+void setPinWriteHandler(PinWriteHandler handler) { pinWriteHandler = handler; }
+
+void serialInput(const char *text) {
+  Serial.hostInput((const uint8_t *)text, strlen(text));
+}
+
+void setSerialOutput(bool enabled) { Serial.hostSetOutput(enabled); }
+
+void softwareSerialInput(uint8_t rxPin, const uint8_t *data, size_t length) {
+  SoftwareSerial *port = SoftwareSerial::find(rxPin);
+  if (port) {
+    port->hostInput(data, length);
+  }
+}
+
+void softwareSerialInput(uint8_t rxPin, const char *text) {
+  softwareSerialInput(rxPin, (const uint8_t *)text, strlen(text));
+}
+
+void setSoftwareSerialHandler(SerialTxHandler handler) {
+  softwareSerialHandler = handler;
+}
+
+void attachI2cDevice(uint8_t address, I2cDevice *device) {
+  for (uint8_t i = 0; i < i2cDeviceCount; i++) {
+    if (i2cDevices[i].address == address) {
+      i2cDevices[i].device = device;
+      return;
+    }
+  }
+  if (i2cDeviceCount < HOST_MAX_I2C_DEVICES) {
+    i2cDevices[i2cDeviceCount].address = address;
+    i2cDevices[i2cDeviceCount].device = device;
+    i2cDeviceCount++;
+  }
+}
+
+I2cDevice *getI2cDevice(uint8_t address) {
+  for (uint8_t i = 0; i < i2cDeviceCount; i++) {
+    if (i2cDevices[i].address == address) {
+      return i2cDevices[i].device;
+    }
+  }
+  return nullptr;
+}
+
+void setDhtReading(float temperature, float humidity) {
+  dhtTemperature = temperature;
+  dhtHumidity = humidity;
+}
+
+void run(unsigned long duration, unsigned long loopTime) {
+  uint64_t end = currentTime + (uint64_t)duration * 1000;
+
+  setup();
+  while (currentTime < end) {
+    loop();
+    advanceMicros(loopTime);
+  }
+  Serial.flush();
+}
+
+// Arduino core entry points below reach the state above directly
+
+static void pinWrite(uint8_t pin, uint8_t level) {
+  if (pin < HOST_MAX_PINS) {
+    pinLevels[pin] = level ? HIGH : LOW;
+  }
+  if (pinWriteHandler) {
+    pinWriteHandler(pin, level);
+  }
+}
+
+static int analogValue(uint8_t pin) {
+  // analogRead accepts both 0..5 and A0..A5
+  if (pin < A0) {
+    pin += A0;
+  }
+  return pin < HOST_MAX_PINS ? analogValues[pin] : 0;
+}
+
+static void setInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+  if (interrupt < 2) {
+    interruptHandlers[interrupt] = handler;
+    interruptModes[interrupt] = mode;
+    interruptsPending[interrupt] = false;
+  }
+}
+
+static void enableInterrupts(bool enabled) {
+  interruptsEnabled = enabled;
+  for (uint8_t i = 0; enabled && i < 2; i++) {
+    if (interruptsPending[i]) {
+      interruptsPending[i] = false;
+      if (interruptHandlers[i]) {
+        interruptHandlers[i]();
+      }
+    }
+  }
+}
+
+} // namespace ArduinoHost
+
+// Weak so that host tools without a sketch still link
+__attribute__((weak)) void setup() {}
+__attribute__((weak)) void loop() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) {
+    ArduinoHost::setDigital(pin, HIGH);
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  ArduinoHost::pinWrite(pin, val);
+}
+
+int digitalRead(uint8_t pin) { return ArduinoHost::getDigital(pin); }
+
+int analogRead(uint8_t pin) { return ArduinoHost::analogValue(pin); }
+
+unsigned long millis() { return ArduinoHost::now() / 1000; }
+
+unsigned long micros() { return ArduinoHost::now(); }
+
+void delay(unsigned long ms) { ArduinoHost::advanceMillis(ms); }
+
+void delayMicroseconds(unsigned int us) { ArduinoHost::advanceMicros(us); }
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
+  ArduinoHost::setInterrupt(interruptNum, userFunc, mode);
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  ArduinoHost::setInterrupt(interruptNum, nullptr, 0);
+}
+
+void interrupts() { ArduinoHost::enableInterrupts(true); }
+
+void noInterrupts() { ArduinoHost::enableInterrupts(false); }
+
+long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    srand(seed);
+  }
+}
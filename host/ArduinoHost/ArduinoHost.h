@@ -0,0 +1,76 @@
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_MAX_PINS 20
+#define HOST_MAX_EVENTS 16
+#define HOST_LOOP_TIME 1000 // us of virtual time charged for each loop()
+
+// Control side of the host shim. Firmware code only sees the Arduino API,
+// apart from sleep() standing in for the AVR sleep instructions; a host
+// program uses these calls to drive time and stand in for hardware.
+namespace ArduinoHost {
+
+typedef void (*EventHandler)(void *context);
+typedef void (*PinWriteHandler)(uint8_t pin, uint8_t level);
+typedef void (*SerialTxHandler)(uint8_t rxPin, uint8_t data);
+
+// Virtual time, in microseconds since reset. It only moves through delay(),
+// delayMicroseconds(), the run loop or the calls below.
+void reset();
+uint64_t now();
+void advanceMicros(uint64_t us);
+void advanceMillis(unsigned long ms);
+
+// MCU sleep: time passes as in delay() and is counted per mode, in us, for
+// energy estimates
+enum SleepMode : uint8_t {
+  HOST_SLEEP_IDLE,
+  HOST_SLEEP_POWER_DOWN,
+  HOST_SLEEP_MODE_COUNT
+};
+void sleep(uint8_t mode, unsigned long ms);
+uint64_t getSleepTime(uint8_t mode);
+
+// Runs handler once virtual time reaches `at`; returns false if the event
+// queue is full.
+bool schedule(uint64_t at, EventHandler handler, void *context);
+
+// Pins. setDigital drives an input and fires any interrupt attached to it;
+// the handler sees every digitalWrite made by the firmware.
+void setDigital(uint8_t pin, uint8_t level);
+uint8_t getDigital(uint8_t pin);
+void setAnalog(uint8_t pin, int value);
+void setPinWriteHandler(PinWriteHandler handler);
+
+// Hardware serial input, as if typed on the monitor; output can be muted
+void serialInput(const char *text);
+void setSerialOutput(bool enabled);
+
+// SoftwareSerial ports are addressed by their RX pin
+void softwareSerialInput(uint8_t rxPin, const uint8_t *data, size_t length);
+void softwareSerialInput(uint8_t rxPin, const char *text);
+void setSoftwareSerialHandler(SerialTxHandler handler);
+
+// I2C peripherals answering on the Wire bus
+class I2cDevice {
+public:
+  virtual ~I2cDevice() {}
+  virtual void receive(const uint8_t *data, size_t length) = 0;
+  virtual size_t request(uint8_t *buffer, size_t length) = 0;
+};
+void attachI2cDevice(uint8_t address, I2cDevice *device);
+I2cDevice *getI2cDevice(uint8_t address);
+
+// Readings returned by the DHT driver stand-in
+void setDhtReading(float temperature, float humidity);
+
+// Runs setup() then loop() until `duration` ms of virtual time have passed,
+// charging loopTime us for each loop() call.
+void run(unsigned long duration, unsigned long loopTime = HOST_LOOP_TIME);
+
+} // namespace ArduinoHost
+
+#endif // ARDUINO_HOST_H
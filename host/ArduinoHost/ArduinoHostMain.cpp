@@ -0,0 +1,30 @@
+// Default entry point of the native build: runs the firmware for a span of
+// virtual time. Host tools with their own main() define ARDUINO_HOST_NO_MAIN;
+// unit tests bring Unity's.
+#if !defined(ARDUINO_HOST_NO_MAIN) && !defined(PIO_UNIT_TESTING)
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ArduinoHost.h"
+
+#define HOST_DEFAULT_DURATION 60000 // ms
+
+int main(int argc, char **argv) {
+  unsigned long duration = HOST_DEFAULT_DURATION;
+  unsigned long loopTime = HOST_LOOP_TIME;
+
+  // -t <seconds> of virtual time, -l <us> charged per loop()
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-t") == 0) {
+      duration = strtoul(argv[i + 1], nullptr, 10) * 1000;
+    } else if (strcmp(argv[i], "-l") == 0) {
+      loopTime = strtoul(argv[i + 1], nullptr, 10);
+    }
+  }
+
+  ArduinoHost::run(duration, loopTime);
+  return 0;
+}
+
+#endif // !ARDUINO_HOST_NO_MAIN && !PIO_UNIT_TESTING
@@ -0,0 +1,28 @@
+#include "ChainableLED.h"
+
+ChainableLED::ChainableLED(byte clk_pin, byte data_pin, byte number_of_leds) {
+  clockPin = clk_pin;
+  dataPin = data_pin;
+  ledCount = number_of_leds > HOST_MAX_LEDS ? HOST_MAX_LEDS : number_of_leds;
+  memset(colors, 0, sizeof(colors));
+}
+
+void ChainableLED::init() { memset(colors, 0, sizeof(colors)); }
+
+void ChainableLED::setColorRGB(byte led, byte red, byte green, byte blue) {
+  if (led >= ledCount) {
+    return;
+  }
+  colors[led][0] = red;
+  colors[led][1] = green;
+  colors[led][2] = blue;
+}
+
+void ChainableLED::setColorHSV(byte led, float hue, float saturation,
+                               float value) {
+  // Grayscale approximation; the nodes only use setColorRGB
+  (void)hue;
+  (void)saturation;
+  byte level = value * 255;
+  setColorRGB(led, level, level, level);
+}
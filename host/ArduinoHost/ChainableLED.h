@@ -0,0 +1,25 @@
+#ifndef __ChainableLED_h__
+#define __ChainableLED_h__
+
+#include "Arduino.h"
+
+#define HOST_MAX_LEDS 16
+
+// Stand-in for the Grove driver; keeps the last color of each LED
+class ChainableLED {
+private:
+  uint8_t clockPin;
+  uint8_t dataPin;
+  uint8_t ledCount;
+  uint8_t colors[HOST_MAX_LEDS][3];
+
+public:
+  ChainableLED(byte clk_pin, byte data_pin, byte number_of_leds);
+  void init();
+  void setColorRGB(byte led, byte red, byte green, byte blue);
+  void setColorHSV(byte led, float hue, float saturation, float value);
+
+  const uint8_t *getColor(byte led) { return colors[led]; }
+};
+
+#endif // __ChainableLED_h__
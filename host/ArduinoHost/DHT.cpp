@@ -0,0 +1,25 @@
+#include "DHT.h"
+
+namespace ArduinoHost {
+extern float dhtTemperature;
+extern float dhtHumidity;
+}
+
+DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
+  (void)count;
+  this->pin = pin;
+  this->type = type;
+}
+
+void DHT::begin(uint8_t usec) { (void)usec; }
+
+float DHT::readTemperature(bool S, bool force) {
+  (void)force;
+  float temperature = ArduinoHost::dhtTemperature;
+  return S ? temperature * 1.8 + 32 : temperature;
+}
+
+float DHT::readHumidity(bool force) {
+  (void)force;
+  return ArduinoHost::dhtHumidity;
+}
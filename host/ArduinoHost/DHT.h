@@ -0,0 +1,25 @@
+#ifndef DHT_H
+#define DHT_H
+
+#include "Arduino.h"
+
+#define DHT11 11
+#define DHT12 12
+#define DHT21 21
+#define DHT22 22
+#define AM2301 21
+
+// Stand-in for the Adafruit driver, returning ArduinoHost::setDhtReading
+class DHT {
+private:
+  uint8_t pin;
+  uint8_t type;
+
+public:
+  DHT(uint8_t pin, uint8_t type, uint8_t count = 6);
+  void begin(uint8_t usec = 55);
+  float readTemperature(bool S = false, bool force = false);
+  float readHumidity(bool force = false);
+};
+
+#endif // DHT_H
@@ -0,0 +1,7 @@
+#ifndef DHT_U_H
+#define DHT_U_H
+
+#include "Adafruit_Sensor.h"
+#include "DHT.h"
+
+#endif // DHT_U_H
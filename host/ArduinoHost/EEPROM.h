@@ -0,0 +1,33 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOST_EEPROM_SIZE 1024 // ATmega328P
+
+// Erased cells read 0xFF, as on a new board
+struct EEPROMClass {
+  uint8_t cells[HOST_EEPROM_SIZE];
+
+  EEPROMClass() { memset(cells, 0xFF, sizeof(cells)); }
+
+  uint8_t read(int idx) { return cells[idx]; }
+  void write(int idx, uint8_t val) { cells[idx] = val; }
+  void update(int idx, uint8_t val) { cells[idx] = val; }
+  uint8_t &operator[](int idx) { return cells[idx]; }
+  uint16_t length() { return HOST_EEPROM_SIZE; }
+
+  template <typename T> T &get(int idx, T &t) {
+    memcpy(&t, &cells[idx], sizeof(T));
+    return t;
+  }
+  template <typename T> const T &put(int idx, const T &t) {
+    memcpy(&cells[idx], &t, sizeof(T));
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // EEPROM_h
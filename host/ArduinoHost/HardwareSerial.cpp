@@ -0,0 +1,32 @@
+#include "HardwareSerial.h"
+
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+int HardwareSerial::available() { return rxQueue.size(); }
+
+int HardwareSerial::read() {
+  if (rxQueue.empty()) {
+    return -1;
+  }
+  uint8_t data = rxQueue.front();
+  rxQueue.pop_front();
+  return data;
+}
+
+int HardwareSerial::peek() { return rxQueue.empty() ? -1 : rxQueue.front(); }
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+size_t HardwareSerial::write(uint8_t data) {
+  // The firmware ends lines with CR LF, which a terminal does not need
+  if (output && data != '\r') {
+    putchar(data);
+  }
+  return 1;
+}
+
+void HardwareSerial::hostInput(const uint8_t *data, size_t length) {
+  rxQueue.insert(rxQueue.end(), data, data + length);
+}
@@ -0,0 +1,33 @@
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include <deque>
+
+#include "Print.h"
+
+// Output goes to stdout; input is queued by ArduinoHost::serialInput
+class HardwareSerial : public Stream {
+private:
+  std::deque<uint8_t> rxQueue;
+  bool output;
+
+public:
+  HardwareSerial() : output(true) {}
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  operator bool() { return true; }
+
+  int available();
+  int read();
+  int peek();
+  void flush();
+  size_t write(uint8_t data);
+  using Print::write;
+
+  void hostInput(const uint8_t *data, size_t length);
+  void hostSetOutput(bool enabled) { output = enabled; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HardwareSerial_h
@@ -0,0 +1,28 @@
+#include "Seeed_HM330X.h"
+
+#include "Wire.h"
+
+HM330X::HM330X(uint8_t address) { this->address = address; }
+
+HM330XErrorCode HM330X::init() {
+  Wire.begin();
+  return select_comm();
+}
+
+HM330XErrorCode HM330X::select_comm() {
+  Wire.beginTransmission(address);
+  Wire.write(SELECT_COMM_CMD);
+  return Wire.endTransmission() ? ERROR_COMM : NO_ERROR;
+}
+
+HM330XErrorCode HM330X::read_sensor_value(uint8_t *data, uint32_t data_len) {
+  if (!data || data_len > BUFFER_LENGTH) {
+    return ERROR_PARAM;
+  }
+
+  uint8_t received = Wire.requestFrom(address, (uint8_t)data_len);
+  for (uint32_t i = 0; i < received; i++) {
+    data[i] = Wire.read();
+  }
+  return received == data_len ? NO_ERROR : ERROR_COMM;
+}
@@ -0,0 +1,29 @@
+#ifndef _SEEED_HM330X_H
+#define _SEEED_HM330X_H
+
+#include "Arduino.h"
+
+#define DEFAULT_IIC_ADDR 0x40
+#define SELECT_COMM_CMD 0x88
+
+typedef enum {
+  NO_ERROR = 0,
+  ERROR_PARAM = -1,
+  ERROR_COMM = -2,
+  ERROR_OTHERS = -128,
+} HM330XErrorCode;
+
+// Same I2C exchanges as the Seeed driver, so a host program answers them
+// with an ArduinoHost::I2cDevice at DEFAULT_IIC_ADDR.
+class HM330X {
+private:
+  uint8_t address;
+
+public:
+  HM330X(uint8_t address = DEFAULT_IIC_ADDR);
+  HM330XErrorCode init();
+  HM330XErrorCode select_comm();
+  HM330XErrorCode read_sensor_value(uint8_t *data, uint32_t data_len);
+};
+
+#endif // _SEEED_HM330X_H
@@ -0,0 +1,83 @@
+#include "SoftwareSerial.h"
+
+#include "ArduinoHost.h"
+
+SoftwareSerial *SoftwareSerial::ports[HOST_MAX_SOFTWARE_SERIALS];
+
+namespace ArduinoHost {
+extern SerialTxHandler softwareSerialHandler;
+}
+
+SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin,
+                               bool inverseLogic) {
+  (void)inverseLogic;
+  rxPin = receivePin;
+  txPin = transmitPin;
+  listening = false;
+
+  for (uint8_t i = 0; i < HOST_MAX_SOFTWARE_SERIALS; i++) {
+    if (!ports[i]) {
+      ports[i] = this;
+      break;
+    }
+  }
+}
+
+SoftwareSerial::~SoftwareSerial() {
+  for (uint8_t i = 0; i < HOST_MAX_SOFTWARE_SERIALS; i++) {
+    if (ports[i] == this) {
+      ports[i] = nullptr;
+    }
+  }
+}
+
+void SoftwareSerial::begin(long speed) {
+  (void)speed;
+  listen();
+}
+
+bool SoftwareSerial::listen() {
+  // Only one port receives at a time on the board; the others lose input
+  bool changed = !listening;
+  for (uint8_t i = 0; i < HOST_MAX_SOFTWARE_SERIALS; i++) {
+    if (ports[i]) {
+      ports[i]->listening = ports[i] == this;
+    }
+  }
+  return changed;
+}
+
+int SoftwareSerial::available() { return rxQueue.size(); }
+
+int SoftwareSerial::read() {
+  if (rxQueue.empty()) {
+    return -1;
+  }
+  uint8_t data = rxQueue.front();
+  rxQueue.pop_front();
+  return data;
+}
+
+int SoftwareSerial::peek() { return rxQueue.empty() ? -1 : rxQueue.front(); }
+
+size_t SoftwareSerial::write(uint8_t data) {
+  if (ArduinoHost::softwareSerialHandler) {
+    ArduinoHost::softwareSerialHandler(rxPin, data);
+  }
+  return 1;
+}
+
+void SoftwareSerial::hostInput(const uint8_t *data, size_t length) {
+  if (listening) {
+    rxQueue.insert(rxQueue.end(), data, data + length);
+  }
+}
+
+SoftwareSerial *SoftwareSerial::find(uint8_t rxPin) {
+  for (uint8_t i = 0; i < HOST_MAX_SOFTWARE_SERIALS; i++) {
+    if (ports[i] && ports[i]->rxPin == rxPin) {
+      return ports[i];
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,41 @@
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <deque>
+
+#include "Arduino.h"
+
+#define HOST_MAX_SOFTWARE_SERIALS 4
+
+// Bytes written go to the ArduinoHost serial handler, tagged with the RX
+// pin; bytes injected for that pin are read back by the firmware.
+class SoftwareSerial : public Stream {
+private:
+  uint8_t rxPin;
+  uint8_t txPin;
+  bool listening;
+  std::deque<uint8_t> rxQueue;
+
+  static SoftwareSerial *ports[HOST_MAX_SOFTWARE_SERIALS];
+
+public:
+  SoftwareSerial(uint8_t receivePin, uint8_t transmitPin,
+                 bool inverseLogic = false);
+  ~SoftwareSerial();
+
+  void begin(long speed);
+  void end() { listening = false; }
+  bool listen();
+  bool isListening() { return listening; }
+
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t data);
+  using Print::write;
+
+  void hostInput(const uint8_t *data, size_t length);
+  static SoftwareSerial *find(uint8_t rxPin);
+};
+
+#endif // SoftwareSerial_h
@@ -0,0 +1,148 @@
+#include "WString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string formatInteger(unsigned long value, unsigned char base,
+                                 bool negative) {
+  char digits[34];
+  int index = sizeof(digits) - 1;
+  digits[index] = '\0';
+  do {
+    unsigned char digit = value % base;
+    digits[--index] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value && index > 1);
+  if (negative) {
+    digits[--index] = '-';
+  }
+  return std::string(&digits[index]);
+}
+
+String::String(const char *cstr) : buffer(cstr ? cstr : "") {}
+
+String::String(const __FlashStringHelper *str)
+    : buffer(reinterpret_cast<const char *>(str)) {}
+
+String::String(char c) : buffer(1, c) {}
+
+String::String(unsigned char value, unsigned char base)
+    : buffer(formatInteger(value, base, false)) {}
+
+String::String(int value, unsigned char base)
+    : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base)
+    : buffer(formatInteger(value, base, false)) {}
+
+String::String(long value, unsigned char base) {
+  // Like the AVR core, only base 10 prints a sign
+  if (base == 10 && value < 0) {
+    buffer = formatInteger(-(unsigned long)value, base, true);
+  } else {
+    buffer = formatInteger((unsigned long)value, base, false);
+  }
+}
+
+String::String(unsigned long value, unsigned char base)
+    : buffer(formatInteger(value, base, false)) {}
+
+String::String(float value, unsigned char decimalPlaces)
+    : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", decimalPlaces, value);
+  buffer = text;
+}
+
+unsigned char String::reserve(unsigned int size) {
+  buffer.reserve(size);
+  return 1;
+}
+
+String &String::operator=(const char *cstr) {
+  buffer = cstr ? cstr : "";
+  return *this;
+}
+
+String &String::operator+=(const String &rhs) {
+  buffer += rhs.buffer;
+  return *this;
+}
+
+String &String::operator+=(const char *cstr) {
+  buffer += cstr;
+  return *this;
+}
+
+String &String::operator+=(char c) {
+  buffer += c;
+  return *this;
+}
+
+String operator+(const String &lhs, const String &rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+char String::operator[](unsigned int index) const {
+  return index < buffer.size() ? buffer[index] : '\0';
+}
+
+int String::indexOf(char c) const {
+  size_t position = buffer.find(c);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const char *str) const {
+  size_t position = buffer.find(str);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+bool String::startsWith(const String &prefix) const {
+  return buffer.compare(0, prefix.buffer.size(), prefix.buffer) == 0;
+}
+
+String String::substring(unsigned int from) const {
+  return substring(from, buffer.size());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= buffer.size()) {
+    return String();
+  }
+  return String(buffer.substr(from, to - from).c_str());
+}
+
+void String::trim() {
+  size_t begin = buffer.find_first_not_of(" \t\r\n\f\v");
+  if (begin == std::string::npos) {
+    buffer.clear();
+    return;
+  }
+  size_t end = buffer.find_last_not_of(" \t\r\n\f\v");
+  buffer = buffer.substr(begin, end - begin + 1);
+}
+
+long String::toInt() const { return atol(buffer.c_str()); }
+
+float String::toFloat() const { return atof(buffer.c_str()); }
@@ -0,0 +1,56 @@
+#ifndef String_class_h
+#define String_class_h
+
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal)                                                      \
+  (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Arduino String on top of std::string, with the AVR core's formatting
+class String {
+private:
+  std::string buffer;
+
+public:
+  String(const char *cstr = "");
+  String(const __FlashStringHelper *str);
+  String(char c);
+  String(unsigned char value, unsigned char base = 10);
+  String(int value, unsigned char base = 10);
+  String(unsigned int value, unsigned char base = 10);
+  String(long value, unsigned char base = 10);
+  String(unsigned long value, unsigned char base = 10);
+  String(float value, unsigned char decimalPlaces = 2);
+  String(double value, unsigned char decimalPlaces = 2);
+
+  unsigned char reserve(unsigned int size);
+  unsigned int length() const { return buffer.size(); }
+  const char *c_str() const { return buffer.c_str(); }
+
+  String &operator=(const char *cstr);
+  String &operator+=(const String &rhs);
+  String &operator+=(const char *cstr);
+  String &operator+=(char c);
+
+  friend String operator+(const String &lhs, const String &rhs);
+  friend String operator+(const String &lhs, const char *rhs);
+  friend String operator+(const char *lhs, const String &rhs);
+
+  bool operator==(const String &rhs) const { return buffer == rhs.buffer; }
+  bool operator==(const char *cstr) const { return buffer == cstr; }
+  bool operator!=(const String &rhs) const { return buffer != rhs.buffer; }
+  char operator[](unsigned int index) const;
+
+  int indexOf(char c) const;
+  int indexOf(const char *str) const;
+  bool startsWith(const String &prefix) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  void trim();
+  long toInt() const;
+  float toFloat() const;
+};
+
+#endif // String_class_h
@@ -0,0 +1,61 @@
+#include "Wire.h"
+
+#include "ArduinoHost.h"
+
+TwoWire Wire;
+
+TwoWire::TwoWire() {
+  txAddress = 0;
+  txLength = 0;
+  rxLength = 0;
+  rxIndex = 0;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txLength = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  ArduinoHost::I2cDevice *device = ArduinoHost::getI2cDevice(txAddress);
+  if (!device) {
+    return 2; // address NACK
+  }
+  device->receive(txBuffer, txLength);
+  txLength = 0;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  ArduinoHost::I2cDevice *device = ArduinoHost::getI2cDevice(address);
+  if (quantity > BUFFER_LENGTH) {
+    quantity = BUFFER_LENGTH;
+  }
+
+  rxIndex = 0;
+  rxLength = device ? device->request(rxBuffer, quantity) : 0;
+  return rxLength;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= BUFFER_LENGTH) {
+    return 0;
+  }
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity) {
+  size_t written = 0;
+  while (written < quantity && write(data[written])) {
+    written++;
+  }
+  return written;
+}
+
+int TwoWire::available() { return rxLength - rxIndex; }
+
+int TwoWire::read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+
+int TwoWire::peek() { return rxIndex < rxLength ? rxBuffer[rxIndex] : -1; }
@@ -0,0 +1,42 @@
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+// I2C master talking to the devices attached with ArduinoHost. A missing
+// device NACKs its address, like an empty bus.
+class TwoWire : public Stream {
+private:
+  uint8_t txAddress;
+  uint8_t txBuffer[BUFFER_LENGTH];
+  uint8_t txLength;
+  uint8_t rxBuffer[BUFFER_LENGTH];
+  uint8_t rxLength;
+  uint8_t rxIndex;
+
+public:
+  TwoWire();
+  void begin() {}
+  void setClock(uint32_t clock) { (void)clock; }
+
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  uint8_t requestFrom(int address, int quantity) {
+    return requestFrom((uint8_t)address, (uint8_t)quantity);
+  }
+
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t quantity);
+  using Print::write;
+  int available();
+  int read();
+  int peek();
+};
+
+extern TwoWire Wire;
+
+#endif // TwoWire_h
@@ -0,0 +1,315 @@
+#include "La66Emulator.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LORAWAN_OVERHEAD 13 // MHDR, FHDR without options, FPort, MIC
+
+La66Emulator::La66Emulator(La66Output output, void *context) {
+  this->output = output;
+  this->context = context;
+
+  config.joinDelay = 6000;
+  config.joinFailRate = 0;
+  config.dropRate = 0;
+  config.dutyCycle = 0.01;
+  config.spreadingFactor = 7;
+  config.seed = 1;
+
+  memset(&stats, 0, sizeof(stats));
+  randomState = 0;
+  uplinkHandler = nullptr;
+  powered = false;
+  joined = false;
+  joinAt = 0;
+  txStartAt = 0;
+  txDoneAt = 0;
+  rxNoticeAt = 0;
+  nextTxAllowed = 0;
+  uplinkRequestedAt = 0;
+  resetAt = 0;
+  transmitting = false;
+  awaitingRx = false;
+  recovering = false;
+  uplinkLost = false;
+  asleep = false;
+  sleepStart = 0;
+  uplinkPort = 0;
+  uplinkLength = 0;
+  uplinkPayload[0] = '\0';
+  uplinkCounter = 0;
+  downlinkCount = 0;
+  downlinkReady = false;
+  lineLength = 0;
+  lastByte = 0;
+}
+
+void La66Emulator::print(const char *text) { output(text, context); }
+
+void La66Emulator::printFormat(const char *format, ...) {
+  char buffer[LA66_LINE_SIZE];
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(buffer, sizeof(buffer), format, arguments);
+  va_end(arguments);
+  print(buffer);
+}
+
+float La66Emulator::chance() {
+  // xorshift32, so a seed gives the same run on every host
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (randomState >> 8) / 16777216.0f;
+}
+
+void La66Emulator::boot(unsigned long now) {
+  if (asleep) {
+    stats.sleepTime += now - sleepStart;
+    asleep = false;
+  }
+  powered = true;
+  joined = false;
+  transmitting = false;
+  awaitingRx = false;
+  downlinkReady = false;
+  lineLength = 0;
+  joinAt = now + config.joinDelay;
+
+  print("\r\nDragino LA66 Device\r\n");
+  print("Image Version: v1.1\r\n");
+  print("LoRaWan Stack: DR-LWS-007\r\n");
+  print("Frequency Band: EU868\r\n");
+  print("DevEui= 00 00 00 00 00 00 00 00\r\n");
+  print("JoinRequest NbTrials= 72\r\n");
+}
+
+void La66Emulator::powerOn(unsigned long now) {
+  randomState = config.seed ? config.seed : 1;
+  boot(now);
+}
+
+void La66Emulator::reset(unsigned long now) {
+  stats.resets++;
+  resetAt = now;
+  recovering = true;
+  boot(now);
+}
+
+bool La66Emulator::queueDownlink(uint8_t port, const char *hex) {
+  if (downlinkCount >= LA66_MAX_DOWNLINKS ||
+      strlen(hex) > 2 * LA66_MAX_PAYLOAD) {
+    return false;
+  }
+  downlinkPorts[downlinkCount] = port;
+  strcpy(downlinkPayloads[downlinkCount], hex);
+  downlinkCount++;
+  return true;
+}
+
+void La66Emulator::popDownlink() {
+  downlinkCount--;
+  memmove(downlinkPorts, downlinkPorts + 1, downlinkCount);
+  memmove(downlinkPayloads, downlinkPayloads + 1,
+          downlinkCount * sizeof(downlinkPayloads[0]));
+}
+
+void La66Emulator::receive(uint8_t data, unsigned long now) {
+  if (!powered) {
+    return;
+  }
+  // The LF closing the sleep command is not a wake-up byte
+  bool lineFeed = data == '\n' && lastByte == '\r';
+  lastByte = data;
+  if (asleep && !lineFeed) {
+    stats.sleepTime += now - sleepStart;
+    asleep = false;
+    return;
+  }
+  if (data != '\r' && data != '\n') {
+    if (lineLength < LA66_LINE_SIZE - 1) {
+      line[lineLength++] = data;
+    }
+    return;
+  }
+  if (lineLength == 0) {
+    return;
+  }
+  line[lineLength] = '\0';
+  lineLength = 0;
+  handleCommand(now);
+}
+
+void La66Emulator::handleCommand(unsigned long now) {
+  if (strcmp(line, "ATZ") == 0) {
+    reset(now);
+  } else if (strncmp(line, "AT+SENDB=", 9) == 0) {
+    handleSend(line + 9, now);
+  } else if (strcmp(line, "AT+CFG") == 0) {
+    printConfig();
+  } else if (strcmp(line, "AT+RECVB=?") == 0) {
+    if (downlinkReady) {
+      printFormat("%u:%s\r\n", downlinkPorts[0], downlinkPayloads[0]);
+      downlinkReady = false;
+      popDownlink();
+    } else {
+      print("0:\r\n");
+    }
+    print("OK\r\n");
+  } else if (strcmp(line, "AT+SLEEP=1") == 0) {
+    // Not while the radio is in use
+    if (transmitting || awaitingRx) {
+      print("AT_BUSY_ERROR\r\n");
+    } else {
+      print("OK\r\n");
+      asleep = true;
+      sleepStart = now;
+    }
+  } else if (strcmp(line, "AT+NJS=?") == 0) {
+    printFormat("%d\r\nOK\r\n", joined ? 1 : 0);
+  } else if (strncmp(line, "AT", 2) == 0) {
+    print("OK\r\n");
+  } else {
+    print("AT_ERROR\r\n");
+  }
+}
+
+void La66Emulator::handleSend(const char *arguments, unsigned long now) {
+  // <confirmed>,<port>,<length>,<hex>
+  unsigned confirmed, port, length;
+  char hex[LA66_LINE_SIZE];
+  stats.uplinks++;
+  if (sscanf(arguments, "%u,%u,%u,%159s", &confirmed, &port, &length, hex) !=
+          4 ||
+      length > LA66_MAX_PAYLOAD || strlen(hex) != 2 * length) {
+    stats.rejected++;
+    print("AT_PARAM_ERROR\r\n");
+    return;
+  }
+  if (!joined) {
+    stats.rejected++;
+    print("AT_NO_NET_JOINED\r\n");
+    return;
+  }
+  if (transmitting || awaitingRx) {
+    stats.rejected++;
+    print("AT_BUSY_ERROR\r\n");
+    return;
+  }
+  if ((long)(now - nextTxAllowed) < 0) {
+    stats.rejected++;
+    print("AT_DUTYCYCLE_RESTRICTED\r\n");
+    return;
+  }
+
+  unsigned long toa = airtime(config.spreadingFactor, length);
+  uplinkRequestedAt = now;
+  uplinkPort = port;
+  uplinkLength = length;
+  strcpy(uplinkPayload, hex);
+  uplinkLost = chance() < config.dropRate;
+  stats.airtime += toa;
+  txStartAt = now + LA66_PROCESSING_TIME;
+  txDoneAt = txStartAt + toa;
+  rxNoticeAt = txDoneAt + LA66_RX1_DELAY;
+  if (config.dutyCycle > 0) {
+    nextTxAllowed = txStartAt + (unsigned long)(toa / config.dutyCycle);
+  }
+  transmitting = true;
+
+  print("OK\r\n");
+  printFormat("***** UpLinkCounter= %lu *****\r\n", uplinkCounter++);
+  printFormat("TX on freq 868100000 Hz at DR %u\r\n",
+              12 - config.spreadingFactor);
+}
+
+void La66Emulator::printConfig() {
+  printFormat("AT+NJS=%d\r\n", joined ? 1 : 0);
+  printFormat("AT+DR=%u\r\n", 12 - config.spreadingFactor);
+  printFormat("AT+FCU=%lu\r\n", uplinkCounter);
+  if (downlinkReady) {
+    printFormat("AT+RECVB=%u:%s\r\n", downlinkPorts[0], downlinkPayloads[0]);
+    downlinkReady = false;
+    popDownlink();
+  } else {
+    print("AT+RECVB=0:\r\n");
+  }
+  print("OK\r\n");
+}
+
+void La66Emulator::update(unsigned long now) {
+  if (!powered) {
+    return;
+  }
+
+  if (!joined && (long)(now - joinAt) >= 0) {
+    if (chance() < config.joinFailRate) {
+      print("Join failed\r\nJoinRequest NbTrials= 72\r\n");
+      joinAt = now + LA66_JOIN_RETRY;
+    } else {
+      joined = true;
+      print("Join Accept:\r\nJOINED\r\n");
+    }
+  }
+
+  if (transmitting && (long)(now - txDoneAt) >= 0) {
+    transmitting = false;
+    awaitingRx = true;
+    print("txDone\r\n");
+
+    if (uplinkLost) {
+      stats.dropped++;
+    } else {
+      unsigned long latency = txDoneAt - uplinkRequestedAt;
+      stats.delivered++;
+      stats.bytesDelivered += uplinkLength;
+      stats.latencySum += latency;
+      if (latency > stats.latencyMax) {
+        stats.latencyMax = latency;
+      }
+      if (uplinkHandler) {
+        uplinkHandler(txDoneAt, uplinkPort, uplinkPayload, latency);
+      }
+      if (recovering) {
+        unsigned long recovery = txDoneAt - resetAt;
+        recovering = false;
+        stats.recoveryCount++;
+        stats.recoverySum += recovery;
+        if (recovery > stats.recoveryMax) {
+          stats.recoveryMax = recovery;
+        }
+      }
+    }
+  }
+
+  if (awaitingRx && (long)(now - rxNoticeAt) >= 0) {
+    awaitingRx = false;
+    // A lost uplink gets neither the ACK nor a pending downlink
+    if (uplinkLost) {
+      print("rxTimeOut\r\n");
+    } else if (downlinkCount > 0 && !downlinkReady) {
+      downlinkReady = true;
+      stats.downlinks++;
+      print("ACK Received\r\n");
+      print("Run AT+RECVB=? to see detail\r\n");
+    } else {
+      print("ACK Received\r\n");
+    }
+  }
+}
+
+unsigned long La66Emulator::airtime(uint8_t spreadingFactor,
+                                    uint8_t length) {
+  // Semtech AN1200.13, explicit header, CRC on, low data rate
+  // optimisation at SF11 and SF12
+  long sf = spreadingFactor;
+  long lowDataRate = sf >= 11 ? 1 : 0;
+  long bits = 8L * (length + LORAWAN_OVERHEAD) - 4 * sf + 28 + 16;
+  long divisor = 4 * (sf - 2 * lowDataRate);
+  long symbols = bits > 0 ? (bits + divisor - 1) / divisor * 5 : 0;
+  // Symbol time in us at 125 kHz, preamble of 8 + 4.25 symbols
+  unsigned long symbolTime = (1000000UL << sf) / 125000;
+  return (symbolTime * (49 + 4 * (8 + symbols)) / 4 + 999) / 1000;
+}
@@ -0,0 +1,118 @@
+#ifndef LA66_EMULATOR_H
+#define LA66_EMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LA66_LINE_SIZE 160
+#define LA66_MAX_DOWNLINKS 4
+#define LA66_MAX_PAYLOAD 51       // EU868 DR0
+#define LA66_PROCESSING_TIME 50   // ms from AT+SENDB to the start of TX
+#define LA66_RX1_DELAY 1000       // ms from txDone to the downlink notice
+#define LA66_JOIN_RETRY 10000     // ms between failed join attempts
+
+struct La66Config {
+  unsigned long joinDelay; // ms from power-up to JOINED
+  float joinFailRate;      // probability a join attempt fails
+  float dropRate;          // probability an uplink never reaches the network
+  float dutyCycle;         // allowed fraction of airtime, 0 = unlimited
+  uint8_t spreadingFactor; // 7..12, 125 kHz
+  uint32_t seed;
+};
+
+struct La66Stats {
+  unsigned long uplinks;   // AT+SENDB commands received
+  unsigned long delivered; // reached the network
+  unsigned long dropped;   // sent but lost
+  unsigned long rejected;  // refused: not joined, busy or duty cycle
+  unsigned long bytesDelivered;
+  unsigned long latencySum; // ms from AT+SENDB to reception, delivered only
+  unsigned long latencyMax;
+  unsigned long downlinks;
+  unsigned long resets;
+  unsigned long recoveryCount; // resets followed by a delivered uplink
+  unsigned long recoverySum;   // ms from reset to that uplink
+  unsigned long recoveryMax;
+  unsigned long airtime;   // ms on air, lost uplinks included
+  unsigned long sleepTime; // ms asleep, up to the last wake-up
+};
+
+typedef void (*La66Output)(const char *text, void *context);
+// Called for each uplink that reached the network
+typedef void (*La66UplinkHandler)(unsigned long time, uint8_t port,
+                                  const char *hex, unsigned long latency);
+
+// Dragino LA66 as seen from its UART: the AT dialect used by LoRaManager,
+// with the join, airtime, duty cycle, RX windows and sleep simulated. Transport
+// and clock are the caller's: bytes from the node go to receive(), timers
+// run in update(), and replies come back through the output callback.
+class La66Emulator {
+private:
+  La66Output output;
+  void *context;
+  La66Config config;
+  La66Stats stats;
+  uint32_t randomState;
+  La66UplinkHandler uplinkHandler;
+
+  bool powered;
+  bool joined;
+  unsigned long joinAt;
+  unsigned long txStartAt;
+  unsigned long txDoneAt;
+  unsigned long rxNoticeAt;
+  unsigned long nextTxAllowed;
+  unsigned long uplinkRequestedAt;
+  unsigned long resetAt;
+  bool transmitting;
+  bool awaitingRx;
+  bool recovering;
+  bool uplinkLost;
+  bool asleep;
+  unsigned long sleepStart;
+  uint8_t uplinkPort;
+  uint8_t uplinkLength;
+  char uplinkPayload[2 * LA66_MAX_PAYLOAD + 1];
+  unsigned long uplinkCounter;
+
+  uint8_t downlinkPorts[LA66_MAX_DOWNLINKS];
+  char downlinkPayloads[LA66_MAX_DOWNLINKS][2 * LA66_MAX_PAYLOAD + 1];
+  uint8_t downlinkCount;
+  bool downlinkReady;
+
+  char line[LA66_LINE_SIZE];
+  uint8_t lineLength;
+  uint8_t lastByte;
+
+  void print(const char *text);
+  void printFormat(const char *format, ...);
+  float chance();
+  void boot(unsigned long now);
+  void handleCommand(unsigned long now);
+  void handleSend(const char *arguments, unsigned long now);
+  void printConfig();
+  void popDownlink();
+
+public:
+  La66Emulator(La66Output output, void *context);
+  La66Config &getConfig() { return config; }
+  const La66Stats &getStats() { return stats; }
+  void setUplinkHandler(La66UplinkHandler handler) { uplinkHandler = handler; }
+
+  void powerOn(unsigned long now);
+  // Modem reboot, as after a brown-out: banner, then a new join
+  void reset(unsigned long now);
+  bool queueDownlink(uint8_t port, const char *hex);
+
+  // Asleep, the first byte received only wakes the modem
+  void receive(uint8_t data, unsigned long now);
+  void update(unsigned long now);
+  unsigned long getSleepTime(unsigned long now) {
+    return stats.sleepTime + (asleep ? now - sleepStart : 0);
+  }
+
+  // Time on air of an uplink at 125 kHz, CR 4/5, 8-symbol preamble
+  static unsigned long airtime(uint8_t spreadingFactor, uint8_t length);
+};
+
+#endif // LA66_EMULATOR_H
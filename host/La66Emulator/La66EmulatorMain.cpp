@@ -0,0 +1,265 @@
+// Runs the firmware linked with it against an emulated LA66 at virtual time,
+// or exposes the emulator alone on a pseudo-terminal in real time (-P).
+// Delivered uplinks are printed as "<ms>,<port>,<hex payload>", the link
+// statistics and an energy estimate go to stderr.
+
+#ifndef LA66_EMULATOR_NO_MAIN
+
+#include <Arduino.h>
+#include <ArduinoHost.h>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "La66Script.h"
+
+#define LA66_LORA_RX_PIN 10
+#define LA66_RUN_TIME 3600 // s
+
+// Supply currents assumed by the energy estimate, in uA: ATmega328P at
+// 16 MHz and 5 V, LA66 at 3.3 V. The Uno's regulator, USB bridge and the
+// sensors are left out.
+#define MCU_VOLTAGE 5.0
+#define MCU_ACTIVE_CURRENT 9000
+#define MCU_IDLE_CURRENT 3000
+#define MCU_POWER_DOWN_CURRENT 6
+#define MODEM_VOLTAGE 3.3
+#define MODEM_TX_CURRENT 40000 // 14 dBm
+#define MODEM_RX_CURRENT 5000
+#define MODEM_AWAKE_CURRENT 2000
+#define MODEM_SLEEP_CURRENT 5
+#define MODEM_RX_WINDOW_TIME 30 // ms the receiver listens in each window
+
+static uint8_t loraRxPin = LA66_LORA_RX_PIN;
+static int ptyFd = -1;
+static volatile bool stopped = false;
+
+static void toFirmware(const char *text, void *context) {
+  (void)context;
+  ArduinoHost::softwareSerialInput(loraRxPin, text);
+}
+
+static void toPty(const char *text, void *context) {
+  (void)context;
+  if (write(ptyFd, text, strlen(text)) < 0) {
+    stopped = true;
+  }
+}
+
+static La66Emulator *modem;
+
+static void onNodeByte(uint8_t rxPin, uint8_t data) {
+  if (rxPin == loraRxPin) {
+    modem->receive(data, millis());
+  }
+}
+
+static void onUplink(unsigned long time, uint8_t port, const char *hex,
+                     unsigned long latency) {
+  (void)latency;
+  printf("%lu,%u,%s\n", time, port, hex);
+  fflush(stdout);
+}
+
+static void onSignal(int signal) {
+  (void)signal;
+  stopped = true;
+}
+
+static void printStats(const La66Stats &stats, unsigned long elapsed) {
+  fprintf(stderr,
+          "%lu uplinks: %lu delivered, %lu dropped, %lu rejected; "
+          "%lu downlinks\n",
+          stats.uplinks, stats.delivered, stats.dropped, stats.rejected,
+          stats.downlinks);
+  if (stats.delivered > 0) {
+    fprintf(stderr, "latency: mean %lu ms, max %lu ms\n",
+            stats.latencySum / stats.delivered, stats.latencyMax);
+  }
+  fprintf(stderr, "throughput: %.1f B/h, %.1f uplinks/h over %.1f s\n",
+          stats.bytesDelivered * 3600000.0 / (elapsed ? elapsed : 1),
+          stats.delivered * 3600000.0 / (elapsed ? elapsed : 1),
+          elapsed / 1000.0);
+  if (stats.resets > 0) {
+    fprintf(stderr, "recovery: %lu/%lu resets", stats.recoveryCount,
+            stats.resets);
+    if (stats.recoveryCount > 0) {
+      fprintf(stderr, ", mean %lu ms, max %lu ms",
+              stats.recoverySum / stats.recoveryCount, stats.recoveryMax);
+    }
+    fprintf(stderr, "\n");
+  }
+}
+
+static void printEnergy(const La66Stats &stats, unsigned long sleepTime,
+                        unsigned long elapsed) {
+  double idle = ArduinoHost::getSleepTime(ArduinoHost::HOST_SLEEP_IDLE) / 1e6;
+  double powerDown =
+      ArduinoHost::getSleepTime(ArduinoHost::HOST_SLEEP_POWER_DOWN) / 1e6;
+  double active = elapsed / 1000.0 - idle - powerDown;
+  // uA * s * V = uJ
+  double mcu = (active * MCU_ACTIVE_CURRENT + idle * MCU_IDLE_CURRENT +
+                powerDown * MCU_POWER_DOWN_CURRENT) *
+               MCU_VOLTAGE / 1000.0;
+
+  double tx = stats.airtime / 1000.0;
+  double rx = 2.0 * (stats.delivered + stats.dropped) * MODEM_RX_WINDOW_TIME /
+              1000.0;
+  double asleep = sleepTime / 1000.0;
+  double awake = elapsed / 1000.0 - tx - rx - asleep;
+  double radio = (tx * MODEM_TX_CURRENT + rx * MODEM_RX_CURRENT +
+                  awake * MODEM_AWAKE_CURRENT + asleep * MODEM_SLEEP_CURRENT) *
+                 MODEM_VOLTAGE / 1000.0;
+
+  double seconds = elapsed ? elapsed / 1000.0 : 1;
+  fprintf(stderr,
+          "MCU: %.1f s active, %.1f s idle, %.1f s power-down, %.0f mJ, "
+          "%.3f mA\n",
+          active, idle, powerDown, mcu, mcu / MCU_VOLTAGE / seconds);
+  fprintf(stderr,
+          "modem: %.1f s TX, %.1f s RX, %.1f s awake, %.1f s asleep, "
+          "%.0f mJ, %.3f mA\n",
+          tx, rx, awake, asleep, radio, radio / MODEM_VOLTAGE / seconds);
+  if (stats.delivered > 0) {
+    fprintf(stderr, "energy: %.1f mJ per delivered uplink\n",
+            (mcu + radio) / stats.delivered);
+  }
+}
+
+static unsigned long wallMillis() {
+  static auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static int runPty(const std::vector<La66Step> &steps, size_t next,
+                  unsigned long duration) {
+  ptyFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyFd < 0 || grantpt(ptyFd) < 0 || unlockpt(ptyFd) < 0) {
+    perror("pty");
+    return 1;
+  }
+  // Raw, so the line discipline does not echo the modem's output back to it
+  struct termios settings;
+  if (tcgetattr(ptyFd, &settings) == 0) {
+    cfmakeraw(&settings);
+    tcsetattr(ptyFd, TCSANOW, &settings);
+  }
+  fprintf(stderr, "LA66 on %s\n", ptsname(ptyFd));
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  modem->powerOn(wallMillis());
+  while (!stopped && wallMillis() < duration) {
+    struct pollfd input = {ptyFd, POLLIN, 0};
+    if (poll(&input, 1, 10) > 0) {
+      uint8_t buffer[64];
+      ssize_t length = read(ptyFd, buffer, sizeof(buffer));
+      // EIO until the other side opens the terminal
+      for (ssize_t i = 0; i < length; i++) {
+        modem->receive(buffer[i], wallMillis());
+      }
+      if (length <= 0) {
+        usleep(10000);
+      }
+    }
+    while (next < steps.size() && steps[next].time <= wallMillis()) {
+      applyStep(*modem, steps[next++], wallMillis());
+    }
+    modem->update(wallMillis());
+  }
+
+  printStats(modem->getStats(), wallMillis());
+  close(ptyFd);
+  return 0;
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s <script> [-P] [-v] [-t seconds] [-l loop_us]"
+          " [-r lora_rx_pin]\n",
+          program);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  bool pty = false;
+  bool verbose = false;
+  unsigned long duration = LA66_RUN_TIME * 1000UL;
+  unsigned long loopTime = HOST_LOOP_TIME;
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-P") == 0) {
+      pty = true;
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    } else if (strcmp(argv[i], "-t") == 0) {
+      duration = strtoul(argv[++i], nullptr, 10) * 1000UL;
+    } else if (strcmp(argv[i], "-l") == 0) {
+      loopTime = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      loraRxPin = atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<La66Step> steps;
+  if (!loadScript(argv[1], steps)) {
+    return 1;
+  }
+
+  La66Emulator emulator(pty ? toPty : toFirmware, nullptr);
+  modem = &emulator;
+  emulator.setUplinkHandler(onUplink);
+
+  // Settings at time 0 hold from power-up, so the seed and join delay apply
+  size_t next = 0;
+  while (next < steps.size() && steps[next].time == 0 &&
+         steps[next].action != LA66_RESET) {
+    applyStep(emulator, steps[next++], 0);
+  }
+
+  if (pty) {
+    return runPty(steps, next, duration);
+  }
+
+  ArduinoHost::setSerialOutput(verbose);
+  ArduinoHost::setSoftwareSerialHandler(onNodeByte);
+
+  auto wallStart = std::chrono::steady_clock::now();
+  emulator.powerOn(millis());
+  setup();
+  while (millis() < duration) {
+    while (next < steps.size() && steps[next].time <= millis()) {
+      applyStep(emulator, steps[next++], millis());
+    }
+    emulator.update(millis());
+    loop();
+    ArduinoHost::advanceMicros(loopTime);
+  }
+
+  double wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - wallStart)
+                    .count();
+  printStats(emulator.getStats(), millis());
+  printEnergy(emulator.getStats(), emulator.getSleepTime(millis()), millis());
+  fprintf(stderr, "%.1f s emulated in %.2f s\n", millis() / 1000.0, wall);
+  return 0;
+}
+
+#endif // LA66_EMULATOR_NO_MAIN
@@ -0,0 +1,130 @@
+#include "La66Script.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_LINE_SIZE 256
+
+struct La66Command {
+  const char *name;
+  La66Action action;
+};
+
+static const La66Command COMMANDS[] = {
+    {"join_delay", LA66_JOIN_DELAY}, {"join_fail", LA66_JOIN_FAIL},
+    {"drop", LA66_DROP},             {"duty_cycle", LA66_DUTY_CYCLE},
+    {"sf", LA66_SF},                 {"seed", LA66_SEED},
+    {"downlink", LA66_DOWNLINK},     {"reset", LA66_RESET},
+};
+
+bool parseScriptLine(const char *line, La66Step &step) {
+  char name[16];
+  int consumed = 0;
+  if (sscanf(line, "%lu %15s %n", &step.time, name, &consumed) != 2) {
+    return false;
+  }
+  const char *arguments = line + consumed;
+
+  const La66Command *command = nullptr;
+  for (const La66Command &candidate : COMMANDS) {
+    if (strcmp(name, candidate.name) == 0) {
+      command = &candidate;
+    }
+  }
+  if (!command) {
+    return false;
+  }
+  step.action = command->action;
+  step.value = 0;
+  step.port = 0;
+  step.hex[0] = '\0';
+
+  switch (step.action) {
+  case LA66_RESET:
+    return true;
+  case LA66_DOWNLINK: {
+    unsigned port;
+    if (sscanf(arguments, "%u %102s", &port, step.hex) != 2 || port == 0 ||
+        port > 223 || strlen(step.hex) % 2 != 0) {
+      return false;
+    }
+    step.port = port;
+    return true;
+  }
+  default:
+    return sscanf(arguments, "%f", &step.value) == 1;
+  }
+}
+
+bool loadScript(const char *path, std::vector<La66Step> &steps) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+
+  char line[SCRIPT_LINE_SIZE];
+  unsigned number = 0;
+  bool ok = true;
+  while (fgets(line, sizeof(line), file)) {
+    number++;
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+    if (strspn(line, " \t\r\n") == strlen(line)) {
+      continue;
+    }
+
+    La66Step step;
+    if (!parseScriptLine(line, step)) {
+      fprintf(stderr, "%s:%u: invalid step\n", path, number);
+      ok = false;
+      continue;
+    }
+    steps.push_back(step);
+  }
+  fclose(file);
+
+  std::stable_sort(steps.begin(), steps.end(),
+                   [](const La66Step &a, const La66Step &b) {
+                     return a.time < b.time;
+                   });
+  return ok;
+}
+
+void applyStep(La66Emulator &modem, const La66Step &step, unsigned long now) {
+  La66Config &config = modem.getConfig();
+  switch (step.action) {
+  case LA66_JOIN_DELAY:
+    config.joinDelay = step.value;
+    break;
+  case LA66_JOIN_FAIL:
+    config.joinFailRate = step.value;
+    break;
+  case LA66_DROP:
+    config.dropRate = step.value;
+    break;
+  case LA66_DUTY_CYCLE:
+    config.dutyCycle = step.value;
+    break;
+  case LA66_SF:
+    if (step.value >= 7 && step.value <= 12) {
+      config.spreadingFactor = step.value;
+    }
+    break;
+  case LA66_SEED:
+    config.seed = step.value;
+    break;
+  case LA66_DOWNLINK:
+    if (!modem.queueDownlink(step.port, step.hex)) {
+      fprintf(stderr, "downlink queue full, %s dropped\n", step.hex);
+    }
+    break;
+  case LA66_RESET:
+    modem.reset(now);
+    break;
+  }
+}
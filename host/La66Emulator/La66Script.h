@@ -0,0 +1,37 @@
+#ifndef LA66_SCRIPT_H
+#define LA66_SCRIPT_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "La66Emulator.h"
+
+enum La66Action : uint8_t {
+  LA66_JOIN_DELAY, // ms
+  LA66_JOIN_FAIL,  // probability
+  LA66_DROP,       // probability
+  LA66_DUTY_CYCLE, // fraction, 0 = unlimited
+  LA66_SF,         // 7..12
+  LA66_SEED,
+  LA66_DOWNLINK, // port hex
+  LA66_RESET
+};
+
+struct La66Step {
+  unsigned long time; // ms from the start of the run
+  La66Action action;
+  float value;
+  uint8_t port;
+  char hex[2 * LA66_MAX_PAYLOAD + 1];
+};
+
+// One step per line, "<ms> <command> [arguments]"; '#' starts a comment.
+// Commands: join_delay, join_fail, drop, duty_cycle, sf, seed,
+// downlink <port> <hex> and reset.
+bool parseScriptLine(const char *line, La66Step &step);
+// Steps come back sorted by time; false if a line cannot be parsed
+bool loadScript(const char *path, std::vector<La66Step> &steps);
+void applyStep(La66Emulator &modem, const La66Step &step, unsigned long now);
+
+#endif // LA66_SCRIPT_H
@@ -0,0 +1,197 @@
+#include "SensorReplay.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const TRACE_KIND_NAMES[TRACE_KIND_COUNT] = {
+    "dht", "hp206c", "hm330x", "aqi", "echo"};
+
+static bool parseHex(const char *text, uint8_t *buffer, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    char byte[3] = {text[2 * i], text[2 * i + 1], '\0'};
+    char *end;
+    if (!byte[0] || !byte[1]) {
+      return false;
+    }
+    buffer[i] = strtoul(byte, &end, 16);
+    if (*end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseTraceLine(const char *line, TraceRecord &record) {
+  if (strncmp(line, "TRACE ", 6) == 0) {
+    line += 6;
+  }
+
+  char kind[16];
+  char fields[TRACE_MAX_VALUES][64];
+  unsigned long time;
+  int count = sscanf(line, "%lu %15s %63s %63s %63s", &time, kind, fields[0],
+                     fields[1], fields[2]);
+  if (count < 3) {
+    return false;
+  }
+
+  memset(&record, 0, sizeof(record));
+  record.time = time;
+  for (uint8_t i = 0; i < TRACE_KIND_COUNT; i++) {
+    if (strcmp(kind, TRACE_KIND_NAMES[i]) == 0) {
+      record.kind = (TraceKind)i;
+      if (record.kind == TRACE_HM330X) {
+        return strlen(fields[0]) == 2 * TRACE_FRAME_SIZE &&
+               parseHex(fields[0], record.frame, TRACE_FRAME_SIZE);
+      }
+      for (int j = 0; j < count - 2; j++) {
+        record.values[j] = strtof(fields[j], nullptr); // "nan" included
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool loadTrace(const char *path, std::vector<TraceRecord> &records) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+
+  char line[256];
+  TraceRecord record;
+  while (fgets(line, sizeof(line), file)) {
+    if (parseTraceLine(line, record)) {
+      records.push_back(record);
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+Hp206cModel::Hp206cModel() {
+  pressure = 0;
+  temperature = 0;
+  altitude = 0;
+  command = 0;
+  readCount = 0;
+}
+
+void Hp206cModel::set(long pressure, long temperature, long altitude) {
+  this->pressure = pressure;
+  this->temperature = temperature;
+  this->altitude = altitude;
+}
+
+void Hp206cModel::receive(const uint8_t *data, size_t length) {
+  if (length > 0) {
+    command = data[0];
+  }
+}
+
+size_t Hp206cModel::request(uint8_t *buffer, size_t length) {
+  long value = 0;
+  switch (command) {
+  case 0x30: // HP20X_READ_P
+    value = pressure;
+    readCount++;
+    break;
+  case 0x31: // HP20X_READ_A
+    value = altitude;
+    break;
+  case 0x32: // HP20X_READ_T
+    value = temperature;
+    break;
+  default: // register reads
+    break;
+  }
+
+  // 24-bit big-endian, two's complement
+  uint8_t bytes[3] = {(uint8_t)(value >> 16), (uint8_t)(value >> 8),
+                      (uint8_t)value};
+  for (size_t i = 0; i < length; i++) {
+    buffer[i] = i < 3 ? bytes[i] : 0;
+  }
+  return length;
+}
+
+Hm330xModel::Hm330xModel() {
+  memset(frame, 0, sizeof(frame));
+  hasFrame = false;
+  readCount = 0;
+}
+
+void Hm330xModel::set(const uint8_t *frame) {
+  memcpy(this->frame, frame, TRACE_FRAME_SIZE);
+  hasFrame = true;
+}
+
+void Hm330xModel::receive(const uint8_t *data, size_t length) {
+  (void)data;
+  (void)length;
+}
+
+size_t Hm330xModel::request(uint8_t *buffer, size_t length) {
+  if (!hasFrame) {
+    return 0;
+  }
+  readCount++;
+  if (length > TRACE_FRAME_SIZE) {
+    length = TRACE_FRAME_SIZE;
+  }
+  memcpy(buffer, frame, length);
+  return length;
+}
+
+uint8_t UltrasonicModel::echoPin = 0;
+uint8_t UltrasonicModel::triggerPins[TRACE_MAX_TRIGGERS];
+uint8_t UltrasonicModel::triggerLevels[TRACE_MAX_TRIGGERS];
+unsigned long UltrasonicModel::widths[TRACE_MAX_TRIGGERS];
+uint8_t UltrasonicModel::triggerCount = 0;
+
+void UltrasonicModel::begin(uint8_t echoPin, const uint8_t *triggerPins,
+                            uint8_t triggerCount) {
+  UltrasonicModel::echoPin = echoPin;
+  UltrasonicModel::triggerCount =
+      triggerCount > TRACE_MAX_TRIGGERS ? TRACE_MAX_TRIGGERS : triggerCount;
+  for (uint8_t i = 0; i < UltrasonicModel::triggerCount; i++) {
+    UltrasonicModel::triggerPins[i] = triggerPins[i];
+    triggerLevels[i] = LOW;
+    widths[i] = 0;
+  }
+  ArduinoHost::setPinWriteHandler(onPinWrite);
+}
+
+void UltrasonicModel::set(uint8_t spot, unsigned long width) {
+  if (spot < triggerCount) {
+    widths[spot] = width;
+  }
+}
+
+void UltrasonicModel::onPinWrite(uint8_t pin, uint8_t level) {
+  for (uint8_t i = 0; i < triggerCount; i++) {
+    if (triggerPins[i] != pin) {
+      continue;
+    }
+    bool falling = triggerLevels[i] == HIGH && level == LOW;
+    triggerLevels[i] = level;
+    if (falling && widths[i] > 0) {
+      uint64_t rise = ArduinoHost::now() + ECHO_START_DELAY;
+      ArduinoHost::schedule(rise, echoRise, nullptr);
+      ArduinoHost::schedule(rise + widths[i], echoFall, nullptr);
+    }
+  }
+}
+
+void UltrasonicModel::echoRise(void *context) {
+  (void)context;
+  ArduinoHost::setDigital(echoPin, HIGH);
+}
+
+void UltrasonicModel::echoFall(void *context) {
+  (void)context;
+  ArduinoHost::setDigital(echoPin, LOW);
+}
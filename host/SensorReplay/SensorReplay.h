@@ -0,0 +1,88 @@
+#ifndef SENSOR_REPLAY_H
+#define SENSOR_REPLAY_H
+
+#include <ArduinoHost.h>
+#include <stdint.h>
+
+#include <vector>
+
+#define TRACE_MAX_VALUES 3
+#define TRACE_FRAME_SIZE 29 // HM330X frame
+#define TRACE_MAX_TRIGGERS 8
+#define ECHO_START_DELAY 450 // us from the end of the trigger to the echo
+
+enum TraceKind : uint8_t {
+  TRACE_DHT,    // temperature humidity
+  TRACE_HP206C, // raw pressure, temperature, altitude (0.01 units)
+  TRACE_HM330X, // frame as hex
+  TRACE_AQI,    // gas sensor voltage, 10-bit ADC units
+  TRACE_ECHO,   // spot, echo width in us (0 = no echo)
+  TRACE_KIND_COUNT
+};
+
+struct TraceRecord {
+  unsigned long time; // ms
+  TraceKind kind;
+  float values[TRACE_MAX_VALUES];
+  uint8_t frame[TRACE_FRAME_SIZE];
+};
+
+// Parses "[TRACE ]<ms> <kind> <fields...>"; anything else is rejected, so a
+// whole console capture can be loaded as is.
+bool parseTraceLine(const char *line, TraceRecord &record);
+bool loadTrace(const char *path, std::vector<TraceRecord> &records);
+
+// HP206C answering the HP20x_dev command set with the traced raw values
+class Hp206cModel : public ArduinoHost::I2cDevice {
+private:
+  long pressure;
+  long temperature;
+  long altitude;
+  uint8_t command;
+  unsigned long readCount;
+
+public:
+  Hp206cModel();
+  void set(long pressure, long temperature, long altitude);
+  void receive(const uint8_t *data, size_t length);
+  size_t request(uint8_t *buffer, size_t length);
+  // Pressure readings taken, one per sample of the firmware
+  unsigned long getReadCount() { return readCount; }
+};
+
+// HM330X returning the last traced frame
+class Hm330xModel : public ArduinoHost::I2cDevice {
+private:
+  uint8_t frame[TRACE_FRAME_SIZE];
+  bool hasFrame;
+  unsigned long readCount;
+
+public:
+  Hm330xModel();
+  void set(const uint8_t *frame);
+  void receive(const uint8_t *data, size_t length);
+  size_t request(uint8_t *buffer, size_t length);
+  unsigned long getReadCount() { return readCount; }
+};
+
+// HC-SR04s sharing one echo pin: the end of a trigger pulse starts an echo
+// as wide as the last one traced for that spot.
+class UltrasonicModel {
+public:
+  static void begin(uint8_t echoPin, const uint8_t *triggerPins,
+                    uint8_t triggerCount);
+  static void set(uint8_t spot, unsigned long width);
+
+private:
+  static uint8_t echoPin;
+  static uint8_t triggerPins[TRACE_MAX_TRIGGERS];
+  static uint8_t triggerLevels[TRACE_MAX_TRIGGERS];
+  static unsigned long widths[TRACE_MAX_TRIGGERS];
+  static uint8_t triggerCount;
+
+  static void onPinWrite(uint8_t pin, uint8_t level);
+  static void echoRise(void *context);
+  static void echoFall(void *context);
+};
+
+#endif // SENSOR_REPLAY_H
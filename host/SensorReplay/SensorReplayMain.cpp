@@ -0,0 +1,165 @@
+// Replays a sensor trace through the firmware linked with it, at virtual
+// time, and prints every uplink it sends as "<ms>,<port>,<hex payload>".
+
+#include <Arduino.h>
+#include <ArduinoHost.h>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SensorReplay.h"
+
+#define REPLAY_LORA_RX_PIN 10
+#define REPLAY_AQI_PIN A0
+#define REPLAY_ECHO_PIN 2
+#define REPLAY_TRIGGER_PIN 5
+#define REPLAY_TAIL 60000 // ms run after the last record
+#define REPLAY_LINE_SIZE 160
+
+static Hp206cModel hp206c;
+static Hm330xModel hm330x;
+static uint8_t aqiPin = REPLAY_AQI_PIN;
+static unsigned long uplinkCount = 0;
+
+static char modemLine[REPLAY_LINE_SIZE];
+static uint8_t modemLineLength = 0;
+
+static void onModemByte(uint8_t rxPin, uint8_t data) {
+  (void)rxPin;
+  if (data != '\n') {
+    if (data != '\r' && modemLineLength < REPLAY_LINE_SIZE - 1) {
+      modemLine[modemLineLength++] = data;
+    }
+    return;
+  }
+  modemLine[modemLineLength] = '\0';
+  modemLineLength = 0;
+
+  // AT+SENDB=<confirmed>,<port>,<length>,<hex>
+  unsigned confirmed, port, length;
+  char hex[REPLAY_LINE_SIZE];
+  if (sscanf(modemLine, "AT+SENDB=%u,%u,%u,%159s", &confirmed, &port, &length,
+             hex) == 4) {
+    printf("%lu,%u,%s\n", millis(), port, hex);
+    uplinkCount++;
+  }
+}
+
+static void apply(const TraceRecord &record) {
+  switch (record.kind) {
+  case TRACE_DHT:
+    ArduinoHost::setDhtReading(record.values[0], record.values[1]);
+    break;
+  case TRACE_HP206C:
+    hp206c.set(record.values[0], record.values[1], record.values[2]);
+    break;
+  case TRACE_HM330X:
+    hm330x.set(record.frame);
+    break;
+  case TRACE_AQI:
+    ArduinoHost::setAnalog(aqiPin, record.values[0] + 0.5);
+    break;
+  case TRACE_ECHO:
+    UltrasonicModel::set(record.values[0], record.values[1]);
+    break;
+  default:
+    break;
+  }
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s <trace> [-v] [-l loop_us] [-r lora_rx_pin] [-a aqi_pin]\n"
+          "       [-e echo_pin] [-p trigger_pin[,trigger_pin...]]\n",
+          program);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  bool verbose = false;
+  unsigned long loopTime = HOST_LOOP_TIME;
+  uint8_t loraRxPin = REPLAY_LORA_RX_PIN;
+  uint8_t echoPin = REPLAY_ECHO_PIN;
+  uint8_t triggerPins[TRACE_MAX_TRIGGERS] = {REPLAY_TRIGGER_PIN};
+  uint8_t triggerCount = 1;
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    } else if (strcmp(argv[i], "-l") == 0) {
+      loopTime = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      loraRxPin = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-a") == 0) {
+      aqiPin = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-e") == 0) {
+      echoPin = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-p") == 0) {
+      triggerCount = 0;
+      for (char *pin = strtok(argv[++i], ",");
+           pin && triggerCount < TRACE_MAX_TRIGGERS; pin = strtok(nullptr, ",")) {
+        triggerPins[triggerCount++] = atoi(pin);
+      }
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<TraceRecord> records;
+  if (!loadTrace(argv[1], records) || records.empty()) {
+    fprintf(stderr, "%s: no trace records\n", argv[1]);
+    return 1;
+  }
+
+  ArduinoHost::setSerialOutput(verbose);
+  ArduinoHost::setSoftwareSerialHandler(onModemByte);
+  ArduinoHost::attachI2cDevice(0x76, &hp206c);
+  ArduinoHost::attachI2cDevice(0x40, &hm330x);
+  UltrasonicModel::begin(echoPin, triggerPins, triggerCount);
+
+  // Sensors hold their first traced value from power-up
+  bool primed[TRACE_KIND_COUNT] = {false};
+  for (const TraceRecord &record : records) {
+    if (!primed[record.kind]) {
+      apply(record);
+      primed[record.kind] = true;
+    }
+  }
+
+  auto wallStart = std::chrono::steady_clock::now();
+  setup();
+  ArduinoHost::softwareSerialInput(loraRxPin, "JOINED\r\n");
+
+  // Record times are kept relative to the first one
+  unsigned long origin = records.front().time;
+  unsigned long end = records.back().time - origin + REPLAY_TAIL;
+  size_t next = 0;
+  while (millis() < end) {
+    while (next < records.size() && records[next].time - origin <= millis()) {
+      apply(records[next++]);
+    }
+    loop();
+    ArduinoHost::advanceMicros(loopTime);
+  }
+
+  double wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - wallStart)
+                    .count();
+  fprintf(stderr, "%zu records, %lu uplinks, %.1f s replayed in %.2f s (x%.0f)\n",
+          records.size(), uplinkCount, millis() / 1000.0, wall,
+          millis() / 1000.0 / (wall > 0 ? wall : 1e-9));
+  // Samples the firmware took, to weigh against what its uplinks lost
+  if (hp206c.getReadCount() > 0 || hm330x.getReadCount() > 0) {
+    fprintf(stderr, "sensor reads: hp206c %lu, hm330x %lu\n",
+            hp206c.getReadCount(), hm330x.getReadCount());
+  }
+  return 0;
+}
@@ -0,0 +1,7 @@
+#!/bin/sh
+# Cycle counts of the portable kernels on an ATmega328P at 16 MHz, under
+# simavr. The same firmware prints identical counts on a real Uno.
+set -e
+cd "$(dirname "$0")"
+pio run -e avr
+simavr -m atmega328p -f 16000000 .pio/build/avr/firmware.elf
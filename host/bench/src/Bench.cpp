@@ -0,0 +1,132 @@
+#include "Bench.h"
+
+volatile uint32_t benchSink;
+
+#if defined(ARDUINO_HOST)
+
+#include <chrono>
+
+static unsigned long allocations = 0;
+static bool countingAllocations = true;
+
+#if defined(__GLIBC__)
+// Counts every heap allocation, including those made by String and new
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size) {
+  if (countingAllocations) {
+    allocations++;
+  }
+  return __libc_malloc(size);
+}
+#endif
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void benchCountAllocations(bool enabled) { countingAllocations = enabled; }
+
+void benchBegin() {
+  printf("%-24s %10s %12s %10s\n", "benchmark", "ops", "ns/op", "allocs/op");
+}
+
+void benchRun(const Benchmark &benchmark) {
+  if (benchmark.setup) {
+    benchmark.setup();
+  }
+  for (uint16_t i = 0; i < benchmark.iterations; i++) {
+    benchmark.run(); // warm-up
+  }
+
+  unsigned long ops = 0;
+  unsigned long allocationsBefore = allocations;
+  uint64_t start = nowNs();
+  uint64_t elapsed;
+  do {
+    for (uint16_t i = 0; i < benchmark.iterations; i++) {
+      benchmark.run();
+    }
+    ops += benchmark.iterations;
+    elapsed = nowNs() - start;
+  } while (elapsed < BENCH_MIN_TIME);
+
+  printf("%-24s %10lu %12.1f %10.2f\n", benchmark.name, ops,
+         (double)elapsed / ops,
+         (double)(allocations - allocationsBefore) / ops);
+}
+
+void benchAccuracyBegin() {
+  printf("\n%-24s %12s\n", "fixed point", "max error");
+}
+
+void benchAccuracy(const char *name, float maxError) {
+  printf("%-24s %12.6f\n", name, maxError);
+}
+
+#else
+
+// Timer1 at the CPU clock; its overflows extend it to 32 bits
+static volatile uint16_t timerOverflows;
+
+ISR(TIMER1_OVF_vect) { timerOverflows++; }
+
+static uint32_t cycles() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t count = TCNT1;
+  uint16_t overflows = timerOverflows;
+  if ((TIFR1 & _BV(TOV1)) && count < 0x8000) {
+    overflows++; // wrapped after interrupts were masked
+  }
+  SREG = oldSREG;
+  return ((uint32_t)overflows << 16) | count;
+}
+
+void benchBegin() {
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TIMSK1 = _BV(TOIE1);
+  // Timer0 ticks would land in the kernels' counts
+  TIMSK0 = 0;
+
+  Serial.println(F("benchmark                  cycles/op"));
+}
+
+void benchRun(const Benchmark &benchmark) {
+  if (benchmark.setup) {
+    benchmark.setup();
+  }
+
+  uint32_t start = cycles();
+  uint32_t overhead = cycles() - start;
+
+  start = cycles();
+  for (uint16_t i = 0; i < benchmark.iterations; i++) {
+    benchmark.run();
+  }
+  uint32_t elapsed = cycles() - start - overhead;
+
+  Serial.print(benchmark.name);
+  for (uint8_t i = strlen(benchmark.name); i < 26; i++) {
+    Serial.print(' ');
+  }
+  Serial.println(elapsed / benchmark.iterations);
+  Serial.flush();
+}
+
+void benchAccuracyBegin() {
+  Serial.println(F("\nfixed point                max error"));
+}
+
+void benchAccuracy(const char *name, float maxError) {
+  Serial.print(name);
+  for (uint8_t i = strlen(name); i < 26; i++) {
+    Serial.print(' ');
+  }
+  Serial.println(maxError, 6);
+  Serial.flush();
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_HOST)
+#define BENCH_MIN_TIME 200000000ULL // ns of measurement per benchmark, at least
+#endif
+
+// One kernel: setup() runs once, then run() is timed in batches of
+// `iterations` calls. Host-only kernels need peripherals from ArduinoHost.
+struct Benchmark {
+  const char *name;
+  void (*setup)();
+  void (*run)();
+  uint16_t iterations;
+};
+
+// Host: ns/op and heap allocations/op. AVR: CPU cycles/op, from Timer1.
+void benchBegin();
+void benchRun(const Benchmark &benchmark);
+
+#if defined(ARDUINO_HOST)
+// Host: leaves out of allocs/op what a kernel allocates while disabled, such
+// as the shim feeding a peripheral
+void benchCountAllocations(bool enabled);
+#endif
+
+// Largest absolute difference between a fixed-point kernel and its float
+// original over the same inputs
+void benchAccuracyBegin();
+void benchAccuracy(const char *name, float maxError);
+
+// Keeps results alive so the optimizer cannot drop a kernel
+extern volatile uint32_t benchSink;
+
+#endif // BENCH_H
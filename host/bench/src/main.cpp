@@ -0,0 +1,378 @@
+#include <Arduino.h>
+#include <BaselineEstimator.h>
+#include <FixedPoint.h>
+#include <KalmanFilter.h>
+#include <OutlierFilter.h>
+
+#include "Bench.h"
+
+#if defined(ARDUINO_HOST)
+#include <ArduinoHost.h>
+#include <HP20x_dev.h>
+#include <LoRaManager.h>
+#endif
+
+#define LORA_RX_PIN 10
+#define LORA_TX_PIN 11
+
+// Distances with an outlier, as seen while calibrating a parking spot
+static const float CALIBRATION_READINGS[15] = {
+    152.1, 151.8, 152.4, 151.9, 173.0, 152.0, 152.2, 151.7,
+    152.3, 152.0, 131.5, 151.9, 152.1, 152.2, 151.8};
+
+static uint8_t readingIndex = 0;
+
+static float nextReading() {
+  float reading = CALIBRATION_READINGS[readingIndex];
+  readingIndex = (readingIndex + 1) % 15;
+  return reading;
+}
+
+// KalmanFilter::Filter, which reseeds rand() and draws ten samples per call
+
+static KalmanFilter filter;
+
+static void runKalmanFilter() {
+  float filtered = filter.Filter(nextReading() / 6.0);
+  benchSink = filtered * 100;
+}
+
+// The Q16.16 variant, fed hundredths as WeatherStation does
+
+static KalmanFilterFixed filterFixed;
+
+static void runKalmanFilterFixed() {
+  Q16_16 filtered =
+      filterFixed.Filter(Q16_16::ratio(nextReading() * 100 / 6, 100));
+  benchSink = filtered.getRaw();
+}
+
+// ParkingSensor::processDistance decisions: mean of the last three readings,
+// consistency of each reading with it and the distance to the baseline
+
+static const float BASELINE = 152.0;
+
+static void runDistanceAverage() {
+  float history[3] = {nextReading(), nextReading(), nextReading()};
+  float average = (history[0] + history[1] + history[2]) / 3;
+  bool consistent = true;
+  for (uint8_t i = 0; i < 3; i++) {
+    if (abs(history[i] - average) > 0.5) {
+      consistent = false;
+    }
+  }
+  benchSink = consistent && abs(average - BASELINE) > 0.6;
+}
+
+static Q24_8 readingsFixed[15];
+
+static void setupDistanceAverageFixed() {
+  for (uint8_t i = 0; i < 15; i++) {
+    readingsFixed[i] = Q24_8::fromFloat(CALIBRATION_READINGS[i]);
+  }
+}
+
+static void runDistanceAverageFixed() {
+  Q24_8 history[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    history[i] = readingsFixed[readingIndex];
+    readingIndex = (readingIndex + 1) % 15;
+  }
+  Q24_8 average = (history[0] + history[1] + history[2]) / 3;
+  bool consistent = true;
+  for (uint8_t i = 0; i < 3; i++) {
+    if ((history[i] - average).absolute() > Q24_8::fromFloat(0.5)) {
+      consistent = false;
+    }
+  }
+  benchSink = consistent &&
+              (average - Q24_8::fromFloat(BASELINE)).absolute() >
+                  Q24_8::fromFloat(0.6);
+}
+
+// Hex encoding of the 17-byte weather payload as sendWeatherData did it before
+// streaming the AT command; kept as the baseline for send_weather_data
+
+static void runHexEncode() {
+  uint8_t payload[17];
+  char buffer[128];
+  for (uint8_t i = 0; i < sizeof(payload); i++) {
+    payload[i] = i * 37 + benchSink;
+  }
+
+  int offset = snprintf(buffer, sizeof(buffer), "AT+SENDB=%d,%d,%d,", 1, 2,
+                        (int)sizeof(payload));
+  for (uint8_t i = 0; i < sizeof(payload); i++) {
+    offset += snprintf(&buffer[offset], sizeof(buffer) - offset, "%02X",
+                       payload[i]);
+  }
+  benchSink = buffer[offset - 1];
+}
+
+// 24 to 32-bit sign extension from HP20X_IIC_ReadData3byte
+
+static void runSignExtend() {
+  uint32_t raw[3] = {(uint32_t)(0xFF ^ benchSink) & 0xFF, 0xFE, 0x0C};
+  uint32_t value = raw[0] << 16 | raw[1] << 8 | raw[2];
+  if (value & 0x800000) {
+    value |= 0xff000000;
+  }
+  benchSink = value;
+}
+
+// Baseline calibration: the original sort of all 15 readings, against the
+// sliding BaselineEstimator fed one reading at a time
+
+static void runLegacyBaselineSort() {
+  float readings[15];
+  for (uint8_t i = 0; i < 15; i++) {
+    readings[i] = nextReading();
+  }
+
+  for (int i = 0; i < 15 - 1; i++) {
+    for (int j = i + 1; j < 15; j++) {
+      if (readings[i] > readings[j]) {
+        float temp = readings[i];
+        readings[i] = readings[j];
+        readings[j] = temp;
+      }
+    }
+  }
+
+  float sum = 0;
+  int count = 0;
+  for (int i = 15 * 0.2; i < (int)(15 * 0.8); i++) {
+    sum += readings[i];
+    count++;
+  }
+  benchSink = sum / count * 100;
+}
+
+static BaselineEstimator baselineEstimator;
+
+static void setupBaselineEstimator() {
+  for (uint8_t i = 0; i < 15; i++) {
+    baselineEstimator.add(nextReading());
+  }
+}
+
+static void runBaselineEstimator() {
+  baselineEstimator.add(nextReading());
+  benchSink = baselineEstimator.trimmedMean() * 100;
+}
+
+// OutlierFilter, one reading per update: the Hampel filter as on the DHT11
+// (float), HP206C (hundredths) and HC-SR04 (Q24.8) inputs, then on a window
+// three times longer, against the plain median and trimmed mean
+
+static HampelFilter<float, 5> hampelFilter(4, 2.0);
+
+static void runHampelFilter() {
+  benchSink = hampelFilter.filter(nextReading()) * 100;
+}
+
+static HampelFilter<long, 5> hampelFilterLong(4, 100);
+
+static void runHampelFilterLong() {
+  benchSink = hampelFilterLong.filter((long)(nextReading() * 100));
+}
+
+static HampelFilter<Q24_8, 5> hampelFilterFixed(Q24_8::fromInt(4),
+                                                Q24_8::fromFloat(2.0));
+
+static void runHampelFilterFixed() {
+  benchSink = hampelFilterFixed.filter(readingsFixed[readingIndex]).getRaw();
+  readingIndex = (readingIndex + 1) % 15;
+}
+
+static HampelFilter<float, 15> hampelFilter15(4, 2.0);
+
+static void runHampelFilter15() {
+  benchSink = hampelFilter15.filter(nextReading()) * 100;
+}
+
+static RunningMedian<float, 5> runningMedian;
+
+static void runRunningMedian() {
+  benchSink = runningMedian.filter(nextReading()) * 100;
+}
+
+static TrimmedMean<float, 5, 1> trimmedMean;
+
+static void runTrimmedMean() {
+  benchSink = trimmedMean.filter(nextReading()) * 100;
+}
+
+// A whole HM330X burst as in AirQuality::burstMean: five frames in, then each
+// checked against the others
+
+static HampelFilter<uint16_t, 5> burst(4, 10);
+
+static void runHampelBurst() {
+  burst.reset();
+  for (uint8_t i = 0; i < 5; i++) {
+    burst.add((uint16_t)nextReading());
+  }
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < burst.getCount(); i++) {
+    uint16_t value = burst.get(i);
+    sum += burst.isOutlier(value) ? burst.median() : value;
+  }
+  benchSink = sum;
+}
+
+#if defined(ARDUINO_HOST)
+
+// Node paths that need a modem or a sensor on the other end
+
+static LoRaManager *loraManager;
+
+static void setupLoRaManager() {
+  if (!loraManager) {
+    loraManager = new LoRaManager(LORA_RX_PIN, LORA_TX_PIN);
+    loraManager->begin();
+    ArduinoHost::softwareSerialInput(LORA_RX_PIN, "JOINED\r\n");
+    loraManager->handleLoRaMessages();
+  }
+}
+
+static void runSendWeatherData() {
+  loraManager->sendWeatherData(21.5, 1013.2, 48.0, 112.0, 0);
+}
+
+static void runLoRaRxLine() {
+  // The shim's receive queue allocates, the node's 64-byte buffer does not
+  benchCountAllocations(false);
+  ArduinoHost::softwareSerialInput(LORA_RX_PIN,
+                                   "TX on freq 868100000 Hz at DR 5\r\n");
+  benchCountAllocations(true);
+  loraManager->handleLoRaMessages();
+}
+
+// Answers every read with a negative 24-bit value
+class HP206C : public ArduinoHost::I2cDevice {
+public:
+  void receive(const uint8_t *data, size_t length) {
+    (void)data;
+    (void)length;
+  }
+  size_t request(uint8_t *buffer, size_t length) {
+    static const uint8_t reading[3] = {0xFF, 0xFE, 0x0C};
+    for (size_t i = 0; i < length; i++) {
+      buffer[i] = reading[i % 3];
+    }
+    return length;
+  }
+};
+
+static HP206C hp206c;
+static HP20x_dev hp20x;
+
+static void setupHP20x() {
+  ArduinoHost::attachI2cDevice(HP20X_I2C_DEV_ID, &hp206c);
+}
+
+static void runHP20xReadPressure() { benchSink = hp20x.ReadPressure(); }
+
+#endif
+
+static const Benchmark BENCHMARKS[] = {
+    {"kalman_filter", nullptr, runKalmanFilter, 100},
+    {"kalman_filter_fixed", nullptr, runKalmanFilterFixed, 100},
+    {"distance_average", nullptr, runDistanceAverage, 1000},
+    {"distance_average_fixed", setupDistanceAverageFixed,
+     runDistanceAverageFixed, 1000},
+    {"hex_legacy_sprintf", nullptr, runHexEncode, 100},
+    {"sign_extend_24", nullptr, runSignExtend, 1000},
+    {"baseline_legacy_sort", nullptr, runLegacyBaselineSort, 100},
+    {"baseline_estimator", setupBaselineEstimator, runBaselineEstimator, 100},
+    {"hampel_filter", nullptr, runHampelFilter, 1000},
+    {"hampel_filter_long", nullptr, runHampelFilterLong, 1000},
+    {"hampel_filter_fixed", setupDistanceAverageFixed, runHampelFilterFixed,
+     1000},
+    {"hampel_filter_15", nullptr, runHampelFilter15, 100},
+    {"running_median", nullptr, runRunningMedian, 1000},
+    {"trimmed_mean", nullptr, runTrimmedMean, 1000},
+    {"hampel_burst", nullptr, runHampelBurst, 100},
+#if defined(ARDUINO_HOST)
+    {"send_weather_data", setupLoRaManager, runSendWeatherData, 100},
+    {"lora_rx_line", setupLoRaManager, runLoRaRxLine, 100},
+    {"hp20x_read_pressure", setupHP20x, runHP20xReadPressure, 100},
+#endif
+};
+
+// Largest gaps between the fixed-point paths and their float originals,
+// which draw the same noise samples
+
+static void compareKalmanFilters() {
+  KalmanFilter reference;
+  KalmanFilterFixed fixed;
+  float maxError = 0;
+  for (uint16_t i = 0; i < 1000; i++) {
+    // A slow pressure swing around 1013.25 hPa, in the driver's hundredths
+    long raw = 101325 + (long)(i % 200) * 3 - (i % 200 < 100 ? 0 : 600);
+    float error = abs(reference.Filter(raw / 100.0) -
+                      fixed.Filter(Q16_16::ratio(raw, 100)).toFloat());
+    if (error > maxError) {
+      maxError = error;
+    }
+  }
+  benchAccuracy("kalman_filter_fixed", maxError);
+}
+
+static void compareDistanceAverages() {
+  float maxError = 0;
+  for (uint8_t i = 0; i < 15; i++) {
+    float history[3];
+    Q24_8 historyFixed[3];
+    for (uint8_t j = 0; j < 3; j++) {
+      history[j] = CALIBRATION_READINGS[(i + j) % 15];
+      historyFixed[j] = Q24_8::fromFloat(history[j]);
+    }
+    float average = (history[0] + history[1] + history[2]) / 3;
+    Q24_8 averageFixed =
+        (historyFixed[0] + historyFixed[1] + historyFixed[2]) / 3;
+    float error = abs(average - averageFixed.toFloat());
+    if (error > maxError) {
+      maxError = error;
+    }
+  }
+  benchAccuracy("distance_average_fixed", maxError);
+}
+
+static void runAll() {
+  benchBegin();
+  for (const Benchmark &benchmark : BENCHMARKS) {
+    benchRun(benchmark);
+  }
+
+  benchAccuracyBegin();
+  compareKalmanFilters();
+  compareDistanceAverages();
+}
+
+#if defined(ARDUINO_HOST)
+
+int main() {
+  // The node logs to Serial on every call; only the report is wanted here
+  ArduinoHost::setSerialOutput(false);
+  runAll();
+  return 0;
+}
+
+#else
+
+void setup() {
+  Serial.begin(115200);
+  runAll();
+
+  // simavr stops on a sleep with interrupts masked
+  Serial.flush();
+  cli();
+  SMCR = _BV(SE);
+  __asm__ __volatile__("sleep");
+}
+
+void loop() {}
+
+#endif
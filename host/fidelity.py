@@ -0,0 +1,101 @@
+"""Measures lost between two replays of the same trace, uplink by uplink.
+
+The reference is usually the firmware sampling at a fixed rate and the
+candidate the same firmware with adaptive sampling:
+
+    .pio/build/replay/program day.trace > reference.csv
+    .pio/build/replay/program day.trace > adaptive.csv
+    python3 ../host/fidelity.py reference.csv adaptive.csv
+
+Each candidate uplink on the data port (2) is compared with the reference
+uplink sent closest in time. The mean and largest absolute error are printed
+per field, with the share of uplinks whose alert state differs. The samples
+taken on each side are in the replay summary ("sensor reads").
+"""
+
+import struct
+import sys
+
+DATA_PORT = 2
+MAX_OFFSET = 5000  # ms between two uplinks still taken as the same one
+
+
+def decode_weather(payload):
+    temperature, pressure, humidity, altitude = struct.unpack("<4f", payload[:16])
+    return {
+        "temperature": temperature,
+        "pressure": pressure,
+        "humidity": humidity,
+        "altitude": altitude,
+        "alerts": payload[16],
+    }
+
+
+def decode_air_quality(payload):
+    pm25, pm10, aqi = struct.unpack(">3H", payload[:6])
+    fields = {"pm25": pm25, "pm10": pm10, "aqi": aqi, "alerts": payload[6]}
+    if len(payload) >= 16:
+        names = ("nowcast_pm25", "nowcast_pm10", "day_pm25", "day_pm10")
+        for name, value in zip(names, struct.unpack(">4H", payload[7:15])):
+            if value != 0xFFFF:
+                fields[name] = value / 10
+    return fields
+
+
+# Data payload length of each node
+DECODERS = {17: decode_weather, 7: decode_air_quality, 16: decode_air_quality}
+
+
+def load(path):
+    uplinks = []
+    with open(path) as lines:
+        for line in lines:
+            parts = line.strip().split(",")
+            if len(parts) != 3 or not parts[0].isdigit():
+                continue
+            if int(parts[1]) != DATA_PORT:
+                continue
+            payload = bytes.fromhex(parts[2])
+            decoder = DECODERS.get(len(payload))
+            if decoder:
+                uplinks.append((int(parts[0]), decoder(payload)))
+    return uplinks
+
+
+def nearest(uplinks, time):
+    best = min(uplinks, key=lambda uplink: abs(uplink[0] - time))
+    return best if abs(best[0] - time) <= MAX_OFFSET else None
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: fidelity.py <reference.csv> <candidate.csv>")
+    reference = load(sys.argv[1])
+    candidate = load(sys.argv[2])
+    if not reference or not candidate:
+        sys.exit("no data uplinks to compare")
+
+    errors = {}
+    alert_mismatches = 0
+    compared = 0
+    for time, fields in candidate:
+        match = nearest(reference, time)
+        if not match:
+            continue
+        compared += 1
+        for name, value in fields.items():
+            if name == "alerts":
+                alert_mismatches += value != match[1]["alerts"]
+            elif name in match[1]:
+                errors.setdefault(name, []).append(abs(value - match[1][name]))
+
+    print("%d of %d uplinks matched" % (compared, len(candidate)))
+    print("%-14s %10s %10s" % ("field", "mean err", "max err"))
+    for name, values in errors.items():
+        print("%-14s %10.3f %10.3f" % (name, sum(values) / len(values), max(values)))
+    if compared:
+        print("alert state differs in %.1f %% of uplinks" % (100.0 * alert_mismatches / compared))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+"""Static RAM and flash footprint per library, from the linker map.
+
+As a PlatformIO extra script (extra_scripts = post:../host/footprint.py) it
+asks the linker for a map file and prints the table after each link of the
+AVR firmware. It can also be run on an existing map:
+
+    python3 host/footprint.py .pio/build/uno/firmware.map
+
+Sizes are those of the input sections kept in the final image, so code
+removed by --gc-sections is not counted. Flash is .text (code, PROGMEM,
+vectors) plus the initial values of .data; RAM is .data, .bss and .noinit.
+The stack and heap come on top of the RAM figure.
+"""
+
+import os
+import re
+import sys
+from collections import defaultdict
+
+FLASH_SECTIONS = (".text", ".data")
+RAM_SECTIONS = (".data", ".bss", ".noinit")
+
+OUTPUT_SECTION = re.compile(r"^(\.\w+)\s")
+INPUT_SECTION = re.compile(r"^ (\.\S+|COMMON)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+INPUT_SECTION_NAME = re.compile(r"^ (\.\S+|COMMON)$")
+INPUT_SECTION_REST = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+ARCHIVE_MEMBER = re.compile(r"^(.*)\((.*)\)$")
+
+ATMEGA328P_FLASH = 32256  # 32 KB minus the Optiboot bootloader
+ATMEGA328P_RAM = 2048
+
+
+def component(path):
+    """Library a linked object belongs to."""
+    member = ARCHIVE_MEMBER.match(path)
+    if member:
+        name = os.path.basename(member.group(1))
+        if name.startswith("lib") and name.endswith(".a"):
+            name = name[3:-2]
+        return name
+
+    parts = os.path.normpath(path).split(os.sep)
+    if "src" in parts:
+        return "src"
+    if len(parts) < 2 or parts[-1].startswith("crt"):
+        return os.path.splitext(parts[-1])[0]
+    return parts[-2]
+
+
+def parse_map(path):
+    """Returns {component: [flash, ram]} for the sections kept by the link."""
+    sizes = defaultdict(lambda: [0, 0])
+    output = None
+    pending = None
+    in_map = False
+
+    with open(path) as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+
+            found = OUTPUT_SECTION.match(line)
+            if found:
+                output = found.group(1)
+                pending = None
+                continue
+            if output is None:
+                continue
+
+            found = INPUT_SECTION.match(line)
+            if found:
+                size, source = int(found.group(3), 16), found.group(4)
+            elif pending:
+                found = INPUT_SECTION_REST.match(line)
+                pending = None
+                if not found:
+                    continue
+                size, source = int(found.group(2), 16), found.group(3)
+            else:
+                pending = INPUT_SECTION_NAME.match(line)
+                continue
+
+            if size == 0:
+                continue
+            entry = sizes[component(source)]
+            if output in FLASH_SECTIONS:
+                entry[0] += size
+            if output in RAM_SECTIONS:
+                entry[1] += size
+    return sizes
+
+
+def print_report(sizes, out=sys.stdout):
+    rows = sorted(sizes.items(), key=lambda item: (-item[1][1], -item[1][0]))
+    width = max([len(name) for name, _ in rows] + [9])
+    out.write("%-*s %7s %6s\n" % (width, "Component", "Flash", "RAM"))
+    for name, (flash, ram) in rows:
+        if flash or ram:
+            out.write("%-*s %7d %6d\n" % (width, name, flash, ram))
+
+    flash = sum(entry[0] for entry in sizes.values())
+    ram = sum(entry[1] for entry in sizes.values())
+    out.write("%-*s %7d %6d\n" % (width, "Total", flash, ram))
+    out.write("%.1f%% of flash, %.1f%% of RAM before stack and heap\n"
+              % (100.0 * flash / ATMEGA328P_FLASH, 100.0 * ram / ATMEGA328P_RAM))
+
+
+def main(argv):
+    if len(argv) != 1:
+        sys.stderr.write("usage: footprint.py <firmware.map>\n")
+        return 2
+    print_report(parse_map(argv[0]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
+else:
+    Import("env")  # noqa: F821, provided by PlatformIO
+
+    if env.get("PIOPLATFORM") == "atmelavr":  # noqa: F821
+        map_path = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")  # noqa: F821
+        env.Append(LINKFLAGS=["-Wl,-Map," + map_path])  # noqa: F821
+
+        def footprint_report(source, target, env):
+            print_report(parse_map(map_path))
+
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", footprint_report)  # noqa: F821
@@ -0,0 +1,149 @@
+"""Writes the synthetic sensor traces the replay measurements are made on.
+
+    python3 host/tracegen.py weather > weather.trace
+    python3 host/tracegen.py parking > parking.trace
+    python3 host/tracegen.py air_quality --hours 4 > air_quality.trace
+    python3 host/tracegen.py weather --glitch > weather-glitch.trace
+
+The traces use the TRACE line format of the uno_trace builds and replay
+through the replay environments:
+
+- weather: one hour of DHT and HP206C readings every 2 s, temperature and
+  pressure on slow sine waves with sensor noise.
+- parking: 4000 echoes of spot 0 every 150 ms, a car parked for 800 echoes
+  out of every 1600 (150 cm to the floor, 60 cm to the roof) with 0.3 cm of
+  jitter.
+- air_quality: per hour, the analog gas reading once a second, 120 then 400
+  after 30 min, and an HM330X frame 3 ms later, PM2.5 12 and PM10 20 ug/m3
+  then 40 and 70 after 20 min.
+
+With --glitch, sensor faults are injected into the trace, from their own
+seeded draws:
+
+- weather: 1 % of DHT readings turn to -8.0, 85.0 or 0.0 C and 1 % of
+  HP206C readings get one field zeroed.
+- parking: 2 % of echoes are off by 600 to 3000 us (10 to 50 cm).
+- air_quality: 2 % of HM330X frames read 150 to 600 ug/m3 on PM1.0, PM2.5
+  and PM10, with a valid checksum.
+
+The noise is seeded, so a trace is the same from one run to the next.
+"""
+
+import argparse
+import io
+import math
+import os
+import random
+import sys
+
+SEED = 3
+GLITCH_SEEDS = {"weather": 7, "parking": 3, "air_quality": 5}
+
+
+def weather(out, rng):
+    for time in range(0, 3600 * 1000, 2000):
+        t = time / 1000
+        temperature = 22 + 8 * math.sin(t / 600) + rng.gauss(0, 0.3)
+        humidity = 55 + rng.gauss(0, 2)
+        out.write(f"TRACE {time} dht {temperature:.1f} {humidity:.0f}\n")
+        pressure = int(101325 + 300 * math.sin(t / 900) + rng.gauss(0, 20))
+        altitude = int(110 + rng.gauss(0, 5)) * 100
+        out.write(f"TRACE {time} hp206c {pressure} {int(temperature * 100)} "
+                  f"{altitude}\n")
+
+
+def parking(out, rng):
+    time = 0
+    for echo in range(4000):
+        time += 150
+        distance = 150 if (echo // 800) % 2 == 0 else 60  # cm
+        # 58 us of echo per cm
+        width = int((distance + rng.gauss(0, 0.3)) * 58)
+        out.write(f"TRACE {time} echo 0 {width}\n")
+
+
+def hm330x_frame(pm25, pm10):
+    """A 29-byte HM330X frame in hex, atmospheric values in words 4 to 6."""
+    frame = bytearray(29)
+    frame[3] = 1
+    for offset, value in ((4, pm25 - 2), (6, pm25), (8, pm10)):
+        frame[offset:offset + 2] = value.to_bytes(2, "big")
+    frame[28] = sum(frame[:28]) & 0xFF
+    return frame.hex().upper()
+
+
+def air_quality(out, hours):
+    span = 3600 * 1000
+    for hour in range(hours):
+        # Each hour starts 1 s after the previous one's last frame
+        start = hour * (span + 3)
+        for t in range(0, span, 1000):
+            aqi = 120 if t < span // 2 else 400
+            out.write(f"TRACE {start + t} aqi {aqi}.00\n")
+            if t < span // 3:
+                frame = hm330x_frame(12, 20)
+            else:
+                frame = hm330x_frame(40, 70)
+            out.write(f"TRACE {start + t + 3} hm330x {frame}\n")
+
+
+def glitch_weather(fields, rng):
+    if fields[2] == "dht" and rng.random() < 0.01:
+        fields[3] = rng.choice(["-8.0", "85.0", "0.0"])
+    if fields[2] == "hp206c" and rng.random() < 0.01:
+        fields[rng.choice([3, 4, 5])] = "0"
+
+
+def glitch_parking(fields, rng):
+    if rng.random() < 0.02:
+        width = int(fields[4]) + rng.choice([-1, 1]) * rng.randint(600, 3000)
+        fields[4] = str(max(60, width))
+
+
+def glitch_air_quality(fields, rng):
+    if fields[2] == "hm330x" and rng.random() < 0.02:
+        frame = bytearray.fromhex(fields[3])
+        value = rng.randint(150, 600)
+        for offset in (6, 8, 10):
+            frame[offset:offset + 2] = value.to_bytes(2, "big")
+        frame[28] = sum(frame[:28]) & 0xFF
+        fields[3] = frame.hex().upper()
+
+
+def glitch(trace, out, node):
+    inject = {"weather": glitch_weather, "parking": glitch_parking,
+              "air_quality": glitch_air_quality}[node]
+    rng = random.Random(GLITCH_SEEDS[node])
+    for line in trace:
+        fields = line.split()
+        inject(fields, rng)
+        out.write(" ".join(fields) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("node", choices=("weather", "parking", "air_quality"))
+    parser.add_argument("--hours", type=int, default=1,
+                        help="air_quality: hours of trace (default 1)")
+    parser.add_argument("--glitch", action="store_true",
+                        help="inject sensor faults into the trace")
+    args = parser.parse_args()
+
+    rng = random.Random(SEED)
+    out = io.StringIO() if args.glitch else sys.stdout
+    if args.node == "weather":
+        weather(out, rng)
+    elif args.node == "parking":
+        # Drawn after the weather noise, as for the traces the replay figures
+        # were measured on
+        with open(os.devnull, "w") as discard:
+            weather(discard, rng)
+        parking(out, rng)
+    else:
+        air_quality(out, args.hours)
+    if args.glitch:
+        glitch(out.getvalue().splitlines(), sys.stdout, args.node)
+
+
+if __name__ == "__main__":
+    main()
@@ -2,16 +2,215 @@
 * LORAWAN PARKING SENSOR DECODER
 * 
 * This decoder handles data from a smart parking system with ultrasonic sensor
-* The payload consists of:
+* Legacy single-spot payload (fPort 2):
 * - 2 bytes: Occupancy time (seconds)
 * - 1 byte: Parking state (0 = FREE, 1 = OCCUPIED)
+*
+* Loop profile (fPort 9) and memory report (fPort 10), see decodeProfile
+* and decodeMemory
+*
+* Multi-spot payload (fPort 3):
+* - 1 byte: Number of spots N
+* - 1 byte: Occupancy bitmap (bit i set = spot i OCCUPIED)
+* - 2 bytes per occupied spot, in spot order: Occupancy time (minutes)
+* - Optional batch of completed sessions, if bytes remain:
+*   - 1 byte: Number of sessions
+*   - varint: Sessions dropped on the node since the previous batch
+*   - per session: 1 byte spot, zigzag varint start delta (seconds before the
+*     previous reference, the first one being the reception time), varint
+*     duration (seconds)
 */
 
+function formatDuration(seconds) {
+    if (seconds < 60) {
+        return seconds + 's';
+    }
+    var hours = Math.floor(seconds / 3600);
+    var minutes = Math.floor((seconds % 3600) / 60);
+    var formatted = '';
+    if (hours > 0) {
+        formatted += hours + 'h ';
+    }
+    formatted += minutes + 'm ';
+    formatted += (seconds % 60) + 's';
+    return formatted;
+}
+
+function readVarint(bytes, cursor) {
+    var value = 0;
+    var factor = 1;
+    var byte;
+    do {
+        byte = bytes[cursor.index++];
+        value += (byte & 0x7F) * factor;
+        factor *= 128;
+    } while (byte & 0x80);
+    return value;
+}
+
+function decodeSessions(bytes, index, receivedAt) {
+    var cursor = { index: index };
+    var count = bytes[cursor.index++];
+    var batch = {
+        droppedSessions: readVarint(bytes, cursor),
+        sessions: []
+    };
+    var reference = receivedAt;
+
+    for (var i = 0; i < count; i++) {
+        var spot = bytes[cursor.index++];
+        var zigzag = readVarint(bytes, cursor);
+        var delta = (zigzag % 2) ? -(zigzag + 1) / 2 : zigzag / 2;
+        var duration = readVarint(bytes, cursor);
+
+        reference -= delta * 1000;
+        batch.sessions.push({
+            spot: spot,
+            start: new Date(reference).toISOString(),
+            end: new Date(reference + duration * 1000).toISOString(),
+            duration: duration,
+            formattedDuration: formatDuration(duration)
+        });
+    }
+    return batch;
+}
+
+function decodeMultiSpot(bytes) {
+    var decoded = {};
+    var spotCount = bytes[0];
+    var bitmap = bytes[1];
+    var index = 2;
+
+    decoded.spotCount = spotCount;
+    decoded.occupiedCount = 0;
+    decoded.spots = [];
+
+    for (var i = 0; i < spotCount; i++) {
+        var occupied = (bitmap >> i) & 1;
+        var occupancyTime = 0;
+        if (occupied) {
+            occupancyTime = ((bytes[index] << 8) | bytes[index + 1]) * 60;
+            index += 2;
+            decoded.occupiedCount++;
+        }
+        decoded.spots.push({
+            spot: i,
+            parkingState: occupied,
+            parkingStatus: occupied ? "OCCUPIED" : "FREE",
+            occupancyTime: occupancyTime,
+            formattedOccupancyTime: formatDuration(occupancyTime)
+        });
+    }
+
+    // First spot mirrored at top level for single-spot dashboards
+    if (spotCount > 0) {
+        decoded.parkingState = decoded.spots[0].parkingState;
+        decoded.parkingStatus = decoded.spots[0].parkingStatus;
+        decoded.occupancyTime = decoded.spots[0].occupancyTime;
+        decoded.formattedOccupancyTime = decoded.spots[0].formattedOccupancyTime;
+    }
+
+    var now = new Date();
+    if (index < bytes.length) {
+        var batch = decodeSessions(bytes, index, now.getTime());
+        decoded.sessions = batch.sessions;
+        decoded.droppedSessions = batch.droppedSessions;
+    }
+
+    decoded.timestamp = now.toISOString();
+    return decoded;
+}
+
+// Loop profile (fPort 9, firmware built with -DLOOP_PROFILER): loops per
+// sample, profiler overhead (0.01 %), then 6 bytes per stage: id, count,
+// p50 and p95 log2 buckets as two nibbles, max (16 us units)
+var PROFILE_STAGES = ["loop", "parking", "echo", "modem", "console", "uplink"];
+
+function profileBucketLimit(bucket) {
+    // Exclusive upper bound in us; the last bucket is open-ended
+    return bucket < 15 ? Math.pow(2, bucket + 4) : null;
+}
+
+function decodeProfile(bytes) {
+    var profile = {
+        sampleRate: bytes[0],
+        overheadPercent: ((bytes[1] << 8) | bytes[2]) / 100,
+        stages: {}
+    };
+    for (var i = 3; i + 6 <= bytes.length; i += 6) {
+        var name = PROFILE_STAGES[bytes[i]] || "stage" + bytes[i];
+        profile.stages[name] = {
+            count: (bytes[i + 1] << 8) | bytes[i + 2],
+            p50BelowMicros: profileBucketLimit(bytes[i + 3] >> 4),
+            p95BelowMicros: profileBucketLimit(bytes[i + 3] & 0x0f),
+            maxMicros: ((bytes[i + 4] << 8) | bytes[i + 5]) * 16
+        };
+    }
+    return profile;
+}
+
+// Memory report (fPort 10): heap max, stack max, minimum and current free
+// RAM (2 bytes each, in bytes), flags (bit 0: stack and heap have met)
+function decodeMemory(bytes) {
+    return {
+        heapMaxBytes: (bytes[0] << 8) | bytes[1],
+        stackMaxBytes: (bytes[2] << 8) | bytes[3],
+        freeMinBytes: (bytes[4] << 8) | bytes[5],
+        freeNowBytes: (bytes[6] << 8) | bytes[7],
+        collision: Boolean(bytes[8] & 0x01)
+    };
+}
+
 // Modern format for TTN V3, ChirpStack V4, and other platforms
 function decodeUplink(input) {
     var bytes = input.bytes;
     var port = input.fPort;
     var decoded = {};
+
+    if (port === 10) {
+        if (bytes.length < 9) {
+            return {
+                data: {},
+                warnings: ["Payload too short"],
+                errors: ["Expected 9 bytes"]
+            };
+        }
+        return {
+            data: decodeMemory(bytes),
+            warnings: [],
+            errors: []
+        };
+    }
+
+    if (port === 9) {
+        if (bytes.length < 3) {
+            return {
+                data: {},
+                warnings: ["Payload too short"],
+                errors: ["Expected at least 3 bytes"]
+            };
+        }
+        return {
+            data: decodeProfile(bytes),
+            warnings: [],
+            errors: []
+        };
+    }
+
+    if (port === 3) {
+        if (bytes.length < 2) {
+            return {
+                data: {},
+                warnings: ["Payload too short"],
+                errors: ["Expected at least 2 bytes"]
+            };
+        }
+        return {
+            data: decodeMultiSpot(bytes),
+            warnings: [],
+            errors: []
+        };
+    }
     
     // Check if we have at least 3 bytes (2 for occupancy time, 1 for parking state)
     if (bytes.length < 3) {
@@ -62,6 +261,16 @@ function decodeUplink(input) {
 // Keep the old format for backward compatibility
 function Decoder(bytes, port) {
     var decoded = {};
+
+    if (port === 10) {
+        return bytes.length < 9 ? decoded : decodeMemory(bytes);
+    }
+    if (port === 9) {
+        return bytes.length < 3 ? decoded : decodeProfile(bytes);
+    }
+    if (port === 3) {
+        return bytes.length < 2 ? decoded : decodeMultiSpot(bytes);
+    }
     
     // Check if we have at least 3 bytes (2 for occupancy time, 1 for parking state)
     if (bytes.length < 3) {
@@ -0,0 +1,55 @@
+#include "AdaptivePoller.h"
+
+AdaptivePoller::AdaptivePoller() {
+  fastInterval = POLL_FAST_INTERVAL;
+  slowInterval = POLL_SLOW_INTERVAL;
+  quietTime = POLL_QUIET_TIME;
+  start(0);
+}
+
+void AdaptivePoller::configure(unsigned long fastInterval,
+                               unsigned long slowInterval,
+                               unsigned long quietTime) {
+  this->fastInterval = fastInterval;
+  this->slowInterval = slowInterval;
+  this->quietTime = quietTime;
+}
+
+void AdaptivePoller::start(unsigned long now) {
+  startTime = now;
+  lastPoll = now - slowInterval;
+  lastActivity = now;
+  pollCount = 0;
+  fast = true;
+}
+
+bool AdaptivePoller::isDue(unsigned long now) {
+  return now - lastPoll >= getInterval();
+}
+
+unsigned long AdaptivePoller::getTimeUntilDue(unsigned long now) {
+  unsigned long elapsed = now - lastPoll;
+  return elapsed >= getInterval() ? 0 : getInterval() - elapsed;
+}
+
+void AdaptivePoller::polled(bool activity, unsigned long now) {
+  lastPoll = now;
+  pollCount++;
+
+  if (activity) {
+    lastActivity = now;
+    fast = true;
+  } else if (fast && now - lastActivity >= quietTime) {
+    fast = false;
+  }
+}
+
+float AdaptivePoller::getDutyRatio(unsigned long now) {
+  unsigned long elapsed = now - startTime;
+  if (elapsed < fastInterval) {
+    return 1.0;
+  }
+
+  float ratio = (float)pollCount * fastInterval / elapsed;
+  return ratio > 1.0 ? 1.0 : ratio;
+}
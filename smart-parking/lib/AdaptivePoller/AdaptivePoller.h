@@ -0,0 +1,46 @@
+#ifndef ADAPTIVE_POLLER_H
+#define ADAPTIVE_POLLER_H
+
+#include <Arduino.h>
+
+#define POLL_FAST_INTERVAL 100  // ms between pings while the reading moves
+#define POLL_SLOW_INTERVAL 2000 // ms between pings while the spot is steady
+#define POLL_QUIET_TIME 10000   // ms without activity before slowing down
+
+// Sampling policy for one sensor: polls slowly while nothing changes,
+// switches to the fast rate on the first deviating reading and returns to
+// the slow rate after a quiet period. A change is therefore noticed within
+// one slow interval, then confirmed at the fast rate.
+class AdaptivePoller {
+private:
+  unsigned long fastInterval;
+  unsigned long slowInterval;
+  unsigned long quietTime;
+
+  unsigned long startTime;
+  unsigned long lastPoll;
+  unsigned long lastActivity;
+  unsigned long pollCount;
+  bool fast;
+
+public:
+  AdaptivePoller();
+  void configure(unsigned long fastInterval, unsigned long slowInterval,
+                 unsigned long quietTime);
+  void start(unsigned long now);
+
+  bool isDue(unsigned long now);
+  // ms left before isDue(), 0 if already due
+  unsigned long getTimeUntilDue(unsigned long now);
+  // Records a ping; activity means the reading deviated or is unsettled
+  void polled(bool activity, unsigned long now);
+
+  bool isFast() { return fast; }
+  unsigned long getInterval() { return fast ? fastInterval : slowInterval; }
+  unsigned long getPollCount() { return pollCount; }
+
+  // Pings taken over pings polling always at the fast rate would have taken
+  float getDutyRatio(unsigned long now);
+};
+
+#endif // ADAPTIVE_POLLER_H
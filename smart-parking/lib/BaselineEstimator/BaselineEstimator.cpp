@@ -0,0 +1,68 @@
+#include "BaselineEstimator.h"
+
+BaselineEstimator::BaselineEstimator() { reset(); }
+
+void BaselineEstimator::reset() {
+  head = 0;
+  count = 0;
+}
+
+void BaselineEstimator::add(float sample) {
+  uint8_t size = count;
+
+  if (count == BASELINE_WINDOW) {
+    // Drop the oldest sample from the sorted copy
+    float oldest = samples[head];
+    uint8_t i = 0;
+    while (i < size - 1 && sorted[i] != oldest) {
+      i++;
+    }
+    for (; i < size - 1; i++) {
+      sorted[i] = sorted[i + 1];
+    }
+    size--;
+  } else {
+    count++;
+  }
+
+  uint8_t i = size;
+  while (i > 0 && sorted[i - 1] > sample) {
+    sorted[i] = sorted[i - 1];
+    i--;
+  }
+  sorted[i] = sample;
+
+  samples[head] = sample;
+  head = (head + 1) % BASELINE_WINDOW;
+}
+
+float BaselineEstimator::median() {
+  if (count == 0) {
+    return 0;
+  }
+  if (count % 2) {
+    return sorted[count / 2];
+  }
+  return (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+float BaselineEstimator::trimmedMean() {
+  uint8_t start = count / 5;
+  uint8_t end = count * 4 / 5;
+  if (end <= start) {
+    return median();
+  }
+
+  float sum = 0;
+  for (uint8_t i = start; i < end; i++) {
+    sum += sorted[i];
+  }
+  return sum / (end - start);
+}
+
+float BaselineEstimator::spread() {
+  if (count < 2) {
+    return 0;
+  }
+  return sorted[count * 4 / 5 - 1] - sorted[count / 5];
+}
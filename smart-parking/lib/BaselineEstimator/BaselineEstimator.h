@@ -0,0 +1,31 @@
+#ifndef BASELINE_ESTIMATOR_H
+#define BASELINE_ESTIMATOR_H
+
+#include <Arduino.h>
+
+#define BASELINE_WINDOW 15
+
+// Sliding window kept both in arrival order and sorted. Each add() removes
+// the oldest sample from the sorted copy and inserts the new one, O(N) with
+// no full re-sort, so the median and trimmed mean are always at hand.
+class BaselineEstimator {
+private:
+  float samples[BASELINE_WINDOW]; // arrival order, oldest at `head` when full
+  float sorted[BASELINE_WINDOW];
+  uint8_t head;
+  uint8_t count;
+
+public:
+  BaselineEstimator();
+  void reset();
+  void add(float sample);
+
+  bool isFull() { return count == BASELINE_WINDOW; }
+  uint8_t getCount() { return count; }
+
+  float median();
+  float trimmedMean(); // mean of the middle 60 %
+  float spread();      // distance between the 20th and 80th percentiles
+};
+
+#endif // BASELINE_ESTIMATOR_H
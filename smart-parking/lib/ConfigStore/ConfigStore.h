@@ -0,0 +1,68 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+#define CONFIG_ADDRESS 0    // EEPROM offset of the block
+#define CONFIG_MAGIC 0x4346 // "FC" in EEPROM order
+#define CONFIG_NAME_SIZE 16
+
+enum ConfigType : uint8_t {
+  CONFIG_UINT8,
+  CONFIG_UINT16,
+  CONFIG_UINT32,
+  CONFIG_FLOAT
+};
+
+// One setting of a node's settings struct, as named on the console. Tables
+// of fields live in flash.
+struct ConfigField {
+  char name[CONFIG_NAME_SIZE];
+  uint8_t offset; // offsetof() the member
+  ConfigType type;
+  float minimum;
+  float maximum;
+};
+
+// Site settings kept in EEPROM as one block: a header with the layout
+// version and size, the node's settings struct, then a CRC-16 of both.
+// begin() loads the block into that struct once; the firmware then reads
+// plain members, as cheap as the constants they replace. A blank, torn or
+// outdated block is replaced by the compile-time defaults, so the version
+// must change whenever the struct does. Writes go through EEPROM.update():
+// only the cells whose byte changed are worn.
+class ConfigStore {
+private:
+  uint8_t *data;
+  uint8_t size;
+  const void *defaults;      // in flash
+  const ConfigField *fields; // in flash
+  uint8_t fieldCount;
+  uint8_t version;
+
+  bool findField(const char *name, ConfigField &field);
+  void printValue(Print &out, const ConfigField &field);
+
+public:
+  ConfigStore(void *data, uint8_t size, const void *defaults,
+              const ConfigField *fields, uint8_t fieldCount, uint8_t version);
+  // Returns false if the stored block was unusable and the defaults were
+  // written instead
+  bool begin();
+  void save();
+  void restoreDefaults();
+  // Parses value, checks its range, then saves
+  bool set(const char *name, const char *value);
+  void dump(Print &out);
+
+  // "config" lists the settings, "config reset" restores the defaults and
+  // "set <name> <value>" changes one; returns true if the line was one of
+  // these, so the caller can apply the settings again
+  bool handleCommand(const char *line);
+
+  // CRC-16/CCITT-FALSE, one byte at a time from 0xFFFF
+  static uint16_t crc16(uint16_t crc, uint8_t data);
+};
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,69 @@
+#include "EchoCapture.h"
+
+volatile uint8_t EchoCapture::status = ECHO_IDLE;
+volatile bool EchoCapture::riseSeen = false;
+volatile unsigned long EchoCapture::riseTime = 0;
+volatile unsigned long EchoCapture::echoWidth = 0;
+byte EchoCapture::echoPin = 0;
+
+EchoCapture::EchoCapture() { triggerTime = 0; }
+
+void EchoCapture::begin(byte echoPin) {
+  EchoCapture::echoPin = echoPin;
+  pinMode(echoPin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(echoPin), onEchoChange, CHANGE);
+}
+
+void EchoCapture::onEchoChange() {
+  if (status != ECHO_WAITING) {
+    return;
+  }
+
+  if (digitalRead(echoPin) == HIGH) {
+    riseTime = micros();
+    riseSeen = true;
+  } else if (riseSeen) {
+    echoWidth = micros() - riseTime;
+    status = ECHO_READY;
+  }
+}
+
+void EchoCapture::trigger(byte triggerPin) {
+  noInterrupts();
+  riseSeen = false;
+  status = ECHO_WAITING;
+  interrupts();
+
+  digitalWrite(triggerPin, LOW);
+  delayMicroseconds(2);
+  digitalWrite(triggerPin, HIGH);
+  delayMicroseconds(ECHO_TRIGGER_US);
+  digitalWrite(triggerPin, LOW);
+  triggerTime = micros();
+}
+
+EchoStatus EchoCapture::poll() {
+  uint8_t current = status;
+
+  if (current == ECHO_WAITING) {
+    if (micros() - triggerTime < ECHO_TIMEOUT_US) {
+      return ECHO_WAITING;
+    }
+    noInterrupts();
+    current = status; // the echo may have ended meanwhile
+    status = ECHO_IDLE;
+    interrupts();
+    return current == ECHO_READY ? ECHO_READY : ECHO_TIMEOUT;
+  }
+
+  // A result is reported once, then the capture is idle again
+  status = ECHO_IDLE;
+  return (EchoStatus)current;
+}
+
+float EchoCapture::widthToDistanceCm(unsigned long widthUs,
+                                     float temperature) {
+  // Speed of sound in cm/us; the pulse covers the distance twice
+  float speed = (331.3 + 0.606 * temperature) / 10000.0;
+  return widthUs * speed / 2;
+}
@@ -0,0 +1,40 @@
+#ifndef ECHO_CAPTURE_H
+#define ECHO_CAPTURE_H
+
+#include <Arduino.h>
+
+#define ECHO_TIMEOUT_US 30000UL // no echo within ~5 m: give up
+#define ECHO_TRIGGER_US 10
+
+enum EchoStatus : uint8_t { ECHO_IDLE, ECHO_WAITING, ECHO_READY, ECHO_TIMEOUT };
+
+// Non-blocking HC-SR04 ranging. trigger() emits the pulse and returns; the
+// echo width is timed by an external-interrupt ISR on CHANGE, so the echo
+// line must be on an INT0/INT1 pin (2 or 3 on the Uno), SoftwareSerial
+// owning the pin-change vectors. Only one measurement may be in flight.
+class EchoCapture {
+private:
+  static volatile uint8_t status;
+  // Set on the rising edge; riseTime alone can't tell, micros() being 0 at
+  // boot and on wrap
+  static volatile bool riseSeen;
+  static volatile unsigned long riseTime;
+  static volatile unsigned long echoWidth;
+  static byte echoPin;
+
+  unsigned long triggerTime;
+
+  static void onEchoChange();
+
+public:
+  EchoCapture();
+  void begin(byte echoPin);
+  void trigger(byte triggerPin);
+  EchoStatus poll();
+  unsigned long getEchoWidth() { return echoWidth; }
+
+  static float widthToDistanceCm(unsigned long widthUs,
+                                 float temperature = 20.0);
+};
+
+#endif // ECHO_CAPTURE_H
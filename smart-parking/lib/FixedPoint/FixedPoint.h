@@ -0,0 +1,112 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <Arduino.h>
+
+// Signed Q(31-FRAC).FRAC number in 32 bits, for the filter and threshold
+// paths on the FPU-less AVR. Every operation saturates at the range limits
+// instead of wrapping; a division by zero saturates towards the dividend.
+template <uint8_t FRAC> class Fixed {
+private:
+  int32_t raw;
+
+  constexpr Fixed(int32_t raw, bool) : raw(raw) {}
+
+  static int32_t saturate(int64_t value) {
+    return value > INT32_MAX   ? INT32_MAX
+           : value < INT32_MIN ? INT32_MIN
+                               : (int32_t)value;
+  }
+
+public:
+  static const int32_t ONE = (int32_t)1 << FRAC;
+
+  constexpr Fixed() : raw(0) {}
+
+  static constexpr Fixed fromRaw(int32_t raw) { return Fixed(raw, true); }
+  static constexpr Fixed fromInt(int32_t value) {
+    return fromRaw(value > (INT32_MAX >> FRAC)   ? INT32_MAX
+                   : value < (INT32_MIN >> FRAC) ? INT32_MIN
+                                                 : value * ONE);
+  }
+  // Rounded to nearest; keep it for constants, where it folds at compile time
+  static constexpr Fixed fromFloat(float value) {
+    return fromRaw(value >= (float)INT32_MAX / ONE   ? INT32_MAX
+                   : value <= (float)INT32_MIN / ONE ? INT32_MIN
+                   : (int32_t)(value * ONE + (value < 0 ? -0.5f : 0.5f)));
+  }
+  // num / den without going through float, e.g. a driver's hundredths.
+  // den must be positive and below 2^(31 - FRAC).
+  static Fixed ratio(int32_t num, int32_t den) {
+    return fromInt(num / den) + fromRaw((num % den) * ONE / den);
+  }
+
+  int32_t getRaw() const { return raw; }
+  float toFloat() const { return raw * (1.0f / ONE); }
+  int32_t toInt() const { return (raw + ONE / 2) >> FRAC; }
+
+  Fixed operator+(Fixed other) const {
+    int32_t sum = (int32_t)((uint32_t)raw + (uint32_t)other.raw);
+    // Both operands share a sign the sum lost
+    if (((raw ^ sum) & (other.raw ^ sum)) < 0) {
+      sum = raw < 0 ? INT32_MIN : INT32_MAX;
+    }
+    return fromRaw(sum);
+  }
+
+  Fixed operator-(Fixed other) const {
+    int32_t difference = (int32_t)((uint32_t)raw - (uint32_t)other.raw);
+    if (((raw ^ other.raw) & (raw ^ difference)) < 0) {
+      difference = raw < 0 ? INT32_MIN : INT32_MAX;
+    }
+    return fromRaw(difference);
+  }
+
+  Fixed operator-() const {
+    return fromRaw(raw == INT32_MIN ? INT32_MAX : -raw);
+  }
+
+  Fixed operator*(Fixed other) const {
+    // Two 16-bit operands, e.g. a gain times a small difference, need no
+    // 64-bit product
+    if (raw == (int16_t)raw && other.raw == (int16_t)other.raw) {
+      return fromRaw(((int32_t)raw * other.raw) >> FRAC);
+    }
+    return fromRaw(saturate(((int64_t)raw * other.raw) >> FRAC));
+  }
+
+  Fixed operator/(Fixed other) const {
+    if (other.raw == 0) {
+      return fromRaw(raw < 0 ? INT32_MIN : raw > 0 ? INT32_MAX : 0);
+    }
+    // Below 2^(31 - FRAC) the dividend shifts within 32 bits
+    const int32_t limit = (int32_t)1 << (31 - FRAC);
+    if (raw > -limit && raw < limit) {
+      return fromRaw(raw * ONE / other.raw);
+    }
+    return fromRaw(saturate((int64_t)raw * ONE / other.raw));
+  }
+
+  // By a constant, e.g. the mean of a fixed count, this is a shift or a
+  // multiply
+  Fixed operator/(int32_t divisor) const { return fromRaw(raw / divisor); }
+
+  Fixed absolute() const { return raw < 0 ? -*this : *this; }
+
+  Fixed &operator+=(Fixed other) { return *this = *this + other; }
+  Fixed &operator-=(Fixed other) { return *this = *this - other; }
+
+  bool operator==(Fixed other) const { return raw == other.raw; }
+  bool operator!=(Fixed other) const { return raw != other.raw; }
+  bool operator<(Fixed other) const { return raw < other.raw; }
+  bool operator>(Fixed other) const { return raw > other.raw; }
+  bool operator<=(Fixed other) const { return raw <= other.raw; }
+  bool operator>=(Fixed other) const { return raw >= other.raw; }
+};
+
+// Measures up to +-32767 at 1/65536, e.g. hPa, m or degrees C
+typedef Fixed<16> Q16_16;
+// Up to +-8388607 at 1/256, e.g. cm
+typedef Fixed<8> Q24_8;
+
+#endif // FIXED_POINT_H
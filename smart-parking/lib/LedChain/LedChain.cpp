@@ -0,0 +1,64 @@
+#include "LedChain.h"
+
+LedChain::LedChain(byte clockPin, byte dataPin, byte ledCount) {
+  this->clockPin = clockPin;
+  this->dataPin = dataPin;
+  this->ledCount = ledCount > LED_CHAIN_MAX ? LED_CHAIN_MAX : ledCount;
+  memset(colors, 0, sizeof(colors));
+}
+
+void LedChain::init() {
+  pinMode(clockPin, OUTPUT);
+  pinMode(dataPin, OUTPUT);
+  for (uint8_t i = 0; i < ledCount; i++) {
+    setColorRGB(i, 0, 0, 0);
+  }
+}
+
+void LedChain::clock() {
+  digitalWrite(clockPin, LOW);
+  delayMicroseconds(LED_CHAIN_CLOCK_PULSE);
+  digitalWrite(clockPin, HIGH);
+  delayMicroseconds(LED_CHAIN_CLOCK_PULSE);
+}
+
+void LedChain::sendByte(uint8_t value) {
+  for (uint8_t i = 0; i < 8; i++) {
+    digitalWrite(dataPin, (value & 0x80) ? HIGH : LOW);
+    clock();
+    value <<= 1;
+  }
+}
+
+void LedChain::sendColor(uint8_t red, uint8_t green, uint8_t blue) {
+  // Flag bits, then the inverted top two bits of blue, green and red
+  uint8_t prefix = 0xC0;
+  prefix |= (~blue >> 2) & 0x30;
+  prefix |= (~green >> 4) & 0x0C;
+  prefix |= (~red >> 6) & 0x03;
+
+  sendByte(prefix);
+  sendByte(blue);
+  sendByte(green);
+  sendByte(red);
+}
+
+void LedChain::setColorRGB(byte led, byte red, byte green, byte blue) {
+  if (led >= ledCount) {
+    return;
+  }
+  colors[led][0] = red;
+  colors[led][1] = green;
+  colors[led][2] = blue;
+
+  // The whole chain is shifted out, framed by 32 zero bits
+  for (uint8_t i = 0; i < 4; i++) {
+    sendByte(0x00);
+  }
+  for (uint8_t i = 0; i < ledCount; i++) {
+    sendColor(colors[i][0], colors[i][1], colors[i][2]);
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    sendByte(0x00);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef LED_CHAIN_H
+#define LED_CHAIN_H
+
+#include <Arduino.h>
+
+#define LED_CHAIN_MAX 8          // one LED per parking spot
+#define LED_CHAIN_CLOCK_PULSE 20 // us, as the Grove driver
+
+// P9813 chain (Grove Chainable RGB LED) with the colors held in the object,
+// for the heap-free build: the Grove driver allocates its color table with
+// calloc(). Same constructor and setColorRGB() as ChainableLED.
+class LedChain {
+private:
+  byte clockPin;
+  byte dataPin;
+  uint8_t ledCount;
+  uint8_t colors[LED_CHAIN_MAX][3];
+
+  void clock();
+  void sendByte(uint8_t value);
+  void sendColor(uint8_t red, uint8_t green, uint8_t blue);
+
+public:
+  LedChain(byte clockPin, byte dataPin, byte ledCount);
+  // Sets the pins and turns every LED off
+  void init();
+  void setColorRGB(byte led, byte red, byte green, byte blue);
+};
+
+#endif // LED_CHAIN_H
@@ -1,32 +1,36 @@
 #include "LoRaManager.h"
+#include "LoopProfiler.h"
 
-LoRaManager::LoRaManager(int rxPin, int txPin) {
-  loraSerial = new SoftwareSerial(rxPin, txPin);
+LoRaManager::LoRaManager(int rxPin, int txPin) : loraSerial(rxPin, txPin) {
   previousTTN = millis();
   uplinkInterval = 10000;
   receiveCallback = false;
   getDataStatus = false;
   networkJoinedStatus = false;
+  modemSleepEnabled = false;
+  modemAsleep = false;
+  lastModemActivity = 0;
 
-  inputString.reserve(200);
-  stringComplete = false;
+  consoleIndex = 0;
   rxbuff_index = 0;
+  commandHandler = nullptr;
 }
 
 void LoRaManager::begin() {
-  loraSerial->begin(9600);
-  loraSerial->println("ATZ");
+  loraSerial.begin(9600);
+  loraSerial.println(F("ATZ"));
 }
 
 void LoRaManager::handleLoRaMessages() {
-  loraSerial->listen();
+  PROFILE_SCOPE(PROFILE_STAGE_MODEM);
+  loraSerial.listen();
   unsigned long currentTime = millis();
   if ((currentTime - previousTTN >= uplinkInterval) &&
       (networkJoinedStatus == true)) {
     previousTTN = currentTime;
     getDataStatus = false;
-    Serial.println("\n===== PARKING SENSOR STATUS");
-    Serial.println("LoRa network is joined and ready to send data");
+    Serial.println(F("\n===== PARKING SENSOR STATUS"));
+    Serial.println(F("LoRa network is joined and ready to send data"));
   }
 
   if (receiveCallback == true) {
@@ -34,103 +38,130 @@ void LoRaManager::handleLoRaMessages() {
     getDataStatus = true;
     delay(1000);
 
-    loraSerial->println("AT+CFG");
+    wakeModem();
+    loraSerial.println(F("AT+CFG"));
   }
 
   processLoRaData();
+
+  // Not needed again before the next uplink
+  if (modemSleepEnabled && !modemAsleep && networkJoinedStatus &&
+      !receiveCallback && millis() - lastModemActivity >= LA66_SLEEP_DELAY) {
+    loraSerial.println(F(LA66_SLEEP_COMMAND));
+    modemAsleep = true;
+  }
+}
+
+void LoRaManager::wakeModem() {
+  if (modemAsleep) {
+    loraSerial.println();
+    delay(LA66_WAKE_TIME);
+    modemAsleep = false;
+  }
+  lastModemActivity = millis();
 }
 
 void LoRaManager::processLoRaData() {
-  while (loraSerial->available()) {
-    char inChar = (char)loraSerial->read();
-    inputString += inChar;
+  while (loraSerial.available()) {
+    char inChar = (char)loraSerial.read();
+    lastModemActivity = millis();
 
+    // A line longer than the buffer is dropped
+    if (rxbuff_index >= sizeof(rxbuff) - 1) {
+      rxbuff_index = 0;
+    }
     rxbuff[rxbuff_index++] = inChar;
 
-    if (rxbuff_index > 128)
-      break;
-
     if (inChar == '\n' || inChar == '\r') {
-      stringComplete = true;
       rxbuff[rxbuff_index] = '\0';
+      rxbuff_index = 0;
+      // Modem lines are echoed, except the downlink exchange
+      bool echo = !getDataStatus;
 
       if (strncmp(rxbuff, "JOINED", 6) == 0) {
         networkJoinedStatus = true;
-        Serial.println("Network joined!");
+        Serial.println(F("Network joined!"));
       }
 
       if (strncmp(rxbuff, "Dragino LA66 Device", 19) == 0) {
         networkJoinedStatus = false;
-        Serial.println("Network connection reset");
+        modemAsleep = false;
+        Serial.println(F("Network connection reset"));
       }
 
       if (strncmp(rxbuff, "Run AT+RECVB=? to see detail", 28) == 0) {
         receiveCallback = true;
-        stringComplete = false;
-        inputString = "\0";
+        echo = false;
       }
 
       if (strncmp(rxbuff, "AT+RECVB=", 9) == 0) {
-        stringComplete = false;
-        inputString = "\0";
-        Serial.print("\r\nGet downlink data(FPort & Payload) ");
+        echo = false;
+        Serial.print(F("\r\nGet downlink data(FPort & Payload) "));
         Serial.println(&rxbuff[9]);
       }
 
-      rxbuff_index = 0;
-
-      if (getDataStatus == true) {
-        stringComplete = false;
-        inputString = "\0";
+      if (echo) {
+        Serial.print(rxbuff);
       }
     }
   }
-
-  if (stringComplete) {
-    Serial.print(inputString);
-
-    inputString = "\0";
-    stringComplete = false;
-  }
 }
 
-void LoRaManager::sendSensorData(unsigned long occupancyTime,
-                                 uint8_t parkingState) {
+bool LoRaManager::sendPayload(uint8_t port, const uint8_t *payload,
+                              uint8_t length) {
   if (!networkJoinedStatus) {
-    Serial.println("Network not joined, cannot send data");
-    return;
+    Serial.println(F("Network not joined, cannot send data"));
+    return false;
   }
 
-  Serial.println("\n===== PARKING SENSOR PARAMETERS");
-
-  Serial.println("Occupancy Time: " + String(occupancyTime) + " seconds");
-  Serial.println("Parking State: " +
-                 String(parkingState == 0 ? "FREE" : "OCCUPIED"));
-
-  char sensor_data_buff[128] = "\0";
+  Serial.println(F("===== SEND DATA TO TTN"));
 
-  Serial.println("===== SEND DATA TO TTN");
-
-  // Convert occupancy time to 2 bytes (uint16_t)
-  uint16_t occupancyTimeInt = (uint16_t)(occupancyTime & 0xFFFF);
+  Serial.print(F("Raw payload: "));
+  for (int i = 0; i < length; i++) {
+    Serial.print(payload[i], HEX);
+    Serial.print(' ');
+  }
+  Serial.println();
 
-  snprintf(sensor_data_buff, sizeof(sensor_data_buff),
-           "AT+SENDB=%d,%d,%d,%02X%02X%02X", 1, 2, 3,
-           (occupancyTimeInt >> 8) & 0xFF, occupancyTimeInt & 0xFF,
-           parkingState & 0xFF);
+  wakeModem();
+  printSendCommand(loraSerial, port, payload, length);
+  return true;
+}
 
-  loraSerial->println(sensor_data_buff);
+void LoRaManager::printSendCommand(Print &out, uint8_t port,
+                                   const uint8_t *payload, uint8_t length) {
+  // Streamed rather than formatted into a buffer first
+  out.print(F("AT+SENDB=1,"));
+  out.print(port);
+  out.print(',');
+  out.print(length);
+  out.print(',');
+  for (uint8_t i = 0; i < length; i++) {
+    out.print(payload[i] >> 4, HEX);
+    out.print(payload[i] & 0x0F, HEX);
+  }
+  out.println();
 }
 
 bool LoRaManager::isNetworkJoined() { return networkJoinedStatus; }
 
 void LoRaManager::processSerialCommands() {
+  PROFILE_SCOPE(PROFILE_STAGE_CONSOLE);
   while (Serial.available()) {
     char inChar = (char)Serial.read();
-    inputString += inChar;
-    if (inChar == '\n' || inChar == '\r') {
-      loraSerial->print(inputString);
-      inputString = "\0";
+    bool endOfLine = inChar == '\n' || inChar == '\r';
+
+    // Long lines are cut, keeping room for the line end
+    if (consoleIndex < sizeof(consoleLine) - 2 || endOfLine) {
+      consoleLine[consoleIndex++] = inChar;
+    }
+    if (endOfLine) {
+      consoleLine[consoleIndex] = '\0';
+      consoleIndex = 0;
+      if (!commandHandler || !commandHandler(consoleLine)) {
+        wakeModem();
+        loraSerial.print(consoleLine);
+      }
     }
   }
-}
\ No newline at end of file
+}
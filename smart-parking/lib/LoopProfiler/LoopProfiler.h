@@ -0,0 +1,240 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+// Per-stage timing of loop(), built with -DLOOP_PROFILER. Each scope records
+// the micros() spent until the end of its block into a log2 histogram of its
+// stage; without the flag the macros expand to nothing. PROFILE_SCOPE is for
+// stages run on every pass and only times the sampled loops, PROFILE_EVENT
+// for occasional ones (an uplink, an echo) and always times them. Stages are
+// listed per node in ProfileStages.h.
+
+#include "ProfileStages.h"
+
+#ifdef LOOP_PROFILER
+
+#include <Arduino.h>
+
+#define PROFILE_BUCKETS 16   // bucket 0 is < 16 us, bucket 15 is >= 262 ms
+#define PROFILE_MIN_SHIFT 4  // log2 of the upper bound of bucket 0
+#define PROFILE_CALIBRATION_RUNS 32
+// Sample rate, overhead, then 6 bytes per stage
+#define PROFILE_REPORT_MAX (3 + 6 * PROFILE_STAGE_COUNT)
+
+struct ProfileStage {
+  uint16_t buckets[PROFILE_BUCKETS]; // saturating counts
+  uint32_t total;                    // us
+  uint32_t max;                      // us
+};
+
+class LoopProfiler {
+private:
+  ProfileStage stages[PROFILE_STAGE_COUNT];
+  uint8_t sampleRate;
+  uint8_t countdown;
+  bool sampling;
+  uint8_t scopeCost; // us spent by the profiler per recorded scope
+  uint32_t scopeCount;
+  unsigned long windowStart;
+
+  static uint8_t bucketOf(unsigned long duration) {
+    uint8_t bucket = 0;
+    duration >>= PROFILE_MIN_SHIFT;
+    while (duration && bucket < PROFILE_BUCKETS - 1) {
+      duration >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+
+  uint32_t getCount(uint8_t stage) {
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) {
+      count += stages[stage].buckets[i];
+    }
+    return count;
+  }
+
+  // First bucket at which `percent` of the samples are reached
+  uint8_t percentileBucket(uint8_t stage, uint8_t percent) {
+    uint32_t target = (getCount(stage) * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) {
+      seen += stages[stage].buckets[i];
+      if (seen >= target) {
+        return i;
+      }
+    }
+    return PROFILE_BUCKETS - 1;
+  }
+
+public:
+  LoopProfiler() : sampleRate(1), countdown(0), sampling(true), scopeCost(0) {
+    reset();
+  }
+
+  // Times one loop in sampleRate; a tight loop needs more than 1 to keep
+  // the profiler under 1% of its time
+  void begin(uint8_t sampleRate) {
+    this->sampleRate = sampleRate ? sampleRate : 1;
+
+    // Cost of an empty scope, micros() included
+    unsigned long start = micros();
+    for (uint8_t i = 0; i < PROFILE_CALIBRATION_RUNS; i++) {
+      unsigned long scopeStart = micros();
+      record(PROFILE_STAGE_LOOP, micros() - scopeStart);
+    }
+    scopeCost = (micros() - start + PROFILE_CALIBRATION_RUNS - 1) /
+                PROFILE_CALIBRATION_RUNS;
+    reset();
+  }
+
+  void reset() {
+    memset(stages, 0, sizeof(stages));
+    scopeCount = 0;
+    windowStart = micros();
+  }
+
+  void startLoop() {
+    if (countdown == 0) {
+      countdown = sampleRate;
+    }
+    sampling = --countdown == 0;
+  }
+
+  bool isSampling() { return sampling; }
+
+  void record(uint8_t stage, unsigned long duration) {
+    ProfileStage &entry = stages[stage];
+    uint16_t &bucket = entry.buckets[bucketOf(duration)];
+    if (bucket < 0xFFFF) {
+      bucket++;
+    }
+    entry.total += duration;
+    if (duration > entry.max) {
+      entry.max = duration;
+    }
+    scopeCount++;
+  }
+
+  // Share of the time since reset() spent in the profiler, in 0.01 %
+  uint16_t getOverhead() {
+    unsigned long elapsed = micros() - windowStart;
+    if (elapsed == 0) {
+      return 0;
+    }
+    uint32_t overhead = (uint64_t)scopeCount * scopeCost * 10000 / elapsed;
+    return overhead > 0xFFFF ? 0xFFFF : overhead;
+  }
+
+  // Exclusive upper bound of a bucket in us, 0 for the open-ended last one
+  static unsigned long bucketLimit(uint8_t bucket) {
+    return bucket < PROFILE_BUCKETS - 1 ? 1UL << (bucket + PROFILE_MIN_SHIFT)
+                                        : 0;
+  }
+
+  void dump(Print &out) {
+    out.print(F("Loop profile, 1 loop in "));
+    out.print(sampleRate);
+    out.print(F(", overhead "));
+    out.print(getOverhead() / 100.0);
+    out.println(F("%"));
+    out.println(F("stage count mean_us p50<us p95<us max_us | log2 buckets"));
+
+    for (uint8_t stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+      uint32_t count = getCount(stage);
+      if (count == 0) {
+        continue;
+      }
+      out.print(profileStageName(stage));
+      out.print(' ');
+      out.print(count);
+      out.print(' ');
+      out.print(stages[stage].total / count);
+      out.print(' ');
+      out.print(bucketLimit(percentileBucket(stage, 50)));
+      out.print(' ');
+      out.print(bucketLimit(percentileBucket(stage, 95)));
+      out.print(' ');
+      out.print(stages[stage].max);
+      out.print(F(" |"));
+      for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) {
+        out.print(' ');
+        out.print(stages[stage].buckets[i]);
+      }
+      out.println();
+    }
+  }
+
+  // Stages with samples: id, count, p50 and p95 buckets as two nibbles,
+  // max in 16 us units; counts and max saturate at 0xFFFF.
+  uint8_t buildReport(uint8_t *payload, uint8_t maxLength) {
+    uint8_t length = 0;
+    uint16_t overhead = getOverhead();
+    payload[length++] = sampleRate;
+    payload[length++] = overhead >> 8;
+    payload[length++] = overhead & 0xFF;
+
+    for (uint8_t stage = 0;
+         stage < PROFILE_STAGE_COUNT && length + 6 <= maxLength; stage++) {
+      uint32_t count = getCount(stage);
+      if (count == 0) {
+        continue;
+      }
+      uint16_t saturated = count > 0xFFFF ? 0xFFFF : count;
+      uint32_t max = stages[stage].max >> PROFILE_MIN_SHIFT;
+      uint16_t maxUnits = max > 0xFFFF ? 0xFFFF : max;
+
+      payload[length++] = stage;
+      payload[length++] = saturated >> 8;
+      payload[length++] = saturated & 0xFF;
+      payload[length++] =
+          percentileBucket(stage, 50) << 4 | percentileBucket(stage, 95);
+      payload[length++] = maxUnits >> 8;
+      payload[length++] = maxUnits & 0xFF;
+    }
+    return length;
+  }
+};
+
+extern LoopProfiler loopProfiler;
+
+class ProfileScope {
+private:
+  uint8_t stage;
+  bool active;
+  unsigned long start;
+
+public:
+  ProfileScope(uint8_t stage, bool always) : stage(stage) {
+    active = always || loopProfiler.isSampling();
+    if (active) {
+      start = micros();
+    }
+  }
+  ~ProfileScope() {
+    if (active) {
+      loopProfiler.record(stage, micros() - start);
+    }
+  }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage)                                                   \
+  ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage, false)
+#define PROFILE_EVENT(stage)                                                   \
+  ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage, true)
+// First statement of the loop's timed block: picks the sampled loops
+#define PROFILE_LOOP()                                                         \
+  loopProfiler.startLoop();                                                    \
+  PROFILE_SCOPE(PROFILE_STAGE_LOOP)
+
+#else
+
+#define PROFILE_SCOPE(stage)
+#define PROFILE_EVENT(stage)
+#define PROFILE_LOOP()
+
+#endif // LOOP_PROFILER
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,36 @@
+#ifndef PROFILE_STAGES_H
+#define PROFILE_STAGES_H
+
+#include <Arduino.h>
+
+// Stage ids are sent in the diagnostic uplink; keep codec.js in step
+enum ProfileStageId : uint8_t {
+  PROFILE_STAGE_LOOP,    // one pass of loop()
+  PROFILE_STAGE_PARKING, // echo polling and spot scheduling
+  PROFILE_STAGE_ECHO,    // processing of a finished echo
+  PROFILE_STAGE_MODEM,   // LA66 line parsing
+  PROFILE_STAGE_CONSOLE, // serial console commands
+  PROFILE_STAGE_UPLINK,  // payload, console printing and AT+SENDB
+  PROFILE_STAGE_COUNT
+};
+
+static inline const __FlashStringHelper *profileStageName(uint8_t stage) {
+  switch (stage) {
+  case PROFILE_STAGE_LOOP:
+    return F("loop");
+  case PROFILE_STAGE_PARKING:
+    return F("parking");
+  case PROFILE_STAGE_ECHO:
+    return F("echo");
+  case PROFILE_STAGE_MODEM:
+    return F("modem");
+  case PROFILE_STAGE_CONSOLE:
+    return F("console");
+  case PROFILE_STAGE_UPLINK:
+    return F("uplink");
+  default:
+    return F("?");
+  }
+}
+
+#endif // PROFILE_STAGES_H
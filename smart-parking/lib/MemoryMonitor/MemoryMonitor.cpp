@@ -0,0 +1,105 @@
+#include "MemoryMonitor.h"
+
+#if defined(__AVR__)
+extern uint8_t _end;
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+extern char *__brkval;
+
+// Paints everything above the static data, before the C runtime sets the
+// stack pointer up, so it cannot rely on r1 being zero: hence assembly.
+void paintStack() __attribute__((naked, used, section(".init1")));
+void paintStack() {
+  __asm volatile("    ldi r30, lo8(_end)\n"
+                 "    ldi r31, hi8(_end)\n"
+                 "    ldi r24, %0\n"
+                 "    ldi r25, hi8(__stack)\n"
+                 "    rjmp 2f\n"
+                 "1:  st Z+, r24\n"
+                 "2:  cpi r30, lo8(__stack)\n"
+                 "    cpc r31, r25\n"
+                 "    brlo 1b\n"
+                 "    breq 1b\n" ::"M"(MEMORY_CANARY));
+}
+
+static uint8_t *heapTop() {
+  return __brkval ? (uint8_t *)__brkval : &__heap_start;
+}
+#endif
+
+MemoryMonitor::MemoryMonitor() {
+  heapMax = 0;
+  stackMax = 0;
+  freeMin = 0xFFFF;
+  lastSample = 0;
+}
+
+void MemoryMonitor::update(unsigned long now) {
+  if (now - lastSample >= MEMORY_SAMPLE_INTERVAL) {
+    lastSample = now;
+    sample();
+  }
+}
+
+void MemoryMonitor::sample() {
+#if defined(__AVR__)
+  uint16_t heap = heapTop() - &__heap_start;
+  if (heap > heapMax) {
+    heapMax = heap;
+  }
+
+  // Count the canaries left above the highest heap top; a freed block
+  // below it is not stack usage.
+  uint8_t *start = &__heap_start + heapMax;
+  uint8_t *stackPointer = (uint8_t *)SP;
+  uint8_t *p = start;
+  while (p < stackPointer && *p == MEMORY_CANARY) {
+    p++;
+  }
+
+  uint16_t untouched = p - start;
+  if (untouched < freeMin) {
+    freeMin = untouched;
+  }
+  uint16_t stack = &__stack - p + 1;
+  if (stack > stackMax) {
+    stackMax = stack;
+  }
+#endif
+}
+
+uint16_t MemoryMonitor::getFreeNow() {
+#if defined(__AVR__)
+  uint8_t marker;
+  return &marker - heapTop();
+#else
+  return 0;
+#endif
+}
+
+void MemoryMonitor::dump(Print &out) {
+  sample();
+  out.print(F("RAM free now "));
+  out.print(getFreeNow());
+  out.print(F(" B, min "));
+  out.print(getFreeMin());
+  out.print(F(" B; heap max "));
+  out.print(heapMax);
+  out.print(F(" B, stack max "));
+  out.print(stackMax);
+  out.println(F(" B"));
+  if (isCollided()) {
+    out.println(F("Stack and heap have met: RAM overflow"));
+  }
+}
+
+uint8_t MemoryMonitor::buildReport(uint8_t *payload) {
+  uint16_t values[] = {heapMax, stackMax, getFreeMin(), getFreeNow()};
+  uint8_t length = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    payload[length++] = values[i] >> 8;
+    payload[length++] = values[i] & 0xFF;
+  }
+  payload[length++] = isCollided() ? 1 : 0;
+  return length;
+}
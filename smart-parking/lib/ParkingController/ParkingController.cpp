@@ -0,0 +1,170 @@
+#include "ParkingController.h"
+#include "LoopProfiler.h"
+#include "SensorTrace.h"
+
+ParkingController::ParkingController(ParkingSensor *spots, uint8_t spotCount,
+                                     byte echoPin, byte ledDataPin,
+                                     byte ledClockPin)
+    : spotCount(spotCount > PARKING_MAX_SPOTS ? PARKING_MAX_SPOTS : spotCount),
+      leds(ledDataPin, ledClockPin, this->spotCount) {
+  this->spots = spots;
+  this->echoPin = echoPin;
+
+  currentSpot = 0;
+  measuring = false;
+  lastEchoTime = 0;
+}
+
+void ParkingController::begin() {
+  leds.init();
+  for (uint8_t i = 0; i < spotCount; i++) {
+    spots[i].begin(&leds, i, &sessionLog);
+  }
+  echoCapture.begin(echoPin);
+}
+
+void ParkingController::setConfirmationTimes(unsigned long enterTime,
+                                             unsigned long exitTime) {
+  for (uint8_t i = 0; i < spotCount; i++) {
+    spots[i].setConfirmationTimes(enterTime, exitTime);
+  }
+}
+
+void ParkingController::setTransitionHandler(
+    ParkingTransitionHandler handler) {
+  for (uint8_t i = 0; i < spotCount; i++) {
+    spots[i].setTransitionHandler(handler);
+  }
+}
+
+void ParkingController::setChangeThreshold(float threshold) {
+  for (uint8_t i = 0; i < spotCount; i++) {
+    spots[i].setChangeThreshold(threshold);
+  }
+}
+
+void ParkingController::saveSnapshot(SpotSnapshot *snapshot) {
+  for (uint8_t i = 0; i < spotCount; i++) {
+    spots[i].saveSnapshot(snapshot[i]);
+  }
+}
+
+void ParkingController::restoreSnapshot(const SpotSnapshot *snapshot) {
+  for (uint8_t i = 0; i < spotCount; i++) {
+    spots[i].restoreSnapshot(snapshot[i], millis());
+  }
+}
+
+void ParkingController::update() {
+  PROFILE_SCOPE(PROFILE_STAGE_PARKING);
+  unsigned long currentTime = millis();
+
+  if (measuring) {
+    ParkingSensor &spot = spots[currentSpot];
+    switch (echoCapture.poll()) {
+    case ECHO_WAITING:
+      return;
+    case ECHO_READY: {
+      PROFILE_EVENT(PROFILE_STAGE_ECHO);
+      SENSOR_TRACE_BEGIN("echo");
+      SENSOR_TRACE_FIELD(currentSpot);
+      SENSOR_TRACE_FIELD(echoCapture.getEchoWidth());
+      SENSOR_TRACE_END();
+      spot.addDistance(
+          EchoCapture::widthToDistanceCm(echoCapture.getEchoWidth()),
+          currentTime);
+      break;
+    }
+    default:
+      SENSOR_TRACE_BEGIN("echo");
+      SENSOR_TRACE_FIELD(currentSpot);
+      SENSOR_TRACE_FIELD(0);
+      SENSOR_TRACE_END();
+      Serial.print(F("No echo received from spot "));
+      Serial.println(currentSpot);
+      spot.getPoller().polled(false, currentTime);
+      break;
+    }
+
+    measuring = false;
+    lastEchoTime = currentTime;
+    currentSpot = (currentSpot + 1) % spotCount;
+  }
+
+  if (currentTime - lastEchoTime < PARKING_GUARD_TIME) {
+    return;
+  }
+
+  // Next spot in round-robin order whose poller asks for a reading
+  for (uint8_t i = 0; i < spotCount; i++) {
+    uint8_t candidate = (currentSpot + i) % spotCount;
+    if (spots[candidate].getPoller().isDue(currentTime)) {
+      currentSpot = candidate;
+      echoCapture.trigger(spots[currentSpot].getTriggerPin());
+      measuring = true;
+      return;
+    }
+  }
+}
+
+unsigned long ParkingController::getIdleTime(unsigned long now) {
+  if (measuring) {
+    return 0;
+  }
+
+  unsigned long idleTime = 0xFFFFFFFFUL;
+  for (uint8_t i = 0; i < spotCount; i++) {
+    unsigned long untilDue = spots[i].getPoller().getTimeUntilDue(now);
+    if (untilDue < idleTime) {
+      idleTime = untilDue;
+    }
+  }
+
+  unsigned long sinceEcho = now - lastEchoTime;
+  if (sinceEcho < PARKING_GUARD_TIME &&
+      PARKING_GUARD_TIME - sinceEcho > idleTime) {
+    idleTime = PARKING_GUARD_TIME - sinceEcho;
+  }
+  return idleTime;
+}
+
+float ParkingController::getDutyRatio() {
+  unsigned long currentTime = millis();
+  float total = 0;
+  for (uint8_t i = 0; i < spotCount; i++) {
+    total += spots[i].getPoller().getDutyRatio(currentTime);
+  }
+  return spotCount ? total / spotCount : 0;
+}
+
+uint8_t ParkingController::getOccupancyBitmap() {
+  uint8_t bitmap = 0;
+  for (uint8_t i = 0; i < spotCount; i++) {
+    if (spots[i].getParkingState() == PARKING_OCCUPIED) {
+      bitmap |= 1 << i;
+    }
+  }
+  return bitmap;
+}
+
+uint8_t ParkingController::buildPayload(uint8_t *payload, uint8_t maxLength) {
+  uint8_t length = 0;
+  uint8_t bitmap = getOccupancyBitmap();
+
+  payload[length++] = spotCount;
+  payload[length++] = bitmap;
+
+  // Occupied spots only, in spot order: minutes parked, saturated
+  for (uint8_t i = 0; i < spotCount; i++) {
+    if (!(bitmap & (1 << i))) {
+      continue;
+    }
+    unsigned long minutes = spots[i].getOccupancyTime() / 60;
+    uint16_t duration = minutes > 0xFFFF ? 0xFFFF : minutes;
+    payload[length++] = (duration >> 8) & 0xFF;
+    payload[length++] = duration & 0xFF;
+  }
+
+  length += sessionLog.build(&payload[length], maxLength - length, millis());
+  return length;
+}
@@ -0,0 +1,66 @@
+#ifndef PARKING_CONTROLLER_H
+#define PARKING_CONTROLLER_H
+
+#include <Arduino.h>
+#include <EchoCapture.h>
+#include <ParkingSensor.h>
+#include <SessionLog.h>
+
+#define PARKING_MAX_SPOTS 8
+#define PARKING_GUARD_TIME 60 // ms of silence between two sensors' pings
+
+// Spot count, occupancy bitmap, then 2 bytes per occupied spot
+#define PARKING_LIVE_MAX (2 + 2 * PARKING_MAX_SPOTS)
+// Live state plus a session batch, within the EU868 DR0 payload limit
+#define PARKING_PAYLOAD_MAX 51
+
+// Drives several HC-SR04 spots from one MCU. Each spot has its own trigger
+// pin; the echo lines are diode-OR'ed onto a single interrupt pin, which is
+// safe because only one sensor is pinged at a time. Spots that are due,
+// according to their own AdaptivePoller, are pinged round-robin with a guard
+// time so late echoes of one sensor never reach the next, and each spot
+// lights its own LED on a chain of N.
+class ParkingController {
+private:
+  ParkingSensor *spots;
+  uint8_t spotCount;
+  SpotLeds leds;
+  EchoCapture echoCapture;
+  SessionLog sessionLog;
+  byte echoPin;
+
+  uint8_t currentSpot;
+  bool measuring;
+  unsigned long lastEchoTime;
+
+public:
+  ParkingController(ParkingSensor *spots, uint8_t spotCount, byte echoPin,
+                    byte ledDataPin, byte ledClockPin);
+  void begin();
+  void update();
+  // ms before update() has anything to do: 0 while an echo is awaited,
+  // otherwise until the next spot is due and the guard time is over
+  unsigned long getIdleTime(unsigned long now);
+
+  void setConfirmationTimes(unsigned long enterTime, unsigned long exitTime);
+  void setTransitionHandler(ParkingTransitionHandler handler);
+  void setChangeThreshold(float threshold);
+  // One entry per spot
+  void saveSnapshot(SpotSnapshot *snapshot);
+  void restoreSnapshot(const SpotSnapshot *snapshot);
+
+  uint8_t getSpotCount() { return spotCount; }
+  ParkingSensor &getSpot(uint8_t index) { return spots[index]; }
+  uint8_t getOccupancyBitmap();
+  // Mean of the spots' poll duty ratios, 1.0 being always at the fast rate
+  float getDutyRatio();
+
+  uint8_t getPendingSessions() { return sessionLog.getCount(); }
+
+  // Live state followed by as many completed sessions as fit. maxLength must
+  // hold PARKING_LIVE_MAX. The sessions stay logged until payloadSent(true).
+  uint8_t buildPayload(uint8_t *payload, uint8_t maxLength);
+  void payloadSent(bool sent) { sessionLog.commit(sent); }
+};
+
+#endif // PARKING_CONTROLLER_H
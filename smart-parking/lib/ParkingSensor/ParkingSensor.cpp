@@ -1,183 +1,249 @@
 #include "ParkingSensor.h"
 
-ParkingSensor::ParkingSensor(int trigger, int echo, int dataPin, int clockPin) {
-  leds = new ChainableLED(dataPin, clockPin, 1);
-  parkingState = PARKING_FREE;
-
-  triggerPin = trigger;
-  echoPin = echo;
-
-  currentDistance = 0;
-  baselineDistance = 0;
+ParkingSensor::ParkingSensor(byte triggerPin)
+    : distanceFilter(DISTANCE(DISTANCE_OUTLIER_SCALE),
+                     DISTANCE(DISTANCE_OUTLIER_MIN)) {
+  leds = nullptr;
+  spotIndex = 0;
+  transitionHandler = nullptr;
+  sessionLog = nullptr;
+
+  this->triggerPin = triggerPin;
+
+  currentDistance = DISTANCE(0);
+  baselineDistance = DISTANCE(0);
+  changeThreshold = DISTANCE(DISTANCE_CHANGE_THRESHOLD);
   baselineCalibrated = false;
-  distanceSensor = new UltraSonicDistanceSensor(triggerPin, echoPin);
+#ifdef FIXED_POINT
+  driftRemainder = 0;
+#endif
 
-  distanceHistory[0] = 0;
-  distanceHistory[1] = 0;
-  distanceHistory[2] = 0;
+  distanceHistory[0] = DISTANCE(0);
+  distanceHistory[1] = DISTANCE(0);
+  distanceHistory[2] = DISTANCE(0);
   currentDistanceIndex = 0;
   lastCalculationTime = 0;
   measurementCount = 0;
 
-  vehicleDetected = false;
-  vehicleDetectionTime = 0;
   occupancyStartTime = 0;
-  occupancyTime = 0;
+  departureTime = 0;
 }
 
-void ParkingSensor::begin() {
-  leds->setColorRGB(0, 0, 255, 0);
-  parkingState = PARKING_FREE;
+void ParkingSensor::begin(SpotLeds *leds, uint8_t spotIndex,
+                          SessionLog *sessionLog) {
+  this->leds = leds;
+  this->spotIndex = spotIndex;
+  this->sessionLog = sessionLog;
+  stateMachine.reset(STATE_FREE, millis());
+  poller.start(millis());
+  showState(STATE_FREE);
 
   pinMode(triggerPin, OUTPUT);
-  pinMode(echoPin, INPUT);
+  digitalWrite(triggerPin, LOW);
+
+  Serial.print(F("Parking spot "));
+  Serial.print(spotIndex);
+  Serial.println(F(" initialized. Calibrating baseline..."));
+}
+
+void ParkingSensor::calibrateBaseline(float distance) {
+  if (distance <= 0.5 || distance >= 200) {
+    return;
+  }
+
+  baselineEstimator.add(distance);
+  Serial.print(F("Calibration reading #"));
+  Serial.print(baselineEstimator.getCount());
+  Serial.print(F(": "));
+  Serial.print(distance);
+  Serial.println(F(" cm"));
 
-  Serial.println(F("Parking sensor initialized. Calibrating baseline..."));
+  // The window keeps sliding until it is full and steady
+  if (!baselineEstimator.isFull() ||
+      baselineEstimator.spread() > BASELINE_MAX_SPREAD) {
+    return;
+  }
 
-  calibrateBaseline();
+  baselineDistance = DISTANCE(baselineEstimator.trimmedMean());
+  baselineCalibrated = true;
+  Serial.print(F("Baseline distance calibrated: "));
+  Serial.print(DISTANCE_TO_FLOAT(baselineDistance));
+  Serial.println(F(" cm"));
+  Serial.println(F("Using middle 60% of readings with outliers removed"));
 }
 
-void ParkingSensor::calibrateBaseline() {
-  float readings[15];
-  int validReadings = 0;
+void ParkingSensor::saveSnapshot(SpotSnapshot &snapshot) {
+  snapshot.baseline =
+      baselineCalibrated ? DISTANCE_TO_FLOAT(baselineDistance) : 0;
+  snapshot.occupiedFor = getOccupancyTime();
+  snapshot.occupied = stateMachine.isOccupied();
+}
 
-  Serial.println(F("Measuring baseline distance..."));
+void ParkingSensor::restoreSnapshot(const SpotSnapshot &snapshot,
+                                    unsigned long now) {
+  if (snapshot.baseline <= 0) {
+    return;
+  }
 
-  for (int i = 0; i < 15; i++) {
-    float distance = distanceSensor->measureDistanceCm();
+  baselineDistance = DISTANCE(snapshot.baseline);
+  currentDistance = baselineDistance;
+  baselineCalibrated = true;
+  Serial.print(F("Spot "));
+  Serial.print(spotIndex);
+  Serial.print(F(": baseline restored, "));
+  Serial.print(snapshot.baseline);
+  Serial.println(F(" cm"));
 
-    if (distance > 0.5 && distance < 200) {
-      readings[validReadings] = distance;
-      validReadings++;
-      Serial.print(F("Calibration reading #"));
-      Serial.print(i + 1);
-      Serial.print(F(": "));
-      Serial.print(distance);
-      Serial.println(F(" cm"));
-    }
-    delay(200);
+  if (snapshot.occupied) {
+    stateMachine.reset(STATE_OCCUPIED, now);
+    occupancyStartTime = now - snapshot.occupiedFor * 1000UL;
+    // Red, as from the first detection of the stay
+    showState(STATE_DETECTING);
   }
+}
 
-  if (validReadings >= 10) {
-    for (int i = 0; i < validReadings - 1; i++) {
-      for (int j = i + 1; j < validReadings; j++) {
-        if (readings[i] > readings[j]) {
-          float temp = readings[i];
-          readings[i] = readings[j];
-          readings[j] = temp;
-        }
-      }
-    }
+void ParkingSensor::trackBaseline(Distance distance) {
+  // Follows slow drift (speed of sound vs temperature) while the spot is
+  // free; readings far enough to count as a vehicle never get here.
+  baselineEstimator.add(DISTANCE_TO_FLOAT(distance));
+  if (!baselineEstimator.isFull()) {
+    return;
+  }
 
-    int startIndex = validReadings * 0.2;
-    int endIndex = validReadings * 0.8;
-    float sum = 0;
-    int count = 0;
+  Distance gap = DISTANCE(baselineEstimator.trimmedMean()) - baselineDistance;
+#ifdef FIXED_POINT
+  // What falls below a step is carried to the next reading
+  int32_t step = gap.getRaw() * BASELINE_DRIFT_GAIN_Q16 + driftRemainder;
+  baselineDistance += Distance::fromRaw(step >> 16);
+  driftRemainder = step & 0xFFFF;
+#else
+  baselineDistance += gap * BASELINE_DRIFT_GAIN;
+#endif
+}
 
-    for (int i = startIndex; i < endIndex; i++) {
-      sum += readings[i];
-      count++;
-    }
+void ParkingSensor::addDistance(float distance, unsigned long currentTime) {
+  // Converted once; calibration alone keeps the float
+  Distance reading = DISTANCE(distance);
+  bool active = isActive(reading);
 
-    baselineDistance = sum / count;
-    baselineCalibrated = true;
-    Serial.print(F("Baseline distance calibrated: "));
-    Serial.print(baselineDistance);
-    Serial.println(F(" cm"));
-    Serial.println(F("Using middle 60% of readings with outliers removed"));
+  if (baselineCalibrated) {
+    processDistance(reading, currentTime);
   } else {
-    Serial.println(F("Calibration failed! Not enough valid readings. Will "
-                     "retry in update loop."));
+    calibrateBaseline(distance);
   }
-}
 
-void ParkingSensor::update() {
-  unsigned long currentTime = millis();
+  poller.polled(active, currentTime);
+}
 
-  if (!baselineCalibrated) {
-    calibrateBaseline();
-    return;
+bool ParkingSensor::isActive(Distance rawDistance) {
+  // Calibration and pending confirmations always run at the fast rate
+  if (!baselineCalibrated || stateMachine.getState() == STATE_DETECTING ||
+      stateMachine.getState() == STATE_LEAVING) {
+    return true;
+  }
+  if (rawDistance <= DISTANCE(0) || rawDistance >= DISTANCE(200)) {
+    return false;
   }
+  return DISTANCE_ABS(rawDistance - currentDistance) > changeThreshold;
+}
 
-  float rawDistance = distanceSensor->measureDistanceCm();
+void ParkingSensor::processDistance(Distance rawDistance,
+                                    unsigned long currentTime) {
   Serial.print(F("Raw distance: "));
-  Serial.print(rawDistance);
+  Serial.print(DISTANCE_TO_FLOAT(rawDistance));
   Serial.println(F(" cm"));
 
-  if (rawDistance > 0 && rawDistance < 200) {
-    distanceHistory[currentDistanceIndex] = rawDistance;
+  if (rawDistance > DISTANCE(0) && rawDistance < DISTANCE(200)) {
+    distanceHistory[currentDistanceIndex] = distanceFilter.filter(rawDistance);
     currentDistanceIndex = (currentDistanceIndex + 1) % 3;
 
     measurementCount++;
     if (measurementCount >= 3 && (currentTime - lastCalculationTime) > 200) {
-      float avgDistance =
-          (distanceHistory[0] + distanceHistory[1] + distanceHistory[2]) / 3.0;
+      Distance avgDistance =
+          (distanceHistory[0] + distanceHistory[1] + distanceHistory[2]) / 3;
       currentDistance = avgDistance;
 
       bool consistentReadings = true;
       for (int i = 0; i < 3; i++) {
-        if (abs(distanceHistory[i] - avgDistance) > 0.5) {
+        if (DISTANCE_ABS(distanceHistory[i] - avgDistance) > DISTANCE(0.5)) {
           consistentReadings = false;
           break;
         }
-        if (distanceHistory[i] <= 0.1) {
+        if (distanceHistory[i] <= DISTANCE(0.1)) {
           consistentReadings = false;
           break;
         }
       }
 
       Serial.print(F("Avg distance: "));
-      Serial.print(avgDistance);
+      Serial.print(DISTANCE_TO_FLOAT(avgDistance));
       Serial.print(F(" cm, Baseline: "));
-      Serial.print(baselineDistance);
+      Serial.print(DISTANCE_TO_FLOAT(baselineDistance));
       Serial.print(F(" cm, Difference: "));
-      Serial.print(abs(avgDistance - baselineDistance));
+      Serial.print(
+          DISTANCE_TO_FLOAT(DISTANCE_ABS(avgDistance - baselineDistance)));
       Serial.print(F(" cm, Consistent: "));
       Serial.println(consistentReadings ? F("Yes") : F("No"));
 
-      if (consistentReadings &&
-          (abs(avgDistance - baselineDistance) > DISTANCE_CHANGE_THRESHOLD)) {
-        if (!vehicleDetected) {
-          vehicleDetected = true;
-          vehicleDetectionTime = currentTime;
-
-          leds->setColorRGB(0, 255, 0, 0);
-          Serial.println(F("Vehicle detected!"));
-        } else {
-          if (parkingState == PARKING_FREE &&
-              (currentTime - vehicleDetectionTime >= 5000)) {
-            parkingState = PARKING_OCCUPIED;
-            occupancyStartTime = vehicleDetectionTime;
-            Serial.println(F("Parking confirmed after 5 seconds. "));
-            leds->setColorRGB(0, 255, 0, 0);
-          }
-        }
-      } else {
-        if (vehicleDetected) {
-          vehicleDetected = false;
-
-          if (parkingState == PARKING_OCCUPIED) {
-            parkingState = PARKING_FREE;
-            occupancyTime = 0;
-
-            Serial.println(F("Vehicle left. Parking spot is now FREE"));
-            leds->setColorRGB(0, 0, 255, 0);
-          } else {
-            leds->setColorRGB(0, 0, 255, 0);
-            Serial.println(F("False detection. Switching back to GREEN"));
-          }
-        }
+      ParkingEvent event = EVENT_NONE;
+      if (consistentReadings) {
+        event = DISTANCE_ABS(avgDistance - baselineDistance) > changeThreshold
+                    ? EVENT_PRESENT
+                    : EVENT_ABSENT;
+      }
+
+      if (event == EVENT_ABSENT && stateMachine.getState() == STATE_FREE) {
+        trackBaseline(avgDistance);
+      }
+
+      ParkingState previousState = stateMachine.getState();
+      if (stateMachine.handle(event, currentTime)) {
+        onTransition(previousState, stateMachine.getState(), currentTime);
       }
 
       lastCalculationTime = currentTime;
     }
   }
+}
+
+void ParkingSensor::onTransition(ParkingState from, ParkingState to,
+                                 unsigned long currentTime) {
+  if (to == STATE_DETECTING) {
+    // A confirmed stay is counted from the first detection
+    occupancyStartTime = currentTime;
+  } else if (to == STATE_LEAVING) {
+    departureTime = currentTime;
+  } else if (from == STATE_LEAVING && to == STATE_FREE && sessionLog) {
+    // The stay ended when the vehicle left, not when that was confirmed
+    sessionLog->add(spotIndex, occupancyStartTime,
+                    (departureTime - occupancyStartTime) / 1000);
+  }
+
+  Serial.print(F("Spot "));
+  Serial.print(spotIndex);
+  Serial.print(F(": "));
+  Serial.print(ParkingStateMachine::stateName(from));
+  Serial.print(F(" -> "));
+  Serial.println(ParkingStateMachine::stateName(to));
 
-  delay(100);
+  showState(to);
+
+  if (transitionHandler) {
+    transitionHandler(spotIndex, from, to, currentTime);
+  }
+}
+
+void ParkingSensor::showState(ParkingState state) {
+  // Red from the first detection until the spot is confirmed free again
+  if (state == STATE_FREE) {
+    leds->setColorRGB(spotIndex, 0, 255, 0);
+  } else if (state == STATE_DETECTING) {
+    leds->setColorRGB(spotIndex, 255, 0, 0);
+  }
 }
 
 unsigned long ParkingSensor::getOccupancyTime() {
-  if (parkingState == PARKING_OCCUPIED) {
+  if (stateMachine.isOccupied()) {
     return (millis() - occupancyStartTime) / 1000;
   }
   return 0;
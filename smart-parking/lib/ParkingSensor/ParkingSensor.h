@@ -1,49 +1,142 @@
 #ifndef PARKING_SENSOR_H
 #define PARKING_SENSOR_H
 
+#include <AdaptivePoller.h>
 #include <Arduino.h>
+#include <BaselineEstimator.h>
+#include <OutlierFilter.h>
+#include <ParkingStateMachine.h>
+#include <SessionLog.h>
+
+// The heap-free build drives the LED chain without the Grove library
+#ifdef HEAP_FREE
+#include <LedChain.h>
+typedef LedChain SpotLeds;
+#else
 #include <ChainableLED.h>
-#include <HCSR04.h>
+typedef ChainableLED SpotLeds;
+#endif
 
 #define PARKING_FREE 0
 #define PARKING_OCCUPIED 1
 
-#define DISTANCE_CHANGE_THRESHOLD 0.6
+#define DISTANCE_CHANGE_THRESHOLD 0.6 // cm, default
+
+// Echo spikes: a reading further from the median of the last
+// DISTANCE_OUTLIER_WINDOW than DISTANCE_OUTLIER_SCALE median absolute
+// deviations, and than DISTANCE_OUTLIER_MIN, is replaced by that median before
+// the averaging. A vehicle arriving or leaving shows two readings later.
+#define DISTANCE_OUTLIER_WINDOW 5
+#define DISTANCE_OUTLIER_SCALE 4 // MADs, about 2.7 standard deviations
+#define DISTANCE_OUTLIER_MIN 2.0 // cm
+
+#define BASELINE_MAX_SPREAD 2.0  // cm, window must be this tight to calibrate
+#define BASELINE_DRIFT_GAIN 0.02 // fraction of the gap closed per free reading
+
+// Built with FIXED_POINT, the averaging and threshold tests run on Q24.8
+// centimetres; the echo conversion and the baseline estimator stay in float
+#ifdef FIXED_POINT
+#include <FixedPoint.h>
+typedef Q24_8 Distance;
+#define DISTANCE(x) Q24_8::fromFloat(x)
+#define DISTANCE_TO_FLOAT(x) (x).toFloat()
+#define DISTANCE_ABS(x) (x).absolute()
+// The drift gain in 1/65536: as a Q24.8 number it would be 5/256, and a gap
+// times it under one step, so gaps below 0.2 cm would never be closed
+#define BASELINE_DRIFT_GAIN_Q16 ((int32_t)(BASELINE_DRIFT_GAIN * 65536 + 0.5))
+#else
+typedef float Distance;
+#define DISTANCE(x) (x)
+#define DISTANCE_TO_FLOAT(x) (x)
+#define DISTANCE_ABS(x) abs(x)
+#endif
+
+// Warm-restart state of a spot, so a reset skips the calibration
+struct SpotSnapshot {
+  float baseline;       // cm, 0 until calibrated
+  uint32_t occupiedFor; // s, 0 while free
+  uint8_t occupied;
+};
+
+typedef void (*ParkingTransitionHandler)(uint8_t spot, ParkingState from,
+                                         ParkingState to, unsigned long time);
 
+// Detection logic for one parking spot. Distances are measured by the
+// ParkingController, which also owns the LED strip this spot lights.
 class ParkingSensor {
 private:
-  ChainableLED *leds;
-  uint8_t parkingState;
+  SpotLeds *leds;
+  uint8_t spotIndex;
+  ParkingStateMachine stateMachine;
+  ParkingTransitionHandler transitionHandler;
+  SessionLog *sessionLog;
 
   byte triggerPin;
-  byte echoPin;
-  UltraSonicDistanceSensor *distanceSensor;
 
-  float baselineDistance;
-  float currentDistance;
+  Distance baselineDistance;
+  Distance currentDistance;
+  Distance changeThreshold;
   bool baselineCalibrated;
+#ifdef FIXED_POINT
+  uint16_t driftRemainder; // 1/65536 of a baseline step, not yet applied
+#endif
+  BaselineEstimator baselineEstimator;
+  AdaptivePoller poller;
 
-  bool vehicleDetected;
-  unsigned long vehicleDetectionTime;
   unsigned long occupancyStartTime;
-  unsigned long occupancyTime;
+  unsigned long departureTime;
 
-  float distanceHistory[3];
+  HampelFilter<Distance, DISTANCE_OUTLIER_WINDOW> distanceFilter;
+  Distance distanceHistory[3];
   int currentDistanceIndex;
   float lastDistance;
   unsigned long lastCalculationTime;
   int measurementCount;
 
-  void calibrateBaseline();
+  void calibrateBaseline(float distance);
+  void trackBaseline(Distance distance);
+  void processDistance(Distance rawDistance, unsigned long currentTime);
+  bool isActive(Distance rawDistance);
+  void onTransition(ParkingState from, ParkingState to,
+                    unsigned long currentTime);
+  void showState(ParkingState state);
 
 public:
-  ParkingSensor(int triggerPin, int echoPin, int dataPin, int clockPin);
-  void begin();
-  void update();
-  float getCurrentDistance() { return currentDistance; }
-  float getBaselineDistance() { return baselineDistance; }
-  uint8_t getParkingState() { return parkingState; }
+  ParkingSensor(byte triggerPin);
+  // Completed stays are appended to sessionLog, which may be shared by spots
+  void begin(SpotLeds *leds, uint8_t spotIndex, SessionLog *sessionLog);
+  void addDistance(float distance, unsigned long currentTime);
+  void saveSnapshot(SpotSnapshot &snapshot);
+  // Call after begin(). An occupied spot resumes as OCCUPIED, its stay
+  // counted from occupiedFor seconds ago.
+  void restoreSnapshot(const SpotSnapshot &snapshot, unsigned long now);
+
+  // Time a vehicle must be seen before the spot is OCCUPIED, and time it
+  // must be gone before the spot is FREE again
+  void setConfirmationTimes(unsigned long enterTime, unsigned long exitTime) {
+    stateMachine.setConfirmationTimes(enterTime, exitTime);
+  }
+  void setTransitionHandler(ParkingTransitionHandler handler) {
+    transitionHandler = handler;
+  }
+  // Distance from the baseline that means a vehicle, in cm
+  void setChangeThreshold(float threshold) {
+    changeThreshold = DISTANCE(threshold);
+  }
+
+  byte getTriggerPin() { return triggerPin; }
+  float getCurrentDistance() { return DISTANCE_TO_FLOAT(currentDistance); }
+  float getBaselineDistance() { return DISTANCE_TO_FLOAT(baselineDistance); }
+  bool isCalibrated() { return baselineCalibrated; }
+  // Decides when the controller pings this spot next
+  AdaptivePoller &getPoller() { return poller; }
+
+  ParkingState getState() { return stateMachine.getState(); }
+  // LEAVING still counts as occupied until the exit time has elapsed
+  uint8_t getParkingState() {
+    return stateMachine.isOccupied() ? PARKING_OCCUPIED : PARKING_FREE;
+  }
   unsigned long getOccupancyTime();
 };
 
-#endif // PARKING_SENSOR_H
\ No newline at end of file
+#endif // PARKING_SENSOR_H
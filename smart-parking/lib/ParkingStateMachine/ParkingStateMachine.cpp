@@ -0,0 +1,63 @@
+#include "ParkingStateMachine.h"
+
+constexpr ParkingTransition PARKING_TRANSITIONS[] = {
+    {STATE_FREE, EVENT_PRESENT, TIMER_NONE, STATE_DETECTING},
+    {STATE_DETECTING, EVENT_ABSENT, TIMER_NONE, STATE_FREE},
+    {STATE_DETECTING, EVENT_PRESENT, TIMER_ENTER, STATE_OCCUPIED},
+    {STATE_OCCUPIED, EVENT_ABSENT, TIMER_NONE, STATE_LEAVING},
+    {STATE_LEAVING, EVENT_PRESENT, TIMER_NONE, STATE_OCCUPIED},
+    {STATE_LEAVING, EVENT_ABSENT, TIMER_EXIT, STATE_FREE},
+};
+
+ParkingStateMachine::ParkingStateMachine() {
+  state = STATE_FREE;
+  stateSince = 0;
+  enterTime = PARKING_ENTER_TIME;
+  exitTime = PARKING_EXIT_TIME;
+}
+
+void ParkingStateMachine::setConfirmationTimes(unsigned long enterTime,
+                                               unsigned long exitTime) {
+  this->enterTime = enterTime;
+  this->exitTime = exitTime;
+}
+
+void ParkingStateMachine::reset(ParkingState state, unsigned long now) {
+  this->state = state;
+  stateSince = now;
+}
+
+bool ParkingStateMachine::handle(ParkingEvent event, unsigned long now) {
+  unsigned long elapsed = now - stateSince;
+
+  for (const ParkingTransition &transition : PARKING_TRANSITIONS) {
+    if (transition.from != state || transition.event != event) {
+      continue;
+    }
+    if ((transition.after == TIMER_ENTER && elapsed < enterTime) ||
+        (transition.after == TIMER_EXIT && elapsed < exitTime)) {
+      continue;
+    }
+
+    state = transition.to;
+    stateSince = now;
+    return true;
+  }
+
+  return false;
+}
+
+const __FlashStringHelper *ParkingStateMachine::stateName(ParkingState state) {
+  switch (state) {
+  case STATE_FREE:
+    return F("FREE");
+  case STATE_DETECTING:
+    return F("DETECTING");
+  case STATE_OCCUPIED:
+    return F("OCCUPIED");
+  case STATE_LEAVING:
+    return F("LEAVING");
+  default:
+    return F("?");
+  }
+}
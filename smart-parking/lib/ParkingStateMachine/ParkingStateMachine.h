@@ -0,0 +1,58 @@
+#ifndef PARKING_STATE_MACHINE_H
+#define PARKING_STATE_MACHINE_H
+
+#include <Arduino.h>
+
+#define PARKING_ENTER_TIME 5000 // ms a vehicle must stay before OCCUPIED
+#define PARKING_EXIT_TIME 2000  // ms a spot must stay empty before FREE
+
+enum ParkingState : uint8_t {
+  STATE_FREE,
+  STATE_DETECTING,
+  STATE_OCCUPIED,
+  STATE_LEAVING,
+  PARKING_STATE_COUNT
+};
+
+enum ParkingEvent : uint8_t {
+  EVENT_NONE,    // no usable reading, only timers may fire
+  EVENT_ABSENT,  // steady reading at the baseline
+  EVENT_PRESENT, // steady reading past the detection threshold
+};
+
+enum ParkingTimer : uint8_t { TIMER_NONE, TIMER_ENTER, TIMER_EXIT };
+
+// Row of the transition table: taken when the machine is in `from`, gets
+// `event`, and has spent the `after` confirmation time in `from`.
+struct ParkingTransition {
+  ParkingState from;
+  ParkingEvent event;
+  ParkingTimer after;
+  ParkingState to;
+};
+
+class ParkingStateMachine {
+private:
+  ParkingState state;
+  unsigned long stateSince;
+  unsigned long enterTime;
+  unsigned long exitTime;
+
+public:
+  ParkingStateMachine();
+  void setConfirmationTimes(unsigned long enterTime, unsigned long exitTime);
+
+  // Applies the first matching transition; returns true if the state changed
+  bool handle(ParkingEvent event, unsigned long now);
+  void reset(ParkingState state, unsigned long now);
+
+  ParkingState getState() { return state; }
+  unsigned long getStateSince() { return stateSince; }
+  bool isOccupied() {
+    return state == STATE_OCCUPIED || state == STATE_LEAVING;
+  }
+
+  static const __FlashStringHelper *stateName(ParkingState state);
+};
+
+#endif // PARKING_STATE_MACHINE_H
@@ -0,0 +1,46 @@
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <Arduino.h>
+
+// Raw sensor samples for the host replay tool (see host/README.md), printed
+// as "TRACE <millis> <kind> <fields...>" lines among the normal console
+// output. Built with -DSENSOR_TRACE only; otherwise the calls vanish.
+#ifdef SENSOR_TRACE
+
+#define SENSOR_TRACE_BEGIN(kind)                                               \
+  do {                                                                         \
+    Serial.print(F("TRACE "));                                                 \
+    Serial.print(millis());                                                    \
+    Serial.print(F(" " kind));                                                 \
+  } while (0)
+
+#define SENSOR_TRACE_FIELD(value)                                              \
+  do {                                                                         \
+    Serial.print(' ');                                                         \
+    Serial.print(value);                                                       \
+  } while (0)
+
+#define SENSOR_TRACE_HEX(buffer, length)                                       \
+  do {                                                                         \
+    Serial.print(' ');                                                         \
+    for (uint8_t traceIndex = 0; traceIndex < (length); traceIndex++) {        \
+      if ((buffer)[traceIndex] < 0x10) {                                       \
+        Serial.print('0');                                                     \
+      }                                                                        \
+      Serial.print((buffer)[traceIndex], HEX);                                 \
+    }                                                                          \
+  } while (0)
+
+#define SENSOR_TRACE_END() Serial.println()
+
+#else
+
+#define SENSOR_TRACE_BEGIN(kind)
+#define SENSOR_TRACE_FIELD(value)
+#define SENSOR_TRACE_HEX(buffer, length)
+#define SENSOR_TRACE_END()
+
+#endif
+
+#endif // SENSOR_TRACE_H
@@ -0,0 +1,96 @@
+#include "SessionLog.h"
+
+SessionLog::SessionLog() {
+  head = 0;
+  count = 0;
+  dropped = 0;
+  batchCount = 0;
+  batchDropped = 0;
+}
+
+void SessionLog::add(uint8_t spot, uint32_t start, uint32_t duration) {
+  uint8_t index = (head + count) % SESSION_LOG_SIZE;
+  if (count == SESSION_LOG_SIZE) {
+    head = (head + 1) % SESSION_LOG_SIZE;
+    if (dropped < 0xFFFF) {
+      dropped++;
+    }
+    batchCount = 0;
+  } else {
+    count++;
+  }
+
+  sessions[index].spot = spot;
+  sessions[index].start = start;
+  sessions[index].duration = duration;
+}
+
+uint8_t SessionLog::encodeVarint(uint32_t value, uint8_t *buffer) {
+  uint8_t length = 0;
+  while (value >= 0x80) {
+    buffer[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  buffer[length++] = value;
+  return length;
+}
+
+uint8_t SessionLog::build(uint8_t *buffer, uint8_t maxLength,
+                          unsigned long now) {
+  uint8_t scratch[1 + 2 * SESSION_VARINT_MAX];
+  uint8_t length = 1;
+
+  batchCount = 0;
+  // Count and dropped count take up to 4 bytes before the first session
+  if (count == 0 || maxLength < 4) {
+    return 0;
+  }
+
+  length += encodeVarint(dropped, &buffer[length]);
+
+  uint8_t written = 0;
+  uint32_t referenceAge = 0; // s, of the start the back end rebuilt last
+  while (written < count) {
+    const ParkingSession &session =
+        sessions[(head + written) % SESSION_LOG_SIZE];
+
+    // Every start is in the past, so its age in ms is right across the
+    // millis() rollover and up to 49 days. Sessions are logged when they end,
+    // so their starts are not ordered and a delta may be negative.
+    uint32_t age = (uint32_t)(now - session.start) / 1000;
+    int32_t delta = (int32_t)(age - referenceAge);
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+
+    uint8_t size = 0;
+    scratch[size++] = session.spot;
+    size += encodeVarint(zigzag, &scratch[size]);
+    size += encodeVarint(session.duration, &scratch[size]);
+    if (length + size > maxLength) {
+      break;
+    }
+
+    memcpy(&buffer[length], scratch, size);
+    length += size;
+    // Ages are whole seconds, so rounding does not accumulate along the batch
+    referenceAge = age;
+    written++;
+  }
+
+  if (written == 0) {
+    return 0;
+  }
+
+  buffer[0] = written;
+  batchCount = written;
+  batchDropped = dropped;
+  return length;
+}
+
+void SessionLog::commit(bool sent) {
+  if (sent && batchCount > 0) {
+    head = (head + batchCount) % SESSION_LOG_SIZE;
+    count -= batchCount;
+    dropped -= batchDropped;
+  }
+  batchCount = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <Arduino.h>
+
+#define SESSION_LOG_SIZE 16
+#define SESSION_VARINT_MAX 5 // bytes for a 32-bit varint
+
+struct ParkingSession {
+  uint8_t spot;
+  uint32_t start;    // millis() at arrival
+  uint32_t duration; // s
+};
+
+// Ring of completed parking sessions, waiting to be sent. When full, the
+// oldest session is dropped and counted so the back end knows turnover was
+// lost.
+//
+// A batch is: session count, varint dropped count, then per session
+// the spot, a zigzag varint start delta and a varint duration, both in
+// seconds. The first start delta is taken from the send time and each
+// following one from the previous session's start, so the back end rebuilds
+// absolute times from the uplink's reception time.
+class SessionLog {
+private:
+  ParkingSession sessions[SESSION_LOG_SIZE];
+  uint8_t head;
+  uint8_t count;
+  uint16_t dropped;
+  // Last built batch, removed by commit(true)
+  uint8_t batchCount;
+  uint16_t batchDropped;
+
+public:
+  SessionLog();
+  void add(uint8_t spot, uint32_t start, uint32_t duration);
+
+  // Writes as many sessions as fit in maxLength bytes, oldest first, and
+  // keeps them; returns 0 if there is nothing to send or no room.
+  uint8_t build(uint8_t *buffer, uint8_t maxLength, unsigned long now);
+  // Once the batch is sent, removes its sessions and the drops it reported;
+  // otherwise the next build() starts from them again. A session dropped
+  // since build() voids the batch, which is then sent again.
+  void commit(bool sent);
+
+  uint8_t getCount() { return count; }
+  uint16_t getDropped() { return dropped; }
+
+  static uint8_t encodeVarint(uint32_t value, uint8_t *buffer);
+};
+
+#endif // SESSION_LOG_H
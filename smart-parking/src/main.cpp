@@ -1,54 +1,265 @@
 #include <Arduino.h>
+#include <ConfigStore.h>
 #include <LoRaManager.h>
-#include <ParkingSensor.h>
+#include <LoopProfiler.h>
+#include <MemoryMonitor.h>
+#include <ParkingController.h>
+#include <PowerManager.h>
+#include <SnapshotStore.h>
 
 #define TRIGGER_PIN 5
-#define ECHO_PIN 6
+#define ECHO_PIN 2 // must be an external interrupt pin, shared by all spots
 #define LED_DATA_PIN 7
 #define LED_CLOCK_PIN 8
 #define LORA_RX_PIN 10
 #define LORA_TX_PIN 11
 
-#define PARKING_CONFIRMATION_TIME 5000
+// Defaults of the site settings below
+#define PARKING_CONFIRMATION_TIME 5000 // ms before a vehicle is confirmed
+#define PARKING_EXIT_TIME 2000         // ms before a departure is confirmed
+#define LORA_UPDATE_INTERVAL 10000     // ms between status uplinks
 
-ParkingSensor parkingSensor(TRIGGER_PIN, ECHO_PIN, LED_DATA_PIN, LED_CLOCK_PIN);
+// loop() spins while an echo is awaited; timing one pass in 100 keeps the
+// profiler under 1% of it
+#define PROFILE_SAMPLE_RATE 100
+// ms between diagnostic uplinks; memory and loop profile reports alternate
+#define DIAGNOSTIC_INTERVAL 1800000UL
+#define SNAPSHOT_INTERVAL 900000UL // ms between warm-restart snapshots
+
+// uno_lowpower: the modem sleeps between uplinks and the MCU is powered down
+// while it does, so the console is only read between two sleeps
+#ifdef LOW_POWER
+#define MODEM_SLEEP true
+#else
+#define MODEM_SLEEP false
+#endif
+
+// Site settings, kept in EEPROM and changed with "set <name> <value>"
+#define CONFIG_VERSION 1
+struct NodeConfig {
+  uint32_t updateInterval;   // ms
+  uint16_t confirmationTime; // ms
+  uint16_t exitTime;         // ms
+  float changeThreshold;     // cm
+};
+const NodeConfig DEFAULT_CONFIG PROGMEM = {
+    LORA_UPDATE_INTERVAL, PARKING_CONFIRMATION_TIME, PARKING_EXIT_TIME,
+    DISTANCE_CHANGE_THRESHOLD};
+const ConfigField CONFIG_FIELDS[] PROGMEM = {
+    {"update_interval", offsetof(NodeConfig, updateInterval), CONFIG_UINT32,
+     5000, 3600000},
+    {"confirm_time", offsetof(NodeConfig, confirmationTime), CONFIG_UINT16, 0,
+     60000},
+    {"exit_time", offsetof(NodeConfig, exitTime), CONFIG_UINT16, 0, 60000},
+    {"change_cm", offsetof(NodeConfig, changeThreshold), CONFIG_FLOAT, 0.1,
+     100},
+};
+
+NodeConfig config;
+ConfigStore configStore(&config, sizeof(config), &DEFAULT_CONFIG,
+                        CONFIG_FIELDS,
+                        sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]),
+                        CONFIG_VERSION);
+
+// One entry per spot, each with its own HC-SR04 trigger pin
+ParkingSensor spots[] = {ParkingSensor(TRIGGER_PIN)};
+ParkingController parking(spots, sizeof(spots) / sizeof(spots[0]), ECHO_PIN,
+                          LED_DATA_PIN, LED_CLOCK_PIN);
 LoRaManager loraManager(LORA_RX_PIN, LORA_TX_PIN);
+// Baselines and occupancy, restored after a reset
+#define SNAPSHOT_VERSION 1
+SpotSnapshot snapshot[sizeof(spots) / sizeof(spots[0])];
+SnapshotStore snapshotStore(snapshot, sizeof(snapshot), SNAPSHOT_VERSION);
+MemoryMonitor memoryMonitor;
+PowerManager powerManager;
 
-uint8_t previousParkingState = 255;
+uint16_t previousOccupancy = 0xFFFF;
 unsigned long lastLoraUpdate = 0;
-const unsigned long LORA_UPDATE_INTERVAL = 10000;
+unsigned long lastDiagnosticTime = 0;
+uint8_t diagnosticCount = 0;
+unsigned long lastSnapshotTime = 0;
+bool snapshotDue = false;
+
+void sendParkingStatus() {
+  PROFILE_EVENT(PROFILE_STAGE_UPLINK);
+  uint8_t payload[PARKING_PAYLOAD_MAX];
+  uint8_t length = parking.buildPayload(payload, sizeof(payload));
+  // Sessions that could not go out are sent with the next status
+  parking.payloadSent(
+      loraManager.sendPayload(PARKING_STATUS_PORT, payload, length));
+}
+
+#ifdef LOOP_PROFILER
+LoopProfiler loopProfiler;
+#endif
+
+// Hands the settings to the objects that keep their own copy
+void applyConfig() {
+  parking.setConfirmationTimes(config.confirmationTime, config.exitTime);
+  parking.setChangeThreshold(config.changeThreshold);
+}
+
+void saveSnapshot() {
+  parking.saveSnapshot(snapshot);
+  snapshotStore.save();
+  lastSnapshotTime = millis();
+  snapshotDue = false;
+}
+
+// "config" and "set" manage the site settings, "snapshot" saves the
+// warm-restart state now and "snapshot clear" forgets it, "mem" prints the
+// RAM watermarks and "power" the time spent asleep; with the profiler,
+// "profile" prints the loop histograms and "profile reset" clears them
+bool onConsoleCommand(const char *line) {
+  if (configStore.handleCommand(line)) {
+    applyConfig();
+    return true;
+  }
+  if (strncmp(line, "snapshot", 8) == 0) {
+    if (strncmp(line + 8, " clear", 6) == 0) {
+      snapshotStore.clear();
+      Serial.println(F("Snapshots cleared"));
+    } else {
+      saveSnapshot();
+    }
+    snapshotStore.dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "mem", 3) == 0) {
+    memoryMonitor.dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "power", 5) == 0) {
+    powerManager.dump(Serial);
+    return true;
+  }
+#ifdef LOOP_PROFILER
+  if (strncmp(line, "profile", 7) == 0) {
+    if (strncmp(line + 7, " reset", 6) == 0) {
+      loopProfiler.reset();
+      Serial.println(F("Profile cleared"));
+    } else {
+      loopProfiler.dump(Serial);
+    }
+    return true;
+  }
+#endif
+  return false;
+}
+
+void sendDiagnostics() {
+  // Odd slots carry the loop profile, or nothing without the profiler, so
+  // memory reports are hourly either way
+  if (diagnosticCount++ % 2) {
+#ifdef LOOP_PROFILER
+    uint8_t payload[PROFILE_REPORT_MAX];
+    uint8_t length = loopProfiler.buildReport(payload, sizeof(payload));
+    loraManager.sendPayload(PROFILE_PORT, payload, length);
+    loopProfiler.reset();
+#endif
+    return;
+  }
+
+  uint8_t payload[MEMORY_REPORT_SIZE];
+  memoryMonitor.sample();
+  loraManager.sendPayload(MEMORY_PORT, payload,
+                          memoryMonitor.buildReport(payload));
+}
+
+void onParkingTransition(uint8_t spot, ParkingState from, ParkingState to,
+                         unsigned long time) {
+  // Occupancy changes are already sent from loop(); this logs confirmed
+  // departures and has confirmed changes saved, so a reset resumes from them
+  if (to == STATE_OCCUPIED && from == STATE_DETECTING) {
+    snapshotDue = true;
+  }
+  if (from == STATE_LEAVING && to == STATE_FREE) {
+    snapshotDue = true;
+    Serial.print(F("Spot "));
+    Serial.print(spot);
+    Serial.print(F(" released at "));
+    Serial.print(time / 1000);
+    Serial.println(F(" s"));
+  }
+}
 
 void setup() {
   Serial.begin(9600);
   Serial.println(F("Smart Parking System Starting..."));
 
-  parkingSensor.begin();
+  configStore.begin();
+  applyConfig();
+  parking.setTransitionHandler(onParkingTransition);
+  parking.begin();
+  if (snapshotStore.begin()) {
+    parking.restoreSnapshot(snapshot);
+  }
   loraManager.begin();
+  loraManager.setCommandHandler(onConsoleCommand);
+  loraManager.setModemSleep(MODEM_SLEEP);
+  powerManager.begin();
+#ifdef LOOP_PROFILER
+  loopProfiler.begin(PROFILE_SAMPLE_RATE);
+#endif
 
   Serial.println(F("Setup complete. Smart parking system initialized."));
 }
 
 void loop() {
-  parkingSensor.update();
-  loraManager.handleLoRaMessages();
-  loraManager.processSerialCommands();
+  {
+    // Timed without the sleep below
+    PROFILE_LOOP();
+    parking.update();
+    loraManager.handleLoRaMessages();
+    loraManager.processSerialCommands();
+
+    uint8_t occupancy = parking.getOccupancyBitmap();
+    if (occupancy != previousOccupancy && loraManager.isNetworkJoined()) {
+      Serial.println(F("Parking state changed - sending update"));
+      sendParkingStatus();
+      previousOccupancy = occupancy;
+      lastLoraUpdate = millis();
+    }
 
-  uint8_t currentParkingState = parkingSensor.getParkingState();
-  if (currentParkingState != previousParkingState &&
-      loraManager.isNetworkJoined()) {
-    Serial.println(F("Parking state changed - sending update"));
-    loraManager.sendSensorData(parkingSensor.getOccupancyTime(),
-                               currentParkingState);
-    previousParkingState = currentParkingState;
-    lastLoraUpdate = millis();
+    unsigned long currentTime = millis();
+    memoryMonitor.update(currentTime);
+    if (currentTime - lastLoraUpdate >= config.updateInterval &&
+        loraManager.isNetworkJoined()) {
+      Serial.println(F("Sending regular parking status update"));
+      Serial.print(F("Sensor poll duty: "));
+      Serial.print(parking.getDutyRatio() * 100);
+      Serial.println(F("%"));
+      sendParkingStatus();
+      lastLoraUpdate = currentTime;
+    }
+
+    // Midway between two status uplinks, so both fit the duty cycle
+    if (currentTime - lastDiagnosticTime >= DIAGNOSTIC_INTERVAL &&
+        currentTime - lastLoraUpdate >= config.updateInterval / 2 &&
+        loraManager.isNetworkJoined()) {
+      lastDiagnosticTime = currentTime;
+      sendDiagnostics();
+    }
+
+    if (snapshotDue || currentTime - lastSnapshotTime >= SNAPSHOT_INTERVAL) {
+      saveSnapshot();
+    }
   }
 
+  // Until the next ping or status uplink. An awake modem is read often
+  // enough for SoftwareSerial's buffer, and only an asleep one lets the
+  // MCU power down.
   unsigned long currentTime = millis();
-  if (currentTime - lastLoraUpdate >= LORA_UPDATE_INTERVAL &&
-      loraManager.isNetworkJoined()) {
-    Serial.println(F("Sending regular parking status update"));
-    loraManager.sendSensorData(parkingSensor.getOccupancyTime(),
-                               currentParkingState);
-    lastLoraUpdate = currentTime;
+  unsigned long sleepTime = parking.getIdleTime(currentTime);
+  unsigned long sinceUpdate = currentTime - lastLoraUpdate;
+  unsigned long untilUpdate = sinceUpdate < config.updateInterval
+                                  ? config.updateInterval - sinceUpdate
+                                  : 0;
+  if (untilUpdate < sleepTime) {
+    sleepTime = untilUpdate;
+  }
+  if (!loraManager.isModemAsleep() && sleepTime > LA66_POLL_INTERVAL) {
+    sleepTime = LA66_POLL_INTERVAL;
   }
+  powerManager.sleep(sleepTime, loraManager.isModemAsleep());
 }
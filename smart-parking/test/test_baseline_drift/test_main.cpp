@@ -0,0 +1,71 @@
+#include <ArduinoHost.h>
+#include <ParkingSensor.h>
+#include <unity.h>
+
+// Runs in both builds: with FIXED_POINT the baseline must follow the same
+// drift as the float one
+
+#define TRACE_PERIOD 150 // ms between readings, as for a lone spot
+#define TRACE_FLOOR 150.0 // cm
+
+static ChainableLED leds(7, 8, 1);
+static SessionLog sessionLog;
+static ParkingSensor sensor(5);
+
+static void feed(float distance, unsigned long duration) {
+  for (unsigned long t = 0; t < duration; t += TRACE_PERIOD) {
+    ArduinoHost::advanceMillis(TRACE_PERIOD);
+    sensor.addDistance(distance, millis());
+  }
+}
+
+void setUp() {
+  ArduinoHost::reset();
+  ArduinoHost::setSerialOutput(false);
+  sensor = ParkingSensor(5);
+  sensor.begin(&leds, 0, &sessionLog);
+  feed(TRACE_FLOOR, 5000);
+  TEST_ASSERT_TRUE(sensor.isCalibrated());
+}
+
+void tearDown() {}
+
+// A step smaller than 0.2 cm, which Q24.8 alone could not close
+void test_small_step_is_followed() {
+  TEST_ASSERT_FLOAT_WITHIN(0.01, TRACE_FLOOR, sensor.getBaselineDistance());
+  feed(TRACE_FLOOR + 0.15, 120000);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, TRACE_FLOOR + 0.15,
+                           sensor.getBaselineDistance());
+  feed(TRACE_FLOOR - 0.1, 120000);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, TRACE_FLOOR - 0.1,
+                           sensor.getBaselineDistance());
+  TEST_ASSERT_EQUAL(STATE_FREE, sensor.getState());
+}
+
+// The floor seen 1 cm further over 20 min as the air warms: the baseline lags
+// by what the filter alone explains, in both directions
+void test_slow_drift_is_followed() {
+  const unsigned long duration = 20UL * 60000;
+  for (unsigned long t = 0; t < duration; t += TRACE_PERIOD) {
+    float floor = TRACE_FLOOR + 1.0 * t / duration;
+    feed(floor, TRACE_PERIOD);
+    if (t > 60000) {
+      TEST_ASSERT_FLOAT_WITHIN(0.05, floor, sensor.getBaselineDistance());
+    }
+  }
+  for (unsigned long t = 0; t < duration; t += TRACE_PERIOD) {
+    float floor = TRACE_FLOOR + 1.0 - 1.0 * t / duration;
+    feed(floor, TRACE_PERIOD);
+    if (t > 60000) {
+      TEST_ASSERT_FLOAT_WITHIN(0.05, floor, sensor.getBaselineDistance());
+    }
+  }
+  TEST_ASSERT_EQUAL(STATE_FREE, sensor.getState());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_step_is_followed);
+  RUN_TEST(test_slow_drift_is_followed);
+  return UNITY_END();
+}
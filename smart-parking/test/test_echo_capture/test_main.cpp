@@ -0,0 +1,106 @@
+#include <ArduinoHost.h>
+#include <EchoCapture.h>
+#include <unity.h>
+
+#define ECHO_PIN 2
+#define TRIGGER_PIN 5
+
+static EchoCapture capture;
+
+static void echoHigh(void *) { ArduinoHost::setDigital(ECHO_PIN, HIGH); }
+static void echoLow(void *) { ArduinoHost::setDigital(ECHO_PIN, LOW); }
+
+// The HC-SR04 answers `delay` us after the trigger with an echo `width` us
+// wide
+static void scheduleEcho(unsigned long delay, unsigned long width) {
+  uint64_t start = ArduinoHost::now() + delay;
+  ArduinoHost::schedule(start, echoHigh, nullptr);
+  ArduinoHost::schedule(start + width, echoLow, nullptr);
+}
+
+void setUp() {
+  ArduinoHost::reset();
+  capture.begin(ECHO_PIN);
+  // Flush a result left by the previous case
+  capture.poll();
+}
+
+void tearDown() {}
+
+void test_width_to_distance() {
+  // 343.4 m/s at 20 degC: 150 cm there and back in 8736 us
+  TEST_ASSERT_FLOAT_WITHIN(0.05, 150.0, EchoCapture::widthToDistanceCm(8736));
+  TEST_ASSERT_FLOAT_WITHIN(0.05, 144.7,
+                           EchoCapture::widthToDistanceCm(8736, 0.0));
+  TEST_ASSERT_FLOAT_WITHIN(0.05, 155.3,
+                           EchoCapture::widthToDistanceCm(8736, 40.0));
+  TEST_ASSERT_EQUAL_FLOAT(0, EchoCapture::widthToDistanceCm(0));
+}
+
+void test_echo_width_is_timed() {
+  capture.trigger(TRIGGER_PIN);
+  TEST_ASSERT_EQUAL(ECHO_WAITING, capture.poll());
+  scheduleEcho(450, 8736);
+  ArduinoHost::advanceMicros(5000);
+  TEST_ASSERT_EQUAL(ECHO_WAITING, capture.poll());
+  ArduinoHost::advanceMicros(5000);
+  TEST_ASSERT_EQUAL(ECHO_READY, capture.poll());
+  TEST_ASSERT_EQUAL_UINT32(8736, capture.getEchoWidth());
+  // Reported once
+  TEST_ASSERT_EQUAL(ECHO_IDLE, capture.poll());
+}
+
+void test_no_echo_times_out() {
+  capture.trigger(TRIGGER_PIN);
+  ArduinoHost::advanceMicros(ECHO_TIMEOUT_US - 100);
+  TEST_ASSERT_EQUAL(ECHO_WAITING, capture.poll());
+  ArduinoHost::advanceMicros(100);
+  TEST_ASSERT_EQUAL(ECHO_TIMEOUT, capture.poll());
+  TEST_ASSERT_EQUAL(ECHO_IDLE, capture.poll());
+}
+
+void test_unfinished_echo_times_out() {
+  capture.trigger(TRIGGER_PIN);
+  ArduinoHost::schedule(ArduinoHost::now() + 450, echoHigh, nullptr);
+  ArduinoHost::advanceMicros(ECHO_TIMEOUT_US);
+  TEST_ASSERT_EQUAL(ECHO_TIMEOUT, capture.poll());
+}
+
+void test_edges_outside_a_measurement_are_ignored() {
+  scheduleEcho(100, 1000);
+  ArduinoHost::advanceMicros(2000);
+  TEST_ASSERT_EQUAL(ECHO_IDLE, capture.poll());
+
+  // A falling edge left over from before the trigger is not an echo
+  ArduinoHost::setDigital(ECHO_PIN, HIGH);
+  capture.trigger(TRIGGER_PIN);
+  ArduinoHost::setDigital(ECHO_PIN, LOW);
+  TEST_ASSERT_EQUAL(ECHO_WAITING, capture.poll());
+  scheduleEcho(450, 5800);
+  ArduinoHost::advanceMicros(7000);
+  TEST_ASSERT_EQUAL(ECHO_READY, capture.poll());
+  TEST_ASSERT_EQUAL_UINT32(5800, capture.getEchoWidth());
+}
+
+// An echo rising when micros() reads 0, as at boot or on its wrap; the
+// clock reset stands in for the wrap
+void test_echo_rising_at_micros_zero() {
+  capture.trigger(TRIGGER_PIN);
+  ArduinoHost::reset();
+  capture.begin(ECHO_PIN);
+  scheduleEcho(0, 3000);
+  ArduinoHost::advanceMicros(4000);
+  TEST_ASSERT_EQUAL(ECHO_READY, capture.poll());
+  TEST_ASSERT_EQUAL_UINT32(3000, capture.getEchoWidth());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_width_to_distance);
+  RUN_TEST(test_echo_width_is_timed);
+  RUN_TEST(test_no_echo_times_out);
+  RUN_TEST(test_unfinished_echo_times_out);
+  RUN_TEST(test_edges_outside_a_measurement_are_ignored);
+  RUN_TEST(test_echo_rising_at_micros_zero);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <ArduinoHost.h>
+#include <ParkingSensor.h>
+#include <ParkingStateMachine.h>
+#include <unity.h>
+
+#define ENTER_TIME 5000
+#define EXIT_TIME 2000
+
+// Expected outcome of every (state, event) pair, before and after the
+// confirmation time it waits on, if any
+struct ExpectedRow {
+  ParkingState from;
+  ParkingEvent event;
+  ParkingTimer after;
+  ParkingState early; // before the confirmation time
+  ParkingState late;  // once it has elapsed
+};
+
+static const ExpectedRow EXPECTED[] = {
+    {STATE_FREE, EVENT_NONE, TIMER_NONE, STATE_FREE, STATE_FREE},
+    {STATE_FREE, EVENT_ABSENT, TIMER_NONE, STATE_FREE, STATE_FREE},
+    {STATE_FREE, EVENT_PRESENT, TIMER_NONE, STATE_DETECTING, STATE_DETECTING},
+    {STATE_DETECTING, EVENT_NONE, TIMER_NONE, STATE_DETECTING,
+     STATE_DETECTING},
+    {STATE_DETECTING, EVENT_ABSENT, TIMER_NONE, STATE_FREE, STATE_FREE},
+    {STATE_DETECTING, EVENT_PRESENT, TIMER_ENTER, STATE_DETECTING,
+     STATE_OCCUPIED},
+    {STATE_OCCUPIED, EVENT_NONE, TIMER_NONE, STATE_OCCUPIED, STATE_OCCUPIED},
+    {STATE_OCCUPIED, EVENT_ABSENT, TIMER_NONE, STATE_LEAVING, STATE_LEAVING},
+    {STATE_OCCUPIED, EVENT_PRESENT, TIMER_NONE, STATE_OCCUPIED,
+     STATE_OCCUPIED},
+    {STATE_LEAVING, EVENT_NONE, TIMER_NONE, STATE_LEAVING, STATE_LEAVING},
+    {STATE_LEAVING, EVENT_ABSENT, TIMER_EXIT, STATE_LEAVING, STATE_FREE},
+    {STATE_LEAVING, EVENT_PRESENT, TIMER_NONE, STATE_OCCUPIED,
+     STATE_OCCUPIED},
+};
+
+static const unsigned long ELAPSED[] = {
+    0, 1, EXIT_TIME - 1, EXIT_TIME, ENTER_TIME - 1, ENTER_TIME, 3600000UL};
+
+static ParkingState expectedState(const ExpectedRow &row,
+                                  unsigned long elapsed) {
+  unsigned long wait = row.after == TIMER_ENTER  ? ENTER_TIME
+                       : row.after == TIMER_EXIT ? EXIT_TIME
+                                                 : 0;
+  return elapsed < wait ? row.early : row.late;
+}
+
+static void checkRow(const ExpectedRow &row, unsigned long since) {
+  char message[48];
+  for (unsigned long elapsed : ELAPSED) {
+    ParkingStateMachine machine;
+    machine.setConfirmationTimes(ENTER_TIME, EXIT_TIME);
+    machine.reset(row.from, since);
+
+    ParkingState expected = expectedState(row, elapsed);
+    snprintf(message, sizeof(message), "%d on %d after %lu ms", row.from,
+             row.event, elapsed);
+    bool changed = machine.handle(row.event, since + elapsed);
+    TEST_ASSERT_EQUAL_MESSAGE(expected, machine.getState(), message);
+    TEST_ASSERT_EQUAL_MESSAGE(expected != row.from, changed, message);
+    // Time in the state restarts only on a change
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(changed ? since + elapsed : since,
+                                     machine.getStateSince(), message);
+  }
+}
+
+void setUp() { ArduinoHost::reset(); }
+
+void tearDown() {}
+
+void test_table_covers_every_state_and_event() {
+  TEST_ASSERT_EQUAL(PARKING_STATE_COUNT * 3,
+                    sizeof(EXPECTED) / sizeof(EXPECTED[0]));
+  for (uint8_t state = 0; state < PARKING_STATE_COUNT; state++) {
+    for (uint8_t event = EVENT_NONE; event <= EVENT_PRESENT; event++) {
+      TEST_ASSERT_EQUAL(state, EXPECTED[state * 3 + event].from);
+      TEST_ASSERT_EQUAL(event, EXPECTED[state * 3 + event].event);
+    }
+  }
+}
+
+void test_every_row() {
+  for (const ExpectedRow &row : EXPECTED) {
+    checkRow(row, 1000);
+  }
+}
+
+void test_every_row_across_millis_wrap() {
+  for (const ExpectedRow &row : EXPECTED) {
+    checkRow(row, ~0UL - 1000);
+  }
+}
+
+void test_default_confirmation_times() {
+  ParkingStateMachine machine;
+  machine.reset(STATE_DETECTING, 0);
+  TEST_ASSERT_FALSE(machine.handle(EVENT_PRESENT, PARKING_ENTER_TIME - 1));
+  TEST_ASSERT_TRUE(machine.handle(EVENT_PRESENT, PARKING_ENTER_TIME));
+  TEST_ASSERT_TRUE(machine.handle(EVENT_ABSENT, PARKING_ENTER_TIME));
+  TEST_ASSERT_FALSE(
+      machine.handle(EVENT_ABSENT, PARKING_ENTER_TIME + PARKING_EXIT_TIME - 1));
+  TEST_ASSERT_TRUE(
+      machine.handle(EVENT_ABSENT, PARKING_ENTER_TIME + PARKING_EXIT_TIME));
+  TEST_ASSERT_EQUAL(STATE_FREE, machine.getState());
+}
+
+void test_occupied_states() {
+  ParkingStateMachine machine;
+  machine.reset(STATE_FREE, 0);
+  TEST_ASSERT_FALSE(machine.isOccupied());
+  machine.reset(STATE_DETECTING, 0);
+  TEST_ASSERT_FALSE(machine.isOccupied());
+  machine.reset(STATE_OCCUPIED, 0);
+  TEST_ASSERT_TRUE(machine.isOccupied());
+  machine.reset(STATE_LEAVING, 0);
+  TEST_ASSERT_TRUE(machine.isOccupied());
+}
+
+// Replayed distances, one reading every 150 ms as the controller pings a
+// lone spot
+#define TRACE_PERIOD 150 // ms
+#define TRACE_FLOOR 150  // cm, empty spot
+#define TRACE_CAR 60     // cm, vehicle roof
+
+struct Transition {
+  ParkingState from;
+  ParkingState to;
+  unsigned long time;
+};
+
+static Transition transitions[16];
+static uint8_t transitionCount;
+
+static void recordTransition(uint8_t spot, ParkingState from, ParkingState to,
+                             unsigned long time) {
+  (void)spot;
+  if (transitionCount < 16) {
+    transitions[transitionCount++] = {from, to, time};
+  }
+}
+
+static uint32_t noiseState;
+static int readingCount;
+
+// +-0.3 cm of echo jitter
+static float jitter() {
+  noiseState = noiseState * 1103515245UL + 12345;
+  return ((int)((noiseState >> 16) % 61) - 30) / 100.0;
+}
+
+// Feeds `distance` with jitter for `duration` ms; every `spikeEvery`th
+// reading is a lone echo off the floor instead
+static void replay(ParkingSensor &sensor, float distance,
+                   unsigned long duration, int spikeEvery = 0) {
+  for (unsigned long t = 0; t < duration; t += TRACE_PERIOD) {
+    ArduinoHost::advanceMillis(TRACE_PERIOD);
+    readingCount++;
+    float value = distance + jitter();
+    if (spikeEvery && readingCount % spikeEvery == 0) {
+      value = TRACE_FLOOR;
+    }
+    sensor.addDistance(value, millis());
+  }
+}
+
+void test_replayed_arrival_and_departure() {
+  ChainableLED leds(7, 8, 1);
+  SessionLog sessionLog;
+  ParkingSensor sensor(5);
+  transitionCount = 0;
+  noiseState = 1;
+  readingCount = 0;
+  ArduinoHost::setSerialOutput(false);
+
+  sensor.begin(&leds, 0, &sessionLog);
+  sensor.setConfirmationTimes(ENTER_TIME, EXIT_TIME);
+  sensor.setTransitionHandler(recordTransition);
+
+  replay(sensor, TRACE_FLOOR, 10000);
+  TEST_ASSERT_TRUE(sensor.isCalibrated());
+  TEST_ASSERT_FLOAT_WITHIN(0.3, TRACE_FLOOR, sensor.getBaselineDistance());
+  TEST_ASSERT_EQUAL(0, transitionCount);
+
+  // Someone walks through the beam: seen, never confirmed
+  replay(sensor, TRACE_CAR, 1000);
+  replay(sensor, TRACE_FLOOR, 9000);
+  TEST_ASSERT_EQUAL(2, transitionCount);
+  TEST_ASSERT_EQUAL(STATE_DETECTING, transitions[0].to);
+  TEST_ASSERT_EQUAL(STATE_FREE, transitions[1].to);
+  TEST_ASSERT_EQUAL(0, sessionLog.getCount());
+
+  // A car parks for 30 s with stray floor echoes, and is lost for a moment
+  unsigned long arrival = millis();
+  replay(sensor, TRACE_CAR, 15000, 7);
+  TEST_ASSERT_EQUAL(PARKING_OCCUPIED, sensor.getParkingState());
+  replay(sensor, TRACE_FLOOR, 900);
+  replay(sensor, TRACE_CAR, 14100, 7);
+  unsigned long departure = millis();
+  replay(sensor, TRACE_FLOOR, 10000);
+
+  const ParkingState expected[] = {STATE_DETECTING, STATE_OCCUPIED,
+                                   STATE_LEAVING,   STATE_OCCUPIED,
+                                   STATE_LEAVING,   STATE_FREE};
+  TEST_ASSERT_EQUAL(2 + 6, transitionCount);
+  for (uint8_t i = 0; i < 6; i++) {
+    TEST_ASSERT_EQUAL(expected[i], transitions[2 + i].to);
+  }
+  // Confirmed after the enter and exit times, within a few readings
+  TEST_ASSERT_UINT32_WITHIN(
+      1000, arrival + ENTER_TIME + 500, transitions[3].time);
+  TEST_ASSERT_UINT32_WITHIN(
+      1000, departure + EXIT_TIME + 500, transitions[7].time);
+
+  TEST_ASSERT_EQUAL(PARKING_FREE, sensor.getParkingState());
+  TEST_ASSERT_FLOAT_WITHIN(0.3, TRACE_FLOOR, sensor.getBaselineDistance());
+  TEST_ASSERT_EQUAL(1, sessionLog.getCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_covers_every_state_and_event);
+  RUN_TEST(test_every_row);
+  RUN_TEST(test_every_row_across_millis_wrap);
+  RUN_TEST(test_default_confirmation_times);
+  RUN_TEST(test_occupied_states);
+  RUN_TEST(test_replayed_arrival_and_departure);
+  return UNITY_END();
+}
@@ -0,0 +1,192 @@
+#include <ArduinoHost.h>
+#include <SessionLog.h>
+#include <unity.h>
+
+struct DecodedSession {
+  uint8_t spot;
+  int32_t delta; // s
+  uint32_t duration;
+};
+
+struct DecodedBatch {
+  uint8_t count;
+  uint32_t dropped;
+  DecodedSession sessions[SESSION_LOG_SIZE];
+};
+
+static uint32_t readVarint(const uint8_t *buffer, uint8_t &index) {
+  uint32_t value = 0;
+  for (uint8_t shift = 0;; shift += 7) {
+    uint8_t byte = buffer[index++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+// The back end's side of the batch format
+static uint8_t decode(const uint8_t *buffer, DecodedBatch &batch) {
+  uint8_t index = 0;
+  batch.count = buffer[index++];
+  batch.dropped = readVarint(buffer, index);
+  for (uint8_t i = 0; i < batch.count; i++) {
+    batch.sessions[i].spot = buffer[index++];
+    uint32_t zigzag = readVarint(buffer, index);
+    batch.sessions[i].delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    batch.sessions[i].duration = readVarint(buffer, index);
+  }
+  return index;
+}
+
+static SessionLog sessionLog;
+static uint8_t buffer[64];
+static DecodedBatch batch;
+
+void setUp() { sessionLog = SessionLog(); }
+
+void tearDown() {}
+
+void test_empty_log_builds_nothing() {
+  TEST_ASSERT_EQUAL(0, sessionLog.build(buffer, sizeof(buffer), 1000));
+  sessionLog.add(0, 0, 10);
+  TEST_ASSERT_EQUAL(0, sessionLog.build(buffer, 3, 1000));
+}
+
+void test_batch_encoding() {
+  sessionLog.add(2, 10000, 300);
+  sessionLog.add(5, 20000, 100000);
+  uint8_t length = sessionLog.build(buffer, sizeof(buffer), 400000);
+  TEST_ASSERT_EQUAL(length, decode(buffer, batch));
+  TEST_ASSERT_EQUAL(2, batch.count);
+  TEST_ASSERT_EQUAL_UINT32(0, batch.dropped);
+  TEST_ASSERT_EQUAL(2, batch.sessions[0].spot);
+  TEST_ASSERT_EQUAL_INT32(390, batch.sessions[0].delta);
+  TEST_ASSERT_EQUAL_UINT32(300, batch.sessions[0].duration);
+  TEST_ASSERT_EQUAL(5, batch.sessions[1].spot);
+  // Started after the previous one
+  TEST_ASSERT_EQUAL_INT32(-10, batch.sessions[1].delta);
+  TEST_ASSERT_EQUAL_UINT32(100000, batch.sessions[1].duration);
+}
+
+void test_unsent_batch_is_kept() {
+  sessionLog.add(1, 1000, 60);
+  uint8_t length = sessionLog.build(buffer, sizeof(buffer), 5000);
+  TEST_ASSERT_GREATER_THAN(0, length);
+  TEST_ASSERT_EQUAL(1, sessionLog.getCount());
+
+  sessionLog.commit(false);
+  TEST_ASSERT_EQUAL(1, sessionLog.getCount());
+  uint8_t again[64];
+  TEST_ASSERT_EQUAL(length, sessionLog.build(again, sizeof(again), 5000));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(buffer, again, length);
+
+  sessionLog.commit(true);
+  TEST_ASSERT_EQUAL(0, sessionLog.getCount());
+  // A second commit has nothing left to remove
+  sessionLog.add(1, 6000, 60);
+  sessionLog.commit(true);
+  TEST_ASSERT_EQUAL(1, sessionLog.getCount());
+}
+
+void test_batch_split_by_length() {
+  for (uint8_t i = 0; i < 10; i++) {
+    sessionLog.add(i, 1000 * i, 60);
+  }
+  uint8_t length = sessionLog.build(buffer, 14, 20000);
+  TEST_ASSERT_LESS_OR_EQUAL(14, length);
+  decode(buffer, batch);
+  // 2 bytes of header, then 3 per session
+  TEST_ASSERT_EQUAL(4, batch.count);
+  sessionLog.commit(true);
+  TEST_ASSERT_EQUAL(6, sessionLog.getCount());
+
+  // The rest follows on, from the fifth session
+  sessionLog.build(buffer, sizeof(buffer), 20000);
+  decode(buffer, batch);
+  TEST_ASSERT_EQUAL(6, batch.count);
+  TEST_ASSERT_EQUAL(4, batch.sessions[0].spot);
+  TEST_ASSERT_EQUAL_INT32(16, batch.sessions[0].delta);
+}
+
+void test_dropped_count_cleared_once_sent() {
+  for (uint8_t i = 0; i < SESSION_LOG_SIZE + 3; i++) {
+    sessionLog.add(0, 1000 * i, 1);
+  }
+  TEST_ASSERT_EQUAL(3, sessionLog.getDropped());
+
+  sessionLog.build(buffer, sizeof(buffer), 60000);
+  decode(buffer, batch);
+  TEST_ASSERT_EQUAL_UINT32(3, batch.dropped);
+  sessionLog.commit(false);
+  TEST_ASSERT_EQUAL(3, sessionLog.getDropped());
+
+  sessionLog.build(buffer, 14, 60000);
+  sessionLog.commit(true);
+  TEST_ASSERT_EQUAL(0, sessionLog.getDropped());
+  TEST_ASSERT_EQUAL(SESSION_LOG_SIZE - 4, sessionLog.getCount());
+}
+
+void test_drop_after_build_voids_batch() {
+  for (uint8_t i = 0; i < SESSION_LOG_SIZE; i++) {
+    sessionLog.add(0, 1000 * i, 1);
+  }
+  sessionLog.build(buffer, 14, 60000);
+  // The oldest session, part of the batch, is overwritten
+  sessionLog.add(1, 50000, 1);
+  sessionLog.commit(true);
+  TEST_ASSERT_EQUAL(SESSION_LOG_SIZE, sessionLog.getCount());
+  TEST_ASSERT_EQUAL(1, sessionLog.getDropped());
+}
+
+void test_start_deltas_across_millis_wrap() {
+  sessionLog.add(0, 0xFFFFF000UL, 30);
+  sessionLog.add(1, 2000, 10);
+  sessionLog.build(buffer, sizeof(buffer), 12000);
+  decode(buffer, batch);
+  // 4096 ms before the rollover, then 2 s after it
+  TEST_ASSERT_EQUAL_INT32(16, batch.sessions[0].delta);
+  TEST_ASSERT_EQUAL_INT32(-6, batch.sessions[1].delta);
+}
+
+// A node that could not send for weeks still reports the right starts
+void test_start_deltas_past_24_days() {
+  const uint32_t day = 86400000UL;
+  sessionLog.add(0, 1000, 3600);
+  sessionLog.add(1, 30 * day, 60);
+  sessionLog.build(buffer, sizeof(buffer), 40 * day + 1000);
+  decode(buffer, batch);
+  TEST_ASSERT_EQUAL_INT32(40 * 86400, batch.sessions[0].delta);
+  TEST_ASSERT_EQUAL_INT32(-30 * 86400 + 1, batch.sessions[1].delta);
+}
+
+// Whole-second rounding must not accumulate along a batch
+void test_rebuilt_starts_do_not_drift() {
+  const unsigned long now = 1000000;
+  for (uint8_t i = 0; i < 12; i++) {
+    sessionLog.add(i, 1999 + 10999UL * i, 1);
+  }
+  sessionLog.build(buffer, sizeof(buffer), now);
+  decode(buffer, batch);
+  TEST_ASSERT_EQUAL(12, batch.count);
+
+  int32_t age = 0;
+  for (uint8_t i = 0; i < batch.count; i++) {
+    age += batch.sessions[i].delta;
+    TEST_ASSERT_EQUAL_INT32((now - (1999 + 10999UL * i)) / 1000, age);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log_builds_nothing);
+  RUN_TEST(test_batch_encoding);
+  RUN_TEST(test_unsent_batch_is_kept);
+  RUN_TEST(test_batch_split_by_length);
+  RUN_TEST(test_dropped_count_cleared_once_sent);
+  RUN_TEST(test_drop_after_build_voids_batch);
+  RUN_TEST(test_start_deltas_across_millis_wrap);
+  RUN_TEST(test_start_deltas_past_24_days);
+  RUN_TEST(test_rebuilt_starts_do_not_drift);
+  return UNITY_END();
+}
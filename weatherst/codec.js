@@ -1,3 +1,72 @@
+// Loop profile (fPort 9, firmware built with -DLOOP_PROFILER): loops per
+// sample, profiler overhead (0.01 %), then 6 bytes per stage: id, count,
+// p50 and p95 log2 buckets as two nibbles, max (16 us units)
+const PROFILE_STAGES = ["loop", "modem", "console", "dht", "hp20x", "uplink"];
+
+function profileBucketLimit(bucket) {
+  // Exclusive upper bound in us; the last bucket is open-ended
+  return bucket < 15 ? Math.pow(2, bucket + 4) : null;
+}
+
+function decodeProfile(bytes) {
+  const profile = {
+    sampleRate: bytes[0],
+    overheadPercent: ((bytes[1] << 8) | bytes[2]) / 100,
+    stages: {},
+  };
+  for (let i = 3; i + 6 <= bytes.length; i += 6) {
+    const name = PROFILE_STAGES[bytes[i]] || "stage" + bytes[i];
+    profile.stages[name] = {
+      count: (bytes[i + 1] << 8) | bytes[i + 2],
+      p50BelowMicros: profileBucketLimit(bytes[i + 3] >> 4),
+      p95BelowMicros: profileBucketLimit(bytes[i + 3] & 0x0f),
+      maxMicros: ((bytes[i + 4] << 8) | bytes[i + 5]) * 16,
+    };
+  }
+  return profile;
+}
+
+// Memory report (fPort 10): heap max, stack max, minimum and current free
+// RAM (2 bytes each, in bytes), flags (bit 0: stack and heap have met)
+function decodeMemory(bytes) {
+  return {
+    heapMaxBytes: (bytes[0] << 8) | bytes[1],
+    stackMaxBytes: (bytes[2] << 8) | bytes[3],
+    freeMinBytes: (bytes[4] << 8) | bytes[5],
+    freeNowBytes: (bytes[6] << 8) | bytes[7],
+    collision: Boolean(bytes[8] & 0x01),
+  };
+}
+
+// Window summary (fPort 4, site setting summary=1): readings since the
+// previous uplink, then min, max, mean and standard deviation of each
+// measure as signed 2-byte values, then the alert mask
+const SUMMARY_FIELDS = [
+  ["temperature", 100],
+  ["humidity", 10],
+  ["pressure", 10],
+];
+
+function readInt16(bytes, index) {
+  const raw = (bytes[index] << 8) | bytes[index + 1];
+  return raw & 0x8000 ? raw - 0x10000 : raw;
+}
+
+function decodeSummary(bytes) {
+  const summary = { samples: (bytes[0] << 8) | bytes[1] };
+  SUMMARY_FIELDS.forEach(([name, scale], i) => {
+    const index = 2 + i * 8;
+    summary[name] = {
+      min: readInt16(bytes, index) / scale,
+      max: readInt16(bytes, index + 2) / scale,
+      mean: readInt16(bytes, index + 4) / scale,
+      stdDev: readInt16(bytes, index + 6) / scale,
+    };
+  });
+  summary.alertMask = bytes[26];
+  return summary;
+}
+
 function decodeUplink(input) {
   const bytes = input.bytes;
   const port = input.fPort;
@@ -8,6 +77,33 @@ function decodeUplink(input) {
     errors: [],
   };
 
+  if (port === 10) {
+    if (bytes.length < 9) {
+      response.errors.push("Not enough bytes in payload");
+    } else {
+      response.data = decodeMemory(bytes);
+    }
+    return response;
+  }
+
+  if (port === 4) {
+    if (bytes.length < 27) {
+      response.errors.push("Not enough bytes in payload");
+    } else {
+      response.data = decodeSummary(bytes);
+    }
+    return response;
+  }
+
+  if (port === 9) {
+    if (bytes.length < 3) {
+      response.errors.push("Not enough bytes in payload");
+    } else {
+      response.data = decodeProfile(bytes);
+    }
+    return response;
+  }
+
   if (bytes.length < 17) {
     response.errors.push("Not enough bytes in payload");
     return response;
@@ -35,26 +131,35 @@ function decodeUplink(input) {
     response.data.humidity = bytesToFloat(bytes, 8);
     response.data.altitude = bytesToFloat(bytes, 12);
 
-    // Décode l'état d'alerte
-    const alertState = bytes[16];
-    response.data.alertState = alertState;
+    // Décode l'état d'alerte (masque de bits : 0x01 température,
+    // 0x02 humidité, 0x04 pression)
+    const alertMask = bytes[16];
+    response.data.alertMask = alertMask;
+    response.data.alertTemperature = Boolean(alertMask & 0x01);
+    response.data.alertHumidity = Boolean(alertMask & 0x02);
+    response.data.alertPressure = Boolean(alertMask & 0x04);
 
-    // Interprétation de l'état d'alerte
-    switch (alertState) {
+    // Code d'alerte historique attendu par les tableaux de bord
+    switch (alertMask) {
+      case 0x00:
+        response.data.alertState = 0x00;
+        response.data.alertMessage = "No Alert";
+        break;
       case 0x01:
+        response.data.alertState = 0x01;
         response.data.alertMessage = "Temperature Alert";
         break;
       case 0x02:
+        response.data.alertState = 0x02;
         response.data.alertMessage = "Humidity Alert";
         break;
-      case 0x03:
+      case 0x04:
+        response.data.alertState = 0x03;
         response.data.alertMessage = "Pressure Alert";
         break;
-      case 0x06:
-        response.data.alertMessage = "Multiple Alerts";
-        break;
       default:
-        response.data.alertMessage = "No Alert";
+        response.data.alertState = 0x06;
+        response.data.alertMessage = "Multiple Alerts";
     }
   } catch (error) {
     response.errors.push("Decoding failed: " + error.message);
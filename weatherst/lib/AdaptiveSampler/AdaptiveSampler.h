@@ -0,0 +1,55 @@
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+#include <Arduino.h>
+
+#define SAMPLER_MAX_CHANNELS 4
+// Share of the gap to a lower rate closed per sample: a rise is followed at
+// once, a fall over a few samples
+#define SAMPLER_DECAY 0.25
+
+// Change-driven sampling interval for a group of slowly varying signals.
+// Each channel tracks how fast its value moves, in steps per ms, where a
+// step is the smallest change worth a sample for that channel. The interval
+// is the time the fastest channel takes to move by one step, clamped to
+// [minInterval, maxInterval]: a steady group is sampled at the ceiling, and
+// the first sample that has moved by several steps brings the rate back
+// toward the floor. A change is therefore noticed within one ceiling.
+class AdaptiveSampler {
+private:
+  const float *steps;
+  uint8_t channelCount;
+  float lastValues[SAMPLER_MAX_CHANNELS];
+  float rates[SAMPLER_MAX_CHANNELS]; // steps per ms
+
+  unsigned long minInterval;
+  unsigned long maxInterval;
+  unsigned long interval;
+
+  unsigned long startTime;
+  unsigned long lastSample;
+  unsigned long sampleCount;
+
+public:
+  // steps holds one entry per channel, in the channel's unit; it is not
+  // copied
+  AdaptiveSampler(const float *steps, uint8_t channelCount,
+                  unsigned long minInterval, unsigned long maxInterval);
+  void configure(unsigned long minInterval, unsigned long maxInterval);
+  void start(unsigned long now);
+
+  bool isDue(unsigned long now);
+  // ms left before isDue(), 0 if already due
+  unsigned long getTimeUntilDue(unsigned long now);
+  // Records a sample, one value per channel; NaN leaves a channel's rate
+  void sampled(const float *values, unsigned long now);
+  // Takes the next sample at the floor, whatever the rates
+  void holdFloor() { interval = minInterval; }
+
+  unsigned long getInterval() { return interval; }
+  unsigned long getSampleCount() { return sampleCount; }
+  // Samples taken over samples at the floor rate
+  float getDutyRatio(unsigned long now);
+};
+
+#endif // ADAPTIVE_SAMPLER_H
@@ -0,0 +1,76 @@
+#include "AlertEngine.h"
+
+AlertEngine::AlertEngine(const AlertRule *rules, uint8_t ruleCount) {
+  this->rules = rules;
+  this->ruleCount = ruleCount > ALERT_MAX_RULES ? ALERT_MAX_RULES : ruleCount;
+  for (uint8_t i = 0; i < this->ruleCount; i++) {
+    thresholds[i] = rules[i].threshold;
+  }
+  reset();
+}
+
+void AlertEngine::setThreshold(uint8_t field, AlertValue threshold) {
+  for (uint8_t i = 0; i < ruleCount; i++) {
+    if (rules[i].field == field) {
+      thresholds[i] = threshold;
+    }
+  }
+}
+
+void AlertEngine::reset() {
+  alertState = 0;
+  raised = 0;
+  pending = 0;
+}
+
+void AlertEngine::restoreRaised(uint8_t raised) {
+  reset();
+  for (uint8_t i = 0; i < ruleCount; i++) {
+    if (raised & (1 << i)) {
+      this->raised |= 1 << i;
+      alertState |= rules[i].mask;
+    }
+  }
+}
+
+uint8_t AlertEngine::evaluate(const AlertValue *values,
+                              unsigned long now) {
+  uint8_t state = 0;
+
+  for (uint8_t i = 0; i < ruleCount; i++) {
+    const AlertRule &rule = rules[i];
+    const uint8_t bit = 1 << i;
+    const bool isRaised = raised & bit;
+    const AlertValue value = values[rule.field];
+    const AlertValue threshold = thresholds[i];
+
+    // While raised, the clear point is moved back by the hysteresis band.
+    // NaN compares false and therefore never raises an alert.
+    bool active;
+    if (rule.compare == ALERT_ABOVE) {
+      active = value > (isRaised ? threshold - rule.hysteresis : threshold);
+    } else {
+      active = value < (isRaised ? threshold + rule.hysteresis : threshold);
+    }
+
+    if (active == isRaised) {
+      pending &= ~bit;
+    } else {
+      if (!(pending & bit)) {
+        pending |= bit;
+        pendingSince[i] = now;
+      }
+      if (now - pendingSince[i] >= rule.holdTime) {
+        raised ^= bit;
+        pending &= ~bit;
+      }
+    }
+
+    if (raised & bit) {
+      state |= rule.mask;
+    }
+  }
+
+  alertState = state;
+  return alertState;
+}
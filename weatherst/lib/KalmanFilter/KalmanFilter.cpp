@@ -32,6 +32,18 @@ float Rand_Table[100] = {
     -1.7947
 };
 
+/* the same table in Q10, kept in flash */
+const int16_t Rand_Table_Q10[100] PROGMEM = {
+    551, 1878, -2313, 883, 326, -1339, -444, 350, 3664, 2836, -1382, 3108, 743,
+    -65, 732, -210, -127, 1525, 1443, 1451, 688, -1236, 734, 1669, 501, 1060,
+    744, -311, 301, -806, 910, -1175, -1095, -829, -3015, 1473, 333, -773, 1403,
+    -1753, -105, -247, 327, 320, -886, -31, -169, 643, 1120, 1136, -884, 79,
+    -1243, -1140, -7, 1569, -788, 380, -231, 1144, -1115, 33, 566, 1127, 1581,
+    88, -1527, -760, -1087, 2407, -630, 766, -197, 910, -783, -1436, -1457, 500,
+    -182, -201, 1453, 299, 203, 1626, -824, 713, 855, -250, 221, -1194, -1176,
+    107, 740, 2648, -683, 192, -84, -1979, -450, -1838
+};
+
 /* Extern variables */
 KalmanFilter kalmanFilter;
 
@@ -88,3 +100,35 @@ float KalmanFilter::Filter(float origin) {
 
     return X_post;
 }
+
+Q16_16 KalmanFilterFixed::Gaussian_Noise_Cov(void) {
+    int32_t sum = 0;
+    int32_t sumSquares = 0;
+    /* Initialize random number generator */
+    srand((int)analogRead(0));
+
+    /* Get random number, in the order KalmanFilter draws them */
+    for (int i = 0; i < 10; i++) {
+        int16_t sample = pgm_read_word(&Rand_Table_Q10[(int)rand() % 100]);
+        sum += sample;
+        sumSquares += (int32_t)sample * sample;
+    }
+
+    /* Variance = (10 * sum(x^2) - sum(x)^2) / 100, from Q20 to Q16 */
+    return Q16_16::fromRaw((10 * sumSquares - sum * sum) / 1600);
+}
+
+Q16_16 KalmanFilterFixed::Filter(Q16_16 origin) {
+    /* Get model and observe Noise */
+    Q16_16 modelNoise = Gaussian_Noise_Cov();
+    Q16_16 observeNoise = Gaussian_Noise_Cov();
+
+    /* Algorithm */
+    X_pre = X_post;
+    P_pre = P_post + modelNoise;
+    K_cur = P_pre / (P_pre + observeNoise);
+    P_post = (Q16_16::fromInt(1) - K_cur) * P_pre;
+    X_post = X_pre + K_cur * (origin - X_pre);
+
+    return X_post;
+}
@@ -13,6 +13,7 @@
 /***        Include files                                                 ***/
 /****************************************************************************/
 #include <Arduino.h>
+#include <FixedPoint.h>
 #include <inttypes.h>
 /****************************************************************************/
 /***        Local variables                                               ***/
@@ -26,11 +27,35 @@ class KalmanFilter {
   public:
     KalmanFilter();
     float Filter(float);
+    /* Estimate and covariance, kept across a warm restart */
+    float getEstimate() { return X_post; }
+    float getCovariance() { return P_post; }
+    void setState(float estimate, float covariance) {
+        X_post = estimate;
+        P_post = covariance;
+    }
   private:
     /* variables */
     float X_pre, X_post, P_pre, P_post, K_cur;
     float Gaussian_Noise_Cov(void);
 
+};
+
+/* Same filter in Q16.16, drawing the same noise samples as KalmanFilter */
+class KalmanFilterFixed {
+  public:
+    Q16_16 Filter(Q16_16);
+    Q16_16 getEstimate() { return X_post; }
+    Q16_16 getCovariance() { return P_post; }
+    void setState(Q16_16 estimate, Q16_16 covariance) {
+        X_post = estimate;
+        P_post = covariance;
+    }
+  private:
+    /* variables */
+    Q16_16 X_pre, X_post, P_pre, P_post, K_cur;
+    Q16_16 Gaussian_Noise_Cov(void);
+
 };
 extern KalmanFilter kalmanFilter;
 #endif
\ No newline at end of file
@@ -1,25 +1,29 @@
 #include "LoRaManager.h"
+#include "LoopProfiler.h"
 
-LoRaManager::LoRaManager(byte rxPin, byte txPin) {
-  loraSerial = new SoftwareSerial(rxPin, txPin);
+LoRaManager::LoRaManager(byte rxPin, byte txPin) : loraSerial(rxPin, txPin) {
   previousTTN = millis();
   uplinkInterval = 10000;
   receiveCallback = false;
   getDataStatus = false;
   networkJoinedStatus = false;
+  modemSleepEnabled = false;
+  modemAsleep = false;
+  lastModemActivity = 0;
 
-  inputString.reserve(200);
-  stringComplete = false;
+  consoleIndex = 0;
   rxbuff_index = 0;
+  commandHandler = nullptr;
 }
 
 void LoRaManager::begin() {
-  loraSerial->begin(9600);
-  loraSerial->println("ATZ");
+  loraSerial.begin(9600);
+  loraSerial.println(F("ATZ"));
 }
 
 void LoRaManager::handleLoRaMessages() {
-  loraSerial->listen();
+  PROFILE_SCOPE(PROFILE_STAGE_MODEM);
+  loraSerial.listen();
 
   unsigned long currentTime = millis();
   if ((currentTime - previousTTN >= uplinkInterval) &&
@@ -36,80 +40,98 @@ void LoRaManager::handleLoRaMessages() {
     getDataStatus = true;
     delay(1000);
 
-    loraSerial->println("AT+CFG");
+    wakeModem();
+    loraSerial.println(F("AT+CFG"));
   }
 
   processLoRaData();
+
+  // Not needed again before the next uplink
+  if (modemSleepEnabled && !modemAsleep && networkJoinedStatus &&
+      !receiveCallback && millis() - lastModemActivity >= LA66_SLEEP_DELAY) {
+    loraSerial.println(F(LA66_SLEEP_COMMAND));
+    modemAsleep = true;
+  }
+}
+
+void LoRaManager::wakeModem() {
+  if (modemAsleep) {
+    loraSerial.println();
+    delay(LA66_WAKE_TIME);
+    modemAsleep = false;
+  }
+  lastModemActivity = millis();
 }
 
 void LoRaManager::processLoRaData() {
-  while (loraSerial->available()) {
-    char inChar = (char)loraSerial->read();
-    inputString += inChar;
+  while (loraSerial.available()) {
+    char inChar = (char)loraSerial.read();
+    lastModemActivity = millis();
 
+    // A line longer than the buffer is dropped
+    if (rxbuff_index >= sizeof(rxbuff) - 1) {
+      rxbuff_index = 0;
+    }
     rxbuff[rxbuff_index++] = inChar;
 
-    if (rxbuff_index > 128)
-      break;
-
     if (inChar == '\n' || inChar == '\r') {
-      stringComplete = true;
       rxbuff[rxbuff_index] = '\0';
+      rxbuff_index = 0;
+      // Modem lines are echoed, except the downlink exchange
+      bool echo = !getDataStatus;
 
       if (strncmp(rxbuff, "JOINED", 6) == 0) {
         networkJoinedStatus = true;
-        Serial.println("Network joined!");
+        Serial.println(F("Network joined!"));
       }
 
       if (strncmp(rxbuff, "Dragino LA66 Device", 19) == 0) {
         networkJoinedStatus = false;
-        Serial.println("Network connection reset");
+        modemAsleep = false;
+        Serial.println(F("Network connection reset"));
       }
 
       if (strncmp(rxbuff, "Run AT+RECVB=? to see detail", 28) == 0) {
         receiveCallback = true;
-        stringComplete = false;
-        inputString = "\0";
+        echo = false;
       }
 
       if (strncmp(rxbuff, "AT+RECVB=", 9) == 0) {
-        stringComplete = false;
-        inputString = "\0";
-        Serial.print("\r\nGet downlink data(FPort & Payload) ");
+        echo = false;
+        Serial.print(F("\r\nGet downlink data(FPort & Payload) "));
         Serial.println(&rxbuff[9]);
       }
 
-      rxbuff_index = 0;
-
-      if (getDataStatus == true) {
-        stringComplete = false;
-        inputString = "\0";
+      if (echo) {
+        Serial.print(rxbuff);
       }
     }
   }
-
-  if (stringComplete) {
-    Serial.print(inputString);
-
-    inputString = "\0";
-    stringComplete = false;
-  }
 }
 
 void LoRaManager::sendWeatherData(float temperature, float pressure,
                                   float humidity, float altitude,
                                   uint8_t alertState) {
   if (!networkJoinedStatus) {
-    Serial.println("Network not joined, cannot send data");
+    Serial.println(F("Network not joined, cannot send data"));
     return;
   }
 
   Serial.println(F("\n===== SENDING WEATHER DATA ====="));
-  Serial.println("Temp: " + String(temperature) + "°C");
-  Serial.println("Pressure: " + String(pressure) + "hPa");
-  Serial.println("Humidity: " + String(humidity) + "%");
-  Serial.println("Altitude: " + String(altitude) + "m");
-  Serial.println("Alert State: " + String(alertState));
+  Serial.print(F("Temp: "));
+  Serial.print(temperature);
+  Serial.println(F("°C"));
+  Serial.print(F("Pressure: "));
+  Serial.print(pressure);
+  Serial.println(F("hPa"));
+  Serial.print(F("Humidity: "));
+  Serial.print(humidity);
+  Serial.println(F("%"));
+  Serial.print(F("Altitude: "));
+  Serial.print(altitude);
+  Serial.println(F("m"));
+  Serial.print(F("Alert State: "));
+  Serial.println(alertState);
 
   uint8_t payload[17];
 
@@ -147,31 +169,71 @@ void LoRaManager::sendWeatherData(float temperature, float pressure,
   Serial.print(F("Raw payload: "));
   for (int i = 0; i < 17; i++) {
     Serial.print(payload[i], HEX);
-    Serial.print(" ");
+    Serial.print(' ');
   }
   Serial.println();
 
-  char hexPayload[35] = {0};
-  for (int i = 0; i < 17; i++) {
-    sprintf(&hexPayload[i * 2], "%02X", payload[i]);
+  Serial.print(F("Sending command: "));
+  printSendCommand(Serial, 2, payload, 17);
+  wakeModem();
+  printSendCommand(loraSerial, 2, payload, 17);
+}
+
+bool LoRaManager::sendPayload(uint8_t port, const uint8_t *payload,
+                              uint8_t length) {
+  if (!networkJoinedStatus) {
+    Serial.println(F("Network not joined, cannot send data"));
+    return false;
   }
 
-  char sensor_data_buff[128] = {0};
-  sprintf(sensor_data_buff, "AT+SENDB=%d,%d,%d,%s", 1, 2, 17, hexPayload);
+  Serial.println(F("===== SEND DATA TO TTN"));
+
+  Serial.print(F("Raw payload: "));
+  for (int i = 0; i < length; i++) {
+    Serial.print(payload[i], HEX);
+    Serial.print(' ');
+  }
+  Serial.println();
 
-  Serial.println("Sending command: " + String(sensor_data_buff));
-  loraSerial->println(sensor_data_buff);
+  wakeModem();
+  printSendCommand(loraSerial, port, payload, length);
+  return true;
+}
+
+void LoRaManager::printSendCommand(Print &out, uint8_t port,
+                                   const uint8_t *payload, uint8_t length) {
+  // Streamed rather than formatted into a buffer first
+  out.print(F("AT+SENDB=1,"));
+  out.print(port);
+  out.print(',');
+  out.print(length);
+  out.print(',');
+  for (uint8_t i = 0; i < length; i++) {
+    out.print(payload[i] >> 4, HEX);
+    out.print(payload[i] & 0x0F, HEX);
+  }
+  out.println();
 }
 
 bool LoRaManager::isNetworkJoined() { return networkJoinedStatus; }
 
 void LoRaManager::processSerialCommands() {
+  PROFILE_SCOPE(PROFILE_STAGE_CONSOLE);
   while (Serial.available()) {
     char inChar = (char)Serial.read();
-    inputString += inChar;
-    if (inChar == '\n' || inChar == '\r') {
-      loraSerial->print(inputString);
-      inputString = "\0";
+    bool endOfLine = inChar == '\n' || inChar == '\r';
+
+    // Long lines are cut, keeping room for the line end
+    if (consoleIndex < sizeof(consoleLine) - 2 || endOfLine) {
+      consoleLine[consoleIndex++] = inChar;
+    }
+    if (endOfLine) {
+      consoleLine[consoleIndex] = '\0';
+      consoleIndex = 0;
+      if (!commandHandler || !commandHandler(consoleLine)) {
+        wakeModem();
+        loraSerial.print(consoleLine);
+      }
     }
   }
-}
\ No newline at end of file
+}
@@ -4,22 +4,50 @@
 #include <Arduino.h>
 #include <SoftwareSerial.h>
 
+#define CONSOLE_LINE_SIZE 64
+
+// Modem sleep between uplinks; the LA66 wakes on its next UART byte, which
+// it drops
+#define LA66_SLEEP_COMMAND "AT+SLEEP=1"
+#define LA66_SLEEP_DELAY 3000 // ms of modem silence first, past both RX windows
+#define LA66_WAKE_TIME 10     // ms
+// Longest stretch the node may leave an awake modem unread: SoftwareSerial's
+// 64-byte buffer fills in 66 ms at 9600 baud
+#define LA66_POLL_INTERVAL 50
+
+#define SUMMARY_PORT 4 // window statistics, instead of the data frame
+#define PROFILE_PORT 9
+#define MEMORY_PORT 10
+
+// Console line handler; returns true if it consumed the line, which is then
+// not forwarded to the modem
+typedef bool (*ConsoleCommandHandler)(const char *line);
+
 class LoRaManager {
 private:
-  SoftwareSerial *loraSerial;
+  SoftwareSerial loraSerial;
   long previousTTN;
   unsigned long uplinkInterval;
   bool receiveCallback;
   bool getDataStatus;
   bool networkJoinedStatus;
+  bool modemSleepEnabled;
+  bool modemAsleep;
+  unsigned long lastModemActivity;
 
-  String inputString;
-  bool stringComplete;
+  char consoleLine[CONSOLE_LINE_SIZE];
+  uint8_t consoleIndex;
 
   char rxbuff[128];
   uint8_t rxbuff_index;
 
+  ConsoleCommandHandler commandHandler;
+
   void processLoRaData();
+  void wakeModem();
+  // AT+SENDB=1,<port>,<length>,<hex payload>
+  void printSendCommand(Print &out, uint8_t port, const uint8_t *payload,
+                        uint8_t length);
 
 public:
   LoRaManager(byte rxPin, byte txPin);
@@ -27,8 +55,17 @@ public:
   void handleLoRaMessages();
   void sendWeatherData(float temperature, float pressure, float humidity,
                        float altitude, uint8_t alertState);
+  // Returns false, sending nothing, while the network is not joined
+  bool sendPayload(uint8_t port, const uint8_t *payload, uint8_t length);
   bool isNetworkJoined();
+  // Puts the modem to sleep once joined and quiet; it is woken for each
+  // uplink or console command
+  void setModemSleep(bool enabled) { modemSleepEnabled = enabled; }
+  bool isModemAsleep() { return modemAsleep; }
   void processSerialCommands();
+  void setCommandHandler(ConsoleCommandHandler handler) {
+    commandHandler = handler;
+  }
 };
 
 #endif // LORA_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef PROFILE_STAGES_H
+#define PROFILE_STAGES_H
+
+#include <Arduino.h>
+
+// Stage ids are sent in the diagnostic uplink; keep codec.js in step
+enum ProfileStageId : uint8_t {
+  PROFILE_STAGE_LOOP,    // loop() without the trailing delay
+  PROFILE_STAGE_MODEM,   // LA66 line parsing
+  PROFILE_STAGE_CONSOLE, // serial console commands
+  PROFILE_STAGE_DHT,     // DHT11 temperature and humidity
+  PROFILE_STAGE_HP20X,   // HP206C pressure, temperature, altitude
+  PROFILE_STAGE_UPLINK,  // payload, console printing and AT+SENDB
+  PROFILE_STAGE_COUNT
+};
+
+static inline const __FlashStringHelper *profileStageName(uint8_t stage) {
+  switch (stage) {
+  case PROFILE_STAGE_LOOP:
+    return F("loop");
+  case PROFILE_STAGE_MODEM:
+    return F("modem");
+  case PROFILE_STAGE_CONSOLE:
+    return F("console");
+  case PROFILE_STAGE_DHT:
+    return F("dht");
+  case PROFILE_STAGE_HP20X:
+    return F("hp20x");
+  case PROFILE_STAGE_UPLINK:
+    return F("uplink");
+  default:
+    return F("?");
+  }
+}
+
+#endif // PROFILE_STAGES_H
@@ -0,0 +1,41 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+
+#define MEMORY_CANARY 0xC5
+#define MEMORY_SAMPLE_INTERVAL 1000 // ms between two scans of the painted gap
+#define MEMORY_REPORT_SIZE 9
+
+// RAM watermarks on the ATmega328P. The free RAM between the heap and the
+// stack is painted with MEMORY_CANARY before main(); the stack's deepest
+// point is the first painted byte it overwrote, so the smallest gap ever
+// left is known even if it happened between two samples. The heap top is
+// sampled. On other targets every figure reads 0.
+class MemoryMonitor {
+private:
+  uint16_t heapMax;  // bytes, highest heap top seen
+  uint16_t stackMax; // bytes, deepest stack seen
+  uint16_t freeMin;  // bytes never touched by either side, 0xFFFF unsampled
+  unsigned long lastSample;
+
+public:
+  MemoryMonitor();
+  // Rescans at most once per MEMORY_SAMPLE_INTERVAL; call it from loop()
+  void update(unsigned long now);
+  void sample();
+
+  static uint16_t getFreeNow();
+  uint16_t getFreeMin() { return freeMin == 0xFFFF ? 0 : freeMin; }
+  uint16_t getHeapMax() { return heapMax; }
+  uint16_t getStackMax() { return stackMax; }
+  // The stack reached the heap, or the heap the stack
+  bool isCollided() { return freeMin == 0; }
+
+  void dump(Print &out);
+  // Heap max, stack max, free min, free now (2 bytes each), then flags
+  // (bit 0: collision)
+  uint8_t buildReport(uint8_t *payload);
+};
+
+#endif // MEMORY_MONITOR_H
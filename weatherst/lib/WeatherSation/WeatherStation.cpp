@@ -1,32 +1,92 @@
 #include "WeatherStation.h"
+#include <LoopProfiler.h>
+#include <SensorTrace.h>
+
+constexpr AlertRule WEATHER_ALERT_RULES[] = {
+    {FIELD_TEMPERATURE, ALERT_ABOVE, ALERT_VALUE(TEMP_THRESHOLD),
+     ALERT_VALUE(TEMP_HYSTERESIS), ALERT_HOLD_TIME, TEMP_ALERT},
+    {FIELD_HUMIDITY, ALERT_ABOVE, ALERT_VALUE(HUMI_THRESHOLD),
+     ALERT_VALUE(HUMI_HYSTERESIS), ALERT_HOLD_TIME, HUMI_ALERT},
+    {FIELD_PRESSURE, ALERT_BELOW, ALERT_VALUE(PRES_THRESHOLD),
+     ALERT_VALUE(PRES_HYSTERESIS), ALERT_HOLD_TIME, PRES_ALERT},
+};
+
+// Indexed by WeatherField
+constexpr float WEATHER_SAMPLE_STEPS[] = {TEMP_SAMPLE_STEP, HUMI_SAMPLE_STEP,
+                                          PRES_SAMPLE_STEP};
+// Units of the summary frame, indexed by WeatherField
+constexpr float WEATHER_SUMMARY_SCALES[] = {100, 10, 10};
+
+// Big-endian, as in the diagnostic reports
+static uint8_t putScaled(uint8_t *payload, float value, float scale) {
+  int16_t scaled = (int16_t)round(value * scale);
+  payload[0] = scaled >> 8;
+  payload[1] = scaled & 0xFF;
+  return 2;
+}
 
 void WeatherStation::dht_init() { this->dht.begin(); }
 
 void WeatherStation::hp20x_init() { this->hp20x.begin(); }
 
 void WeatherStation::dht_read() {
+  PROFILE_SCOPE(PROFILE_STAGE_DHT);
   float newTemp = dht.readTemperature();
   if (!isnan(newTemp)) {
-    this->dht_temperature = newTemp;
+    this->dht_temperature =
+        MEASURE(rejectOutlier(dhtTemperatureFilter, newTemp));
   }
 
   float newHumidity = dht.readHumidity();
   if (!isnan(newHumidity)) {
-    this->humidity = newHumidity;
+    this->humidity = MEASURE(rejectOutlier(dhtHumidityFilter, newHumidity));
   }
+
+  SENSOR_TRACE_BEGIN("dht");
+  SENSOR_TRACE_FIELD(newTemp);
+  SENSOR_TRACE_FIELD(newHumidity);
+  SENSOR_TRACE_END();
 }
 
 void WeatherStation::hp20x_read() {
+  PROFILE_SCOPE(PROFILE_STAGE_HP20X);
   this->hp20x_pressure = hp20x.ReadPressure();
   this->hp20x_temperature = hp20x.ReadTemperature();
-  this->altitude = hp20x.ReadAltitude();
+  this->hp20x_altitude = hp20x.ReadAltitude();
+
+  // Raw 24-bit readings, sign-extended by the driver
+  SENSOR_TRACE_BEGIN("hp206c");
+  SENSOR_TRACE_FIELD(hp20x_pressure);
+  SENSOR_TRACE_FIELD(hp20x_temperature);
+  SENSOR_TRACE_FIELD(hp20x_altitude);
+  SENSOR_TRACE_END();
+
+  // After the trace, so a replay sees the short reads too
+  hp20x_pressure = rejectOutlier(hp20xPressureFilter, hp20x_pressure);
+  hp20x_temperature = rejectOutlier(hp20xTemperatureFilter, hp20x_temperature);
+  hp20x_altitude = rejectOutlier(hp20xAltitudeFilter, hp20x_altitude);
 }
 
-WeatherStation::WeatherStation(byte dht_pin) : dht(dht_pin, DHTTYPE), hp20x() {
-  this->temperature = 0;
-  this->humidity = 0;
-  this->pressure = 0;
-  this->altitude = 0;
+WeatherStation::WeatherStation(byte dht_pin)
+    : dht(dht_pin, DHTTYPE), hp20x(),
+      dhtTemperatureFilter(OUTLIER_SCALE, DHT_TEMP_OUTLIER),
+      dhtHumidityFilter(OUTLIER_SCALE, DHT_HUMI_OUTLIER),
+      hp20xTemperatureFilter(OUTLIER_SCALE, HP20X_TEMP_OUTLIER),
+      hp20xPressureFilter(OUTLIER_SCALE, HP20X_PRES_OUTLIER),
+      hp20xAltitudeFilter(OUTLIER_SCALE, HP20X_ALTI_OUTLIER),
+      alerts(WEATHER_ALERT_RULES,
+             sizeof(WEATHER_ALERT_RULES) / sizeof(WEATHER_ALERT_RULES[0])),
+      sampler(WEATHER_SAMPLE_STEPS, WEATHER_FIELD_COUNT, SAMPLE_MIN_INTERVAL,
+              SAMPLE_MAX_INTERVAL) {
+  this->temperature = MEASURE(0);
+  this->dht_temperature = MEASURE(0);
+  this->humidity = MEASURE(0);
+  this->pressure = MEASURE(0);
+  this->altitude = MEASURE(0);
+  this->hp20x_temperature = 0;
+  this->hp20x_pressure = 0;
+  this->hp20x_altitude = 0;
+  this->outlierCount = 0;
   this->alertState = 0;
 }
 
@@ -40,50 +100,108 @@ void WeatherStation::readSensors() {
   hp20x_read();
   adjustMesurements();
   checkThresholds();
+
+  float values[WEATHER_FIELD_COUNT];
+  values[FIELD_TEMPERATURE] = MEASURE_TO_FLOAT(temperature);
+  values[FIELD_HUMIDITY] = MEASURE_TO_FLOAT(humidity);
+  values[FIELD_PRESSURE] = MEASURE_TO_FLOAT(pressure);
+  sampler.sampled(values, millis());
+  // A pending alert is confirmed over readings at the floor rate
+  if (alerts.isPending()) {
+    sampler.holdFloor();
+  }
+  for (uint8_t i = 0; i < WEATHER_FIELD_COUNT; i++) {
+    window[i].add(values[i]);
+  }
 }
 
 void WeatherStation::adjustMesurements() {
-  this->temperature = (this->dht_temperature +
-                       t_filter.Filter(this->hp20x_temperature / 100.0)) /
-                      2;
-  this->pressure = p_filter.Filter(this->hp20x_pressure / 100.0);
-  this->altitude = a_filter.Filter(this->altitude / 100.0);
+  this->temperature =
+      (this->dht_temperature +
+       t_filter.Filter(MEASURE_RATIO(this->hp20x_temperature, 100))) /
+      2;
+  this->pressure = p_filter.Filter(MEASURE_RATIO(this->hp20x_pressure, 100));
+  this->altitude = a_filter.Filter(MEASURE_RATIO(this->hp20x_altitude, 100));
 }
 
 void WeatherStation::checkThresholds() {
-  struct Alert {
-    float *value;
-    float threshold;
-    uint8_t alertType;
-    bool greaterThan;
-  };
-
-  Alert alerts[] = {
-      {&temperature, TEMP_THRESHOLD, TEMP_ALERT, true},
-      {&humidity, HUMI_THRESHOLD, HUMI_ALERT, true},
-      {&pressure, PRES_THRESHOLD, PRES_ALERT, false},
-  };
-
-  uint8_t alertCount = 0;
-
-  for (const auto &alert : alerts) {
-    if ((alert.greaterThan && *(alert.value) > alert.threshold) ||
-        (!alert.greaterThan && *(alert.value) < alert.threshold)) {
-      alertState = alert.alertType;
-      alertCount++;
+  AlertValue values[WEATHER_FIELD_COUNT];
+  values[FIELD_TEMPERATURE] = temperature;
+  values[FIELD_HUMIDITY] = humidity;
+  values[FIELD_PRESSURE] = pressure;
+
+  alertState = alerts.evaluate(values, millis());
+}
+
+uint8_t WeatherStation::buildSummary(uint8_t *payload) {
+  float current[WEATHER_FIELD_COUNT];
+  current[FIELD_TEMPERATURE] = MEASURE_TO_FLOAT(temperature);
+  current[FIELD_HUMIDITY] = MEASURE_TO_FLOAT(humidity);
+  current[FIELD_PRESSURE] = MEASURE_TO_FLOAT(pressure);
+
+  uint16_t count = window[FIELD_TEMPERATURE].getCount();
+  uint8_t length = 0;
+  payload[length++] = count >> 8;
+  payload[length++] = count & 0xFF;
+  for (uint8_t i = 0; i < WEATHER_FIELD_COUNT; i++) {
+    WindowStats &stats = window[i];
+    float scale = WEATHER_SUMMARY_SCALES[i];
+    if (stats.getCount() == 0) {
+      for (uint8_t j = 0; j < 3; j++) {
+        length += putScaled(payload + length, current[i], scale);
+      }
+      length += putScaled(payload + length, 0, scale);
+    } else {
+      length += putScaled(payload + length, stats.getMin(), scale);
+      length += putScaled(payload + length, stats.getMax(), scale);
+      length += putScaled(payload + length, stats.getMean(), scale);
+      length += putScaled(payload + length, stats.getStdDev(), scale);
     }
   }
+  payload[length++] = alertState;
+  return length;
+}
+
+void WeatherStation::resetWindow() {
+  for (uint8_t i = 0; i < WEATHER_FIELD_COUNT; i++) {
+    window[i].reset();
+  }
+}
+
+void WeatherStation::saveSnapshot(WeatherSnapshot &snapshot) {
+  MeasureFilter *filters[] = {&t_filter, &p_filter, &a_filter};
+  for (uint8_t i = 0; i < 3; i++) {
+    snapshot.filterEstimate[i] = MEASURE_TO_FLOAT(filters[i]->getEstimate());
+    snapshot.filterCovariance[i] =
+        MEASURE_TO_FLOAT(filters[i]->getCovariance());
+  }
+  snapshot.alertsRaised = alerts.getRaised();
+}
 
-  if (alertCount > 1) {
-    alertState = MULTIPLE_ALERT;
+void WeatherStation::restoreSnapshot(const WeatherSnapshot &snapshot) {
+  MeasureFilter *filters[] = {&t_filter, &p_filter, &a_filter};
+  for (uint8_t i = 0; i < 3; i++) {
+    filters[i]->setState(MEASURE(snapshot.filterEstimate[i]),
+                         MEASURE(snapshot.filterCovariance[i]));
   }
+  alerts.restoreRaised(snapshot.alertsRaised);
+  alertState = alerts.getAlertState();
 }
 
 void WeatherStation::printData() {
   Serial.println(F("\n===== WEATHER DATA ====="));
-  Serial.println("Temp: " + String(temperature) + "°C");
-  Serial.println("Pressure: " + String(pressure) + "hPa");
-  Serial.println("Humidity: " + String(humidity) + "%");
-  Serial.println("Altitude: " + String(altitude) + "m");
-  Serial.println("Alert State: " + String(alertState));
+  Serial.print(F("Temp: "));
+  Serial.print(MEASURE_TO_FLOAT(temperature));
+  Serial.println(F("°C"));
+  Serial.print(F("Pressure: "));
+  Serial.print(MEASURE_TO_FLOAT(pressure));
+  Serial.println(F("hPa"));
+  Serial.print(F("Humidity: "));
+  Serial.print(MEASURE_TO_FLOAT(humidity));
+  Serial.println(F("%"));
+  Serial.print(F("Altitude: "));
+  Serial.print(MEASURE_TO_FLOAT(altitude));
+  Serial.println(F("m"));
+  Serial.print(F("Alert State: "));
+  Serial.println(alertState);
 }
\ No newline at end of file
@@ -4,59 +4,168 @@
 #include <Arduino.h>
 
 #include <Adafruit_Sensor.h>
+#include <AdaptiveSampler.h>
+#include <AlertEngine.h>
 #include <DHT.h>
 #include <DHT_U.h>
 #include <HP20x_dev.h>
 #include <KalmanFilter.h>
+#include <OutlierFilter.h>
+#include <WindowStats.h>
 
 #define TEMP_THRESHOLD 30
 #define HUMI_THRESHOLD 70
 #define PRES_THRESHOLD 1000
 
+#define TEMP_HYSTERESIS 0.5
+#define HUMI_HYSTERESIS 2
+#define PRES_HYSTERESIS 1
+// ms, five readings at the default sampling floor, which is kept while an
+// alert is pending
+#define ALERT_HOLD_TIME 10000
+
+// Adaptive sampling: defaults of the floor and ceiling, and the change of
+// each measure worth a sample, above what the filters let through of the
+// sensors' noise
+#define SAMPLE_MIN_INTERVAL 2000  // ms, the loop period
+#define SAMPLE_MAX_INTERVAL 30000 // ms
+#define TEMP_SAMPLE_STEP 0.5      // °C
+#define HUMI_SAMPLE_STEP 5        // %, the DHT11 accuracy
+#define PRES_SAMPLE_STEP 0.5      // hPa
+
+// Summary frame: window sample count, then min, max, mean and standard
+// deviation of temperature (0.01 °C), humidity and pressure (0.1 % and 0.1
+// hPa), 2 bytes each, then the alert state
+#define WEATHER_SUMMARY_SIZE 27
+
+// Raw readings further from the median of the last OUTLIER_WINDOW than
+// OUTLIER_SCALE median absolute deviations, and than their floor, are replaced
+// by that median before the filters: DHT11 glitches, and HP206C short reads,
+// which come back as 0
+#define OUTLIER_WINDOW 5
+#define OUTLIER_SCALE 4         // MADs, about 2.7 standard deviations
+#define DHT_TEMP_OUTLIER 2      // °C
+#define DHT_HUMI_OUTLIER 10     // %
+#define HP20X_TEMP_OUTLIER 200  // 0.01 °C
+#define HP20X_PRES_OUTLIER 100  // 0.01 hPa
+#define HP20X_ALTI_OUTLIER 2000 // 0.01 m
+
 #define TEMP_ALERT 0x01
 #define HUMI_ALERT 0x02
-#define PRES_ALERT 0x03
-#define MULTIPLE_ALERT 0x06
+#define PRES_ALERT 0x04
+
+enum WeatherField : uint8_t {
+  FIELD_TEMPERATURE,
+  FIELD_HUMIDITY,
+  FIELD_PRESSURE,
+  WEATHER_FIELD_COUNT
+};
 
 #define DHTTYPE DHT11
 
+// Built with FIXED_POINT, the filtered measures stay in Q16.16 from the
+// sensor readings to the alert thresholds; floats remain at the DHT driver
+// and the payload
+#ifdef FIXED_POINT
+typedef Q16_16 Measure;
+typedef KalmanFilterFixed MeasureFilter;
+#define MEASURE(x) Q16_16::fromFloat(x)
+#define MEASURE_RATIO(num, den) Q16_16::ratio(num, den)
+#define MEASURE_TO_FLOAT(x) (x).toFloat()
+#else
+typedef float Measure;
+typedef KalmanFilter MeasureFilter;
+#define MEASURE(x) (x)
+#define MEASURE_RATIO(num, den) ((num) / (float)(den))
+#define MEASURE_TO_FLOAT(x) (x)
+#endif
+
+// Warm-restart state, in float whichever way the measures are built: the
+// temperature, pressure and altitude filters, then the alerts raised
+struct WeatherSnapshot {
+  float filterEstimate[3];
+  float filterCovariance[3];
+  uint8_t alertsRaised;
+};
+
 class WeatherStation {
 private:
   // DHT11 temperature and humidity sensor
   DHT dht;
 
   // I2C BAROMETER sensor
-  KalmanFilter t_filter; // temperature filter
-  KalmanFilter p_filter; // pressure filter
-  KalmanFilter a_filter; // altitude filter
+  MeasureFilter t_filter; // temperature filter
+  MeasureFilter p_filter; // pressure filter
+  MeasureFilter a_filter; // altitude filter
 
   HP20x_dev hp20x;
+  HampelFilter<float, OUTLIER_WINDOW> dhtTemperatureFilter;
+  HampelFilter<float, OUTLIER_WINDOW> dhtHumidityFilter;
+  HampelFilter<long, OUTLIER_WINDOW> hp20xTemperatureFilter;
+  HampelFilter<long, OUTLIER_WINDOW> hp20xPressureFilter;
+  HampelFilter<long, OUTLIER_WINDOW> hp20xAltitudeFilter;
+  uint16_t outlierCount; // raw readings replaced since boot
+
+  AlertEngine alerts;
+  AdaptiveSampler sampler;
+  // Filtered measures read since the last uplink, by WeatherField
+  WindowStats window[WEATHER_FIELD_COUNT];
   void dht_init();
   void hp20x_init();
   void dht_read();
   void hp20x_read();
   void checkThresholds();
+  template <typename T>
+  T rejectOutlier(HampelFilter<T, OUTLIER_WINDOW> &filter, T reading) {
+    T filtered = filter.filter(reading);
+    if (filtered != reading) {
+      outlierCount++;
+    }
+    return filtered;
+  }
 
-  float temperature;
-  float dht_temperature;
-  float hp20x_temperature;
-  float humidity;
-  float pressure;
-  float hp20x_pressure;
-  float altitude;
+  Measure temperature;
+  Measure dht_temperature;
+  Measure humidity;
+  Measure pressure;
+  Measure altitude;
+  // Raw HP20x readings, in hundredths
+  long hp20x_temperature;
+  long hp20x_pressure;
+  long hp20x_altitude;
   uint8_t alertState;
 
 public:
   WeatherStation(byte dht_pin);
   void init();
+  // Reads and filters all measures, whether or not the sampler says due
   void readSensors();
   void adjustMesurements();
+  // Replaces the compile-time alert threshold of a field
+  void setThreshold(WeatherField field, float threshold) {
+    alerts.setThreshold(field, ALERT_VALUE(threshold));
+  }
+
+  // Decides when loop() reads the sensors next
+  AdaptiveSampler &getSampler() { return sampler; }
+
+  // Fills payload with WEATHER_SUMMARY_SIZE bytes on the current window; an
+  // empty one reports the last measures, with a count of 0
+  uint8_t buildSummary(uint8_t *payload);
+  // Starts a new window, at each uplink
+  void resetWindow();
+
+  // The first reading after a restore starts from the saved estimates
+  // instead of converging from 0
+  void saveSnapshot(WeatherSnapshot &snapshot);
+  void restoreSnapshot(const WeatherSnapshot &snapshot);
 
-  float getTemperature() { return temperature; }
-  float getHumidity() { return humidity; }
-  float getPressure() { return pressure; }
-  float getAltitude() { return altitude; }
+  float getTemperature() { return MEASURE_TO_FLOAT(temperature); }
+  float getHumidity() { return MEASURE_TO_FLOAT(humidity); }
+  float getPressure() { return MEASURE_TO_FLOAT(pressure); }
+  float getAltitude() { return MEASURE_TO_FLOAT(altitude); }
   uint8_t getAlertState() { return alertState; }
+  uint16_t getOutlierCount() { return outlierCount; }
 
   void printData();
 };
@@ -0,0 +1,38 @@
+#include "WindowStats.h"
+
+void WindowStats::reset() {
+  count = 0;
+  mean = 0;
+  m2 = 0;
+  minimum = 0;
+  maximum = 0;
+}
+
+void WindowStats::add(float value) {
+  if (isnan(value)) {
+    return;
+  }
+
+  if (count == 0) {
+    minimum = maximum = value;
+  } else if (value < minimum) {
+    minimum = value;
+  } else if (value > maximum) {
+    maximum = value;
+  }
+  if (count == 0xFFFF) {
+    return;
+  }
+
+  count++;
+  float delta = value - mean;
+  mean += delta / count;
+  m2 += delta * (value - mean);
+}
+
+float WindowStats::getStdDev() {
+  if (count == 0) {
+    return NAN;
+  }
+  return sqrt(m2 / count);
+}
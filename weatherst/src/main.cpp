@@ -1,38 +1,227 @@
 #include <Arduino.h>
 
+#include <ConfigStore.h>
 #include <LoRaManager.h>
+#include <LoopProfiler.h>
+#include <MemoryMonitor.h>
+#include <PowerManager.h>
+#include <SnapshotStore.h>
 #include <WeatherStation.h>
 
 #define LORA_RX_PIN 10
 #define LORA_TX_PIN 11
 
+#define PROFILE_SAMPLE_RATE 1 // loop() is slow enough to time every pass
+// ms between diagnostic uplinks; memory and loop profile reports alternate
+#define DIAGNOSTIC_INTERVAL 1800000UL
+#define SNAPSHOT_INTERVAL 900000UL // ms between warm-restart snapshots
+
+// uno_lowpower: the modem sleeps between uplinks and the MCU is powered down
+// while it does, so the console is only read between two sleeps
+#ifdef LOW_POWER
+#define MODEM_SLEEP true
+#else
+#define MODEM_SLEEP false
+#endif
+
+#define SEND_INTERVAL 10000 // ms, default of send_interval
+#define SUMMARY_FRAMES 0    // default of summary: plain data frames
+
+// Site settings, kept in EEPROM and changed with "set <name> <value>"
+#define CONFIG_VERSION 3
+struct NodeConfig {
+  uint32_t sendInterval;      // ms
+  float tempThreshold;        // °C
+  float humiThreshold;        // %
+  float presThreshold;        // hPa
+  uint32_t sampleMinInterval; // ms
+  uint32_t sampleMaxInterval; // ms
+  uint8_t summaryFrames;      // 1 sends the window statistics instead
+};
+const NodeConfig DEFAULT_CONFIG PROGMEM = {
+    SEND_INTERVAL, TEMP_THRESHOLD, HUMI_THRESHOLD, PRES_THRESHOLD,
+    SAMPLE_MIN_INTERVAL, SAMPLE_MAX_INTERVAL, SUMMARY_FRAMES};
+const ConfigField CONFIG_FIELDS[] PROGMEM = {
+    {"send_interval", offsetof(NodeConfig, sendInterval), CONFIG_UINT32, 5000,
+     3600000},
+    {"temp_max", offsetof(NodeConfig, tempThreshold), CONFIG_FLOAT, -40, 80},
+    {"humi_max", offsetof(NodeConfig, humiThreshold), CONFIG_FLOAT, 0, 100},
+    {"pres_min", offsetof(NodeConfig, presThreshold), CONFIG_FLOAT, 300, 1100},
+    {"sample_min", offsetof(NodeConfig, sampleMinInterval), CONFIG_UINT32,
+     2000, 600000},
+    {"sample_max", offsetof(NodeConfig, sampleMaxInterval), CONFIG_UINT32,
+     2000, 3600000},
+    {"summary", offsetof(NodeConfig, summaryFrames), CONFIG_UINT8, 0, 1},
+};
+
+NodeConfig config;
+ConfigStore configStore(&config, sizeof(config), &DEFAULT_CONFIG,
+                        CONFIG_FIELDS,
+                        sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]),
+                        CONFIG_VERSION);
+
+// Filter and alert state, restored after a reset
+#define SNAPSHOT_VERSION 1
+WeatherSnapshot snapshot;
+SnapshotStore snapshotStore(&snapshot, sizeof(snapshot), SNAPSHOT_VERSION);
+
 unsigned long lastSendTime = 0;
-const unsigned long SEND_INTERVAL = 10000;
+unsigned long lastSnapshotTime = 0;
 
 LoRaManager loraManager(LORA_RX_PIN, LORA_TX_PIN);
 WeatherStation weatherStation(8);
+MemoryMonitor memoryMonitor;
+PowerManager powerManager;
+
+unsigned long lastDiagnosticTime = 0;
+uint8_t diagnosticCount = 0;
+
+#ifdef LOOP_PROFILER
+LoopProfiler loopProfiler;
+#endif
+
+// Hands the settings to the objects that keep their own copy
+void applyConfig() {
+  weatherStation.setThreshold(FIELD_TEMPERATURE, config.tempThreshold);
+  weatherStation.setThreshold(FIELD_HUMIDITY, config.humiThreshold);
+  weatherStation.setThreshold(FIELD_PRESSURE, config.presThreshold);
+  weatherStation.getSampler().configure(config.sampleMinInterval,
+                                        config.sampleMaxInterval);
+}
+
+void saveSnapshot() {
+  weatherStation.saveSnapshot(snapshot);
+  snapshotStore.save();
+  lastSnapshotTime = millis();
+}
+
+// "config" and "set" manage the site settings, "snapshot" saves the
+// warm-restart state now and "snapshot clear" forgets it, "mem" prints the
+// RAM watermarks and "power" the time spent asleep; with the profiler,
+// "profile" prints the loop histograms and "profile reset" clears them
+bool onConsoleCommand(const char *line) {
+  if (configStore.handleCommand(line)) {
+    applyConfig();
+    return true;
+  }
+  if (strncmp(line, "snapshot", 8) == 0) {
+    if (strncmp(line + 8, " clear", 6) == 0) {
+      snapshotStore.clear();
+      Serial.println(F("Snapshots cleared"));
+    } else {
+      saveSnapshot();
+    }
+    snapshotStore.dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "mem", 3) == 0) {
+    memoryMonitor.dump(Serial);
+    return true;
+  }
+  if (strncmp(line, "power", 5) == 0) {
+    powerManager.dump(Serial);
+    return true;
+  }
+#ifdef LOOP_PROFILER
+  if (strncmp(line, "profile", 7) == 0) {
+    if (strncmp(line + 7, " reset", 6) == 0) {
+      loopProfiler.reset();
+      Serial.println(F("Profile cleared"));
+    } else {
+      loopProfiler.dump(Serial);
+    }
+    return true;
+  }
+#endif
+  return false;
+}
+
+void sendDiagnostics() {
+  // Odd slots carry the loop profile, or nothing without the profiler, so
+  // memory reports are hourly either way
+  if (diagnosticCount++ % 2) {
+#ifdef LOOP_PROFILER
+    uint8_t payload[PROFILE_REPORT_MAX];
+    uint8_t length = loopProfiler.buildReport(payload, sizeof(payload));
+    loraManager.sendPayload(PROFILE_PORT, payload, length);
+    loopProfiler.reset();
+#endif
+    return;
+  }
+
+  uint8_t payload[MEMORY_REPORT_SIZE];
+  memoryMonitor.sample();
+  loraManager.sendPayload(MEMORY_PORT, payload,
+                          memoryMonitor.buildReport(payload));
+}
 
 void setup() {
   Serial.begin(9600);
+  configStore.begin();
+  applyConfig();
+  if (snapshotStore.begin()) {
+    weatherStation.restoreSnapshot(snapshot);
+  }
   weatherStation.init();
   Serial.println(F("Weather station starting"));
   loraManager.begin();
+  loraManager.setCommandHandler(onConsoleCommand);
+  loraManager.setModemSleep(MODEM_SLEEP);
+  powerManager.begin();
+#ifdef LOOP_PROFILER
+  loopProfiler.begin(PROFILE_SAMPLE_RATE);
+#endif
   Serial.println(F("Setup completed"));
 }
 
 void loop() {
-  loraManager.handleLoRaMessages();
-  loraManager.processSerialCommands();
-  weatherStation.readSensors();
-  unsigned long currentTime = millis();
-  if ((currentTime - lastSendTime >= SEND_INTERVAL) &&
-      loraManager.isNetworkJoined()) {
-    lastSendTime = currentTime;
-    loraManager.sendWeatherData(
-        weatherStation.getTemperature(), weatherStation.getPressure(),
-        weatherStation.getHumidity(), weatherStation.getAltitude(),
-        weatherStation.getAlertState());
-  }
-
-  delay(2000);
-}
\ No newline at end of file
+  {
+    // Timed without the sleep below
+    PROFILE_LOOP();
+    loraManager.handleLoRaMessages();
+    loraManager.processSerialCommands();
+    // At the sampler's pace; uplinks in between repeat the last measures
+    if (weatherStation.getSampler().isDue(millis())) {
+      weatherStation.readSensors();
+    }
+    unsigned long currentTime = millis();
+    memoryMonitor.update(currentTime);
+    if ((currentTime - lastSendTime >= config.sendInterval) &&
+        loraManager.isNetworkJoined()) {
+      PROFILE_EVENT(PROFILE_STAGE_UPLINK);
+      lastSendTime = currentTime;
+      Serial.print(F("Sample interval: "));
+      Serial.print(weatherStation.getSampler().getInterval());
+      Serial.print(F(" ms, duty "));
+      Serial.print(weatherStation.getSampler().getDutyRatio(currentTime) * 100);
+      Serial.print(F("%, outliers rejected: "));
+      Serial.println(weatherStation.getOutlierCount());
+      if (config.summaryFrames) {
+        uint8_t payload[WEATHER_SUMMARY_SIZE];
+        loraManager.sendPayload(SUMMARY_PORT, payload,
+                                weatherStation.buildSummary(payload));
+      } else {
+        loraManager.sendWeatherData(
+            weatherStation.getTemperature(), weatherStation.getPressure(),
+            weatherStation.getHumidity(), weatherStation.getAltitude(),
+            weatherStation.getAlertState());
+      }
+      weatherStation.resetWindow();
+    }
+
+    // Midway between two weather uplinks, so both fit the duty cycle
+    if (currentTime - lastDiagnosticTime >= DIAGNOSTIC_INTERVAL &&
+        currentTime - lastSendTime >= config.sendInterval / 2 &&
+        loraManager.isNetworkJoined()) {
+      lastDiagnosticTime = currentTime;
+      sendDiagnostics();
+    }
+
+    if (currentTime - lastSnapshotTime >= SNAPSHOT_INTERVAL) {
+      saveSnapshot();
+    }
+  }
+
+  // Powered down only while the modem sleeps, so none of its output is lost
+  powerManager.sleep(2000, loraManager.isModemAsleep());
+}
@@ -0,0 +1,164 @@
+#include <AdaptiveSampler.h>
+#include <ArduinoHost.h>
+#include <unity.h>
+
+#define MIN_INTERVAL 2000
+#define MAX_INTERVAL 30000
+
+static const float STEPS[] = {0.5, 5};
+static AdaptiveSampler sampler(STEPS, 2, MIN_INTERVAL, MAX_INTERVAL);
+
+static unsigned long now;
+
+// Takes a sample when the sampler asks for it
+static void sampleWhenDue(float first, float second) {
+  now += sampler.getTimeUntilDue(now);
+  TEST_ASSERT_TRUE(sampler.isDue(now));
+  const float values[] = {first, second};
+  sampler.sampled(values, now);
+}
+
+// Two equal samples: the rates are known and zero
+static void prime() {
+  sampleWhenDue(20, 50);
+  sampleWhenDue(20, 50);
+  TEST_ASSERT_EQUAL_UINT32(MAX_INTERVAL, sampler.getInterval());
+}
+
+void setUp() {
+  now = 0;
+  sampler.configure(MIN_INTERVAL, MAX_INTERVAL);
+  sampler.start(now);
+}
+
+void tearDown() {}
+
+void test_due_at_start() {
+  TEST_ASSERT_TRUE(sampler.isDue(now));
+  TEST_ASSERT_EQUAL_UINT32(0, sampler.getTimeUntilDue(now));
+  TEST_ASSERT_EQUAL_UINT32(MIN_INTERVAL, sampler.getInterval());
+}
+
+void test_priming_with_nan_channels() {
+  sampleWhenDue(NAN, 50);
+  TEST_ASSERT_EQUAL_UINT32(MIN_INTERVAL, sampler.getInterval());
+  // The first channel has no reference yet
+  sampleWhenDue(20, 50);
+  TEST_ASSERT_EQUAL_UINT32(MIN_INTERVAL, sampler.getInterval());
+  sampleWhenDue(20, NAN);
+  TEST_ASSERT_EQUAL_UINT32(MAX_INTERVAL, sampler.getInterval());
+  TEST_ASSERT_EQUAL_UINT32(3, sampler.getSampleCount());
+}
+
+void test_nan_keeps_a_channel_rate() {
+  prime();
+  // 3 steps of the first channel in 30 s: one step every 10 s
+  sampleWhenDue(21.5, 50);
+  TEST_ASSERT_UINT32_WITHIN(1, 10000, sampler.getInterval());
+  sampleWhenDue(NAN, NAN);
+  TEST_ASSERT_UINT32_WITHIN(1, 10000, sampler.getInterval());
+}
+
+void test_clamped_to_floor_and_ceiling() {
+  prime();
+  // Far faster than one step per floor interval
+  sampleWhenDue(40, 50);
+  TEST_ASSERT_EQUAL_UINT32(MIN_INTERVAL, sampler.getInterval());
+
+  sampler.start(now);
+  prime();
+  // A fraction of a step per ceiling
+  sampleWhenDue(20.2, 52);
+  TEST_ASSERT_EQUAL_UINT32(MAX_INTERVAL, sampler.getInterval());
+}
+
+void test_step_speeds_up_at_once_then_decays() {
+  prime();
+  // 15 steps of humidity within one ceiling: one step every 2 s
+  sampleWhenDue(20, 125);
+  TEST_ASSERT_UINT32_WITHIN(1, MIN_INTERVAL, sampler.getInterval());
+
+  // Steady again: the rate falls by SAMPLER_DECAY of itself per sample
+  float rate = 1.0 / MIN_INTERVAL;
+  uint8_t samples = 0;
+  while (sampler.getInterval() < MAX_INTERVAL) {
+    unsigned long previous = sampler.getInterval();
+    sampleWhenDue(20, 125);
+    rate -= rate * SAMPLER_DECAY;
+    unsigned long expected = 1 / rate;
+    if (expected > MAX_INTERVAL) {
+      expected = MAX_INTERVAL;
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, expected, sampler.getInterval());
+    TEST_ASSERT_GREATER_THAN(previous, sampler.getInterval());
+    samples++;
+  }
+  TEST_ASSERT_EQUAL(10, samples);
+
+  // A new step is followed on the next sample
+  sampleWhenDue(28, 125);
+  TEST_ASSERT_EQUAL_UINT32(MIN_INTERVAL, sampler.getInterval());
+}
+
+void test_hold_floor() {
+  prime();
+  sampler.holdFloor();
+  TEST_ASSERT_EQUAL_UINT32(MIN_INTERVAL, sampler.getTimeUntilDue(now));
+  // Only until the next sample
+  sampleWhenDue(20, 50);
+  TEST_ASSERT_EQUAL_UINT32(MAX_INTERVAL, sampler.getInterval());
+}
+
+void test_configure_max_below_min() {
+  sampler.configure(5000, 1000);
+  sampler.start(now);
+  sampleWhenDue(20, 50);
+  sampleWhenDue(20, 50);
+  TEST_ASSERT_EQUAL_UINT32(5000, sampler.getInterval());
+  sampleWhenDue(40, 50);
+  TEST_ASSERT_EQUAL_UINT32(5000, sampler.getInterval());
+}
+
+void test_duty_ratio() {
+  sampler.start(1000);
+  // Less than one floor interval: nothing to compare yet
+  TEST_ASSERT_EQUAL_FLOAT(1.0, sampler.getDutyRatio(1000));
+  TEST_ASSERT_EQUAL_FLOAT(1.0, sampler.getDutyRatio(1000 + MIN_INTERVAL - 1));
+  TEST_ASSERT_EQUAL_FLOAT(0.0, sampler.getDutyRatio(1000 + MIN_INTERVAL));
+
+  now = 1000;
+  prime();
+  // 2 samples over 16 floor intervals
+  TEST_ASSERT_EQUAL_FLOAT(2.0 / 16, sampler.getDutyRatio(1000 + 16 * 2000));
+}
+
+void test_duty_ratio_capped() {
+  const float values[] = {20, 50};
+  for (uint8_t i = 0; i < 5; i++) {
+    sampler.sampled(values, 100 * i);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(1.0, sampler.getDutyRatio(MIN_INTERVAL));
+}
+
+void test_due_across_millis_wrap() {
+  now = ~0UL - 1000;
+  sampler.start(now);
+  prime();
+  TEST_ASSERT_FALSE(sampler.isDue(now + MAX_INTERVAL - 1));
+  TEST_ASSERT_TRUE(sampler.isDue(now + MAX_INTERVAL));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_due_at_start);
+  RUN_TEST(test_priming_with_nan_channels);
+  RUN_TEST(test_nan_keeps_a_channel_rate);
+  RUN_TEST(test_clamped_to_floor_and_ceiling);
+  RUN_TEST(test_step_speeds_up_at_once_then_decays);
+  RUN_TEST(test_hold_floor);
+  RUN_TEST(test_configure_max_below_min);
+  RUN_TEST(test_duty_ratio);
+  RUN_TEST(test_duty_ratio_capped);
+  RUN_TEST(test_due_across_millis_wrap);
+  return UNITY_END();
+}
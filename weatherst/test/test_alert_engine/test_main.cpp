@@ -0,0 +1,158 @@
+#include <AlertEngine.h>
+#include <ArduinoHost.h>
+#include <unity.h>
+
+#define TEMP_FIELD 0
+#define PRES_FIELD 1
+
+#define TEMP_ALERT 0x01
+#define PRES_ALERT 0x04
+
+static const AlertRule RULES[] = {
+    {TEMP_FIELD, ALERT_ABOVE, ALERT_VALUE(30.0), ALERT_VALUE(0.5), 10000,
+     TEMP_ALERT},
+    {PRES_FIELD, ALERT_BELOW, ALERT_VALUE(1000.0), ALERT_VALUE(1.0), 10000,
+     PRES_ALERT},
+};
+
+static AlertEngine engine(RULES, 2);
+
+// Evaluates the same reading every second for `duration` ms from `start`
+static uint8_t hold(float temperature, float pressure, unsigned long start,
+                    unsigned long duration) {
+  AlertValue values[] = {ALERT_VALUE(temperature), ALERT_VALUE(pressure)};
+  uint8_t state = 0;
+  for (unsigned long t = start; t <= start + duration; t += 1000) {
+    state = engine.evaluate(values, t);
+  }
+  return state;
+}
+
+void setUp() { engine.reset(); }
+
+void tearDown() {}
+
+void test_raises_after_hold_time() {
+  TEST_ASSERT_EQUAL_HEX8(0, hold(31, 1013, 0, 9000));
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(31, 1013, 10000, 0));
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, engine.getAlertState());
+}
+
+void test_short_excursion_does_not_raise() {
+  hold(31, 1013, 0, 9000);
+  TEST_ASSERT_EQUAL_HEX8(0, hold(29, 1013, 10000, 0));
+  // The hold time starts over on the next excursion
+  TEST_ASSERT_EQUAL_HEX8(0, hold(31, 1013, 11000, 9000));
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(31, 1013, 21000, 0));
+}
+
+void test_hysteresis_band_keeps_alert() {
+  hold(31, 1013, 0, 10000);
+  // Back under the threshold but within the band
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(29.6, 1013, 11000, 60000));
+}
+
+void test_clears_after_hold_time_below_band() {
+  hold(31, 1013, 0, 10000);
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(29.4, 1013, 11000, 9000));
+  TEST_ASSERT_EQUAL_HEX8(0, hold(29.4, 1013, 21000, 0));
+}
+
+void test_pending_while_holding() {
+  TEST_ASSERT_FALSE(engine.isPending());
+  hold(31, 1013, 0, 9000);
+  TEST_ASSERT_TRUE(engine.isPending());
+  hold(31, 1013, 10000, 0);
+  TEST_ASSERT_FALSE(engine.isPending());
+  // Within the band nothing waits; below it the clear does
+  hold(29.6, 1013, 11000, 0);
+  TEST_ASSERT_FALSE(engine.isPending());
+  hold(29.4, 1013, 12000, 0);
+  TEST_ASSERT_TRUE(engine.isPending());
+}
+
+void test_short_recovery_does_not_clear() {
+  hold(31, 1013, 0, 10000);
+  hold(29, 1013, 11000, 5000);
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(31, 1013, 17000, 20000));
+}
+
+void test_below_rule() {
+  TEST_ASSERT_EQUAL_HEX8(PRES_ALERT, hold(20, 999, 0, 10000));
+  TEST_ASSERT_EQUAL_HEX8(PRES_ALERT, hold(20, 1000.5, 11000, 20000));
+  TEST_ASSERT_EQUAL_HEX8(0, hold(20, 1001.5, 32000, 10000));
+}
+
+void test_rules_combine_masks() {
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT | PRES_ALERT, hold(31, 990, 0, 10000));
+  TEST_ASSERT_EQUAL_HEX8(PRES_ALERT, hold(25, 990, 11000, 10000));
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.getRaised());
+}
+
+#ifndef FIXED_POINT
+void test_nan_never_raises() {
+  TEST_ASSERT_EQUAL_HEX8(0, hold(NAN, NAN, 0, 60000));
+}
+#endif
+
+void test_set_threshold_moves_band() {
+  engine.setThreshold(TEMP_FIELD, ALERT_VALUE(35.0));
+  TEST_ASSERT_EQUAL_HEX8(0, hold(31, 1013, 0, 20000));
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(36, 1013, 21000, 10000));
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, hold(34.6, 1013, 32000, 20000));
+  engine.setThreshold(TEMP_FIELD, ALERT_VALUE(30.0));
+}
+
+void test_restore_raised() {
+  engine.restoreRaised(0x03);
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT | PRES_ALERT, engine.getAlertState());
+  // Restored alerts clear like raised ones, after the hold time
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT | PRES_ALERT, hold(25, 1013, 0, 9000));
+  TEST_ASSERT_EQUAL_HEX8(0, hold(25, 1013, 10000, 0));
+}
+
+void test_hold_time_across_millis_wrap() {
+  AlertValue values[] = {ALERT_VALUE(31.0), ALERT_VALUE(1013.0)};
+  engine.evaluate(values, ~0UL - 4000);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.evaluate(values, 999));
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, engine.evaluate(values, 5999));
+}
+
+// Temperature climbing past the threshold, then hovering on it with
+// +-0.4 degC of noise: a plain comparison would flip on most readings, the
+// engine raises once and holds
+void test_noisy_trace_does_not_flap() {
+  static const float NOISE[] = {0.1, -0.3, 0.4, -0.2, 0.0, 0.3, -0.4, 0.2};
+  uint8_t last = 0;
+  int transitions = 0;
+  for (unsigned long t = 0; t < 3600000UL; t += 2000) {
+    float offset = t < 600000UL ? -1.0 : t < 1200000UL ? 0.6 : 0.0;
+    float temperature = 30.0 + offset + NOISE[(t / 2000) % 8];
+    AlertValue values[] = {ALERT_VALUE(temperature), ALERT_VALUE(1013.0)};
+    uint8_t state = engine.evaluate(values, t);
+    transitions += state != last;
+    last = state;
+  }
+  TEST_ASSERT_EQUAL(1, transitions);
+  TEST_ASSERT_EQUAL_HEX8(TEMP_ALERT, last);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_raises_after_hold_time);
+  RUN_TEST(test_short_excursion_does_not_raise);
+  RUN_TEST(test_hysteresis_band_keeps_alert);
+  RUN_TEST(test_clears_after_hold_time_below_band);
+  RUN_TEST(test_pending_while_holding);
+  RUN_TEST(test_short_recovery_does_not_clear);
+  RUN_TEST(test_below_rule);
+  RUN_TEST(test_rules_combine_masks);
+#ifndef FIXED_POINT
+  RUN_TEST(test_nan_never_raises);
+#endif
+  RUN_TEST(test_set_threshold_moves_band);
+  RUN_TEST(test_restore_raised);
+  RUN_TEST(test_hold_time_across_millis_wrap);
+  RUN_TEST(test_noisy_trace_does_not_flap);
+  return UNITY_END();
+}
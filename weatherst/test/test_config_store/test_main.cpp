@@ -0,0 +1,200 @@
+#include <ArduinoHost.h>
+#include <ConfigStore.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#define TEST_VERSION 4
+
+struct TestConfig {
+  uint32_t interval;
+  float threshold;
+  uint8_t flag;
+  uint16_t count;
+};
+
+static const TestConfig DEFAULTS PROGMEM = {10000, 35.0, 0, 12};
+
+static const ConfigField FIELDS[] PROGMEM = {
+    {"interval", offsetof(TestConfig, interval), CONFIG_UINT32, 5000, 3600000},
+    {"threshold", offsetof(TestConfig, threshold), CONFIG_FLOAT, -40, 80},
+    {"flag", offsetof(TestConfig, flag), CONFIG_UINT8, 0, 1},
+    {"count", offsetof(TestConfig, count), CONFIG_UINT16, 1, 1000},
+};
+
+#define FIELD_COUNT (sizeof(FIELDS) / sizeof(FIELDS[0]))
+// Header, struct and CRC
+#define BLOCK_SIZE (4 + sizeof(TestConfig) + 2)
+
+static TestConfig config;
+
+static ConfigStore makeStore(uint8_t version = TEST_VERSION) {
+  return ConfigStore(&config, sizeof(config), &DEFAULTS, FIELDS, FIELD_COUNT,
+                     version);
+}
+
+static bool isDefault() {
+  return memcmp(&config, &DEFAULTS, sizeof(config)) == 0;
+}
+
+// What the next boot finds in EEPROM
+static bool reload() {
+  memset(&config, 0, sizeof(config));
+  return makeStore().begin();
+}
+
+void setUp() {
+  ArduinoHost::reset();
+  ArduinoHost::setSerialOutput(false);
+  memset(EEPROM.cells, 0xFF, sizeof(EEPROM.cells));
+}
+
+void tearDown() {}
+
+void test_blank_eeprom_gets_defaults() {
+  TEST_ASSERT_FALSE(reload());
+  TEST_ASSERT_TRUE(isDefault());
+  // ...which are written back
+  TEST_ASSERT_TRUE(reload());
+  TEST_ASSERT_TRUE(isDefault());
+}
+
+void test_set_is_saved() {
+  ConfigStore store = makeStore();
+  store.begin();
+  TEST_ASSERT_TRUE(store.set("interval", "60000"));
+  TEST_ASSERT_TRUE(store.set("threshold", "-12.5"));
+  TEST_ASSERT_TRUE(store.set("flag", "1"));
+  TEST_ASSERT_TRUE(store.set("count", "1000\r\n"));
+
+  TEST_ASSERT_TRUE(reload());
+  TEST_ASSERT_EQUAL_UINT32(60000, config.interval);
+  TEST_ASSERT_EQUAL_FLOAT(-12.5, config.threshold);
+  TEST_ASSERT_EQUAL(1, config.flag);
+  TEST_ASSERT_EQUAL(1000, config.count);
+}
+
+void test_invalid_values_are_rejected() {
+  ConfigStore store = makeStore();
+  store.begin();
+  uint8_t before[HOST_EEPROM_SIZE];
+  memcpy(before, EEPROM.cells, sizeof(before));
+
+  TEST_ASSERT_FALSE(store.set("interval", "4999"));
+  TEST_ASSERT_FALSE(store.set("threshold", "80.5"));
+  TEST_ASSERT_FALSE(store.set("count", "0"));
+  TEST_ASSERT_FALSE(store.set("count", "12abc"));
+  TEST_ASSERT_FALSE(store.set("count", ""));
+  TEST_ASSERT_FALSE(store.set("counts", "5"));
+  TEST_ASSERT_TRUE(isDefault());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(before, EEPROM.cells, sizeof(before));
+}
+
+void test_console_commands() {
+  ConfigStore store = makeStore();
+  store.begin();
+  TEST_ASSERT_TRUE(store.handleCommand("set count 7"));
+  TEST_ASSERT_EQUAL(7, config.count);
+  // Rejected, but still a settings command
+  TEST_ASSERT_TRUE(store.handleCommand("set count 7000"));
+  TEST_ASSERT_TRUE(store.handleCommand("set count"));
+  TEST_ASSERT_EQUAL(7, config.count);
+  TEST_ASSERT_FALSE(store.handleCommand("snapshot"));
+
+  TEST_ASSERT_TRUE(store.handleCommand("config reset"));
+  TEST_ASSERT_TRUE(isDefault());
+  TEST_ASSERT_TRUE(reload());
+  TEST_ASSERT_TRUE(isDefault());
+}
+
+void test_other_layout_gets_defaults() {
+  ConfigStore store = makeStore();
+  store.begin();
+  store.set("count", "99");
+
+  memset(&config, 0, sizeof(config));
+  TEST_ASSERT_FALSE(makeStore(TEST_VERSION + 1).begin());
+  TEST_ASSERT_TRUE(isDefault());
+}
+
+// CRC-16 catches every single-bit error in the block
+void test_every_bit_flip_is_caught() {
+  ConfigStore store = makeStore();
+  store.begin();
+  store.set("threshold", "21.5");
+  uint8_t good[BLOCK_SIZE];
+  memcpy(good, &EEPROM.cells[CONFIG_ADDRESS], BLOCK_SIZE);
+
+  for (uint16_t bit = 0; bit < BLOCK_SIZE * 8; bit++) {
+    memcpy(&EEPROM.cells[CONFIG_ADDRESS], good, BLOCK_SIZE);
+    EEPROM.cells[CONFIG_ADDRESS + bit / 8] ^= 1 << (bit % 8);
+    TEST_ASSERT_FALSE(reload());
+    TEST_ASSERT_TRUE(isDefault());
+  }
+}
+
+// A reset after any number of the cells a save() changes were written: the
+// next boot gets either the old settings, the new ones or the defaults,
+// never a mix
+void test_torn_write() {
+  ConfigStore store = makeStore();
+  store.begin();
+  store.set("interval", "20000");
+  uint8_t before[HOST_EEPROM_SIZE];
+  memcpy(before, EEPROM.cells, sizeof(before));
+  TestConfig oldConfig = config;
+
+  store.set("count", "500");
+  uint8_t after[HOST_EEPROM_SIZE];
+  memcpy(after, EEPROM.cells, sizeof(after));
+  TestConfig newConfig = config;
+
+  // EEPROM.update() writes changed cells only, in address order
+  uint16_t changed[BLOCK_SIZE];
+  uint8_t changedCount = 0;
+  for (uint16_t i = 0; i < sizeof(after); i++) {
+    if (before[i] != after[i]) {
+      changed[changedCount++] = i;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(2, changedCount);
+
+  for (uint8_t written = 0; written <= changedCount; written++) {
+    memcpy(EEPROM.cells, before, sizeof(before));
+    for (uint8_t i = 0; i < written; i++) {
+      EEPROM.cells[changed[i]] = after[changed[i]];
+    }
+    bool valid = reload();
+    if (written == 0) {
+      TEST_ASSERT_TRUE(valid);
+      TEST_ASSERT_EQUAL_MEMORY(&oldConfig, &config, sizeof(config));
+    } else if (written == changedCount) {
+      TEST_ASSERT_TRUE(valid);
+      TEST_ASSERT_EQUAL_MEMORY(&newConfig, &config, sizeof(config));
+    } else {
+      TEST_ASSERT_FALSE(valid);
+      TEST_ASSERT_TRUE(isDefault());
+    }
+  }
+}
+
+void test_crc16_check_value() {
+  // CRC-16/CCITT-FALSE of "123456789"
+  uint16_t crc = 0xFFFF;
+  for (const char *c = "123456789"; *c; c++) {
+    crc = ConfigStore::crc16(crc, *c);
+  }
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_eeprom_gets_defaults);
+  RUN_TEST(test_set_is_saved);
+  RUN_TEST(test_invalid_values_are_rejected);
+  RUN_TEST(test_console_commands);
+  RUN_TEST(test_other_layout_gets_defaults);
+  RUN_TEST(test_every_bit_flip_is_caught);
+  RUN_TEST(test_torn_write);
+  RUN_TEST(test_crc16_check_value);
+  return UNITY_END();
+}
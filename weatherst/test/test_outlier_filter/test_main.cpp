@@ -0,0 +1,244 @@
+#include <ArduinoHost.h>
+#include <FixedPoint.h>
+#include <OutlierFilter.h>
+#include <algorithm>
+#include <unity.h>
+
+static uint32_t noiseState;
+
+static uint16_t nextRandom() {
+  noiseState = noiseState * 1103515245UL + 12345;
+  return noiseState >> 16;
+}
+
+// Uniform in [-1, 1)
+static float noise() { return nextRandom() / 32768.0 - 1; }
+
+// Brute-force references over the last `count` values of a stream
+
+template <typename T> static T lowerMedian(T *values, uint8_t count) {
+  std::sort(values, values + count);
+  return values[(count - 1) / 2];
+}
+
+template <typename T>
+static bool referenceOutlier(const T *history, uint8_t count, T value,
+                             T scale, T minDeviation) {
+  if (count < 3) {
+    return false;
+  }
+  T window[127];
+  std::copy(history, history + count, window);
+  T center = lowerMedian(window, count);
+  for (uint8_t i = 0; i < count; i++) {
+    window[i] = history[i] > center ? history[i] - center : center - history[i];
+  }
+  T mad = lowerMedian(window, count);
+  T deviation = value > center ? value - center : center - value;
+  return deviation > minDeviation && deviation > (T)(mad * scale);
+}
+
+#define STREAM_LENGTH 2000
+
+void setUp() { noiseState = 1; }
+
+void tearDown() {}
+
+template <uint8_t N> static void checkSortedWindow() {
+  SortedWindow<long, N> window;
+  long stream[STREAM_LENGTH];
+  for (uint16_t i = 0; i < STREAM_LENGTH; i++) {
+    // Few distinct values, so ties and equal ages are exercised
+    stream[i] = nextRandom() % 20;
+    window.add(stream[i]);
+
+    uint8_t count = i + 1 < N ? i + 1 : N;
+    long expected[N];
+    std::copy(stream + i + 1 - count, stream + i + 1, expected);
+    std::sort(expected, expected + count);
+    TEST_ASSERT_EQUAL(count, window.getCount());
+    for (uint8_t rank = 0; rank < count; rank++) {
+      TEST_ASSERT_EQUAL_INT32(expected[rank], window.get(rank));
+    }
+  }
+}
+
+void test_sorted_window_keeps_last_values() {
+  checkSortedWindow<3>();
+  checkSortedWindow<5>();
+  checkSortedWindow<15>();
+  checkSortedWindow<127>();
+}
+
+void test_running_median() {
+  RunningMedian<uint16_t, 7> median;
+  uint16_t stream[STREAM_LENGTH];
+  for (uint16_t i = 0; i < STREAM_LENGTH; i++) {
+    stream[i] = nextRandom() % 1000;
+    uint16_t filtered = median.filter(stream[i]);
+
+    uint8_t count = i + 1 < 7 ? i + 1 : 7;
+    uint16_t window[7];
+    std::copy(stream + i + 1 - count, stream + i + 1, window);
+    TEST_ASSERT_EQUAL_UINT16(lowerMedian(window, count), filtered);
+  }
+}
+
+void test_running_median_drops_spike_runs() {
+  RunningMedian<float, 5> median;
+  for (uint8_t i = 0; i < 5; i++) {
+    median.filter(20);
+  }
+  // (N - 1) / 2 spikes in a row never get through
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(85));
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(-8));
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(20));
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(20));
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(20));
+  // A step shows after three readings
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(25));
+  TEST_ASSERT_EQUAL_FLOAT(20, median.filter(25));
+  TEST_ASSERT_EQUAL_FLOAT(25, median.filter(25));
+}
+
+void test_trimmed_mean() {
+  TrimmedMean<float, 15, 3> trimmed;
+  float stream[STREAM_LENGTH];
+  for (uint16_t i = 0; i < STREAM_LENGTH; i++) {
+    stream[i] = 150 + 2 * noise() + (i % 11 == 0 ? 40 : 0);
+    float filtered = trimmed.filter(stream[i]);
+
+    uint8_t count = i + 1 < 15 ? i + 1 : 15;
+    uint8_t trim = 6 < count ? 3 : (count - 1) / 2;
+    float window[15];
+    std::copy(stream + i + 1 - count, stream + i + 1, window);
+    std::sort(window, window + count);
+    double sum = 0;
+    for (uint8_t j = trim; j < count - trim; j++) {
+      sum += window[j];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, sum / (count - 2 * trim), filtered);
+  }
+}
+
+// The O(N) MAD merge decides as a full sort of the deviations would
+template <typename T, uint8_t N>
+static void checkHampelDecisions(T scale, T minDeviation, long spread) {
+  HampelFilter<T, N> hampel(scale, minDeviation);
+  T stream[STREAM_LENGTH];
+  uint16_t outliers = 0;
+  for (uint16_t i = 0; i < STREAM_LENGTH; i++) {
+    stream[i] = (T)(long)(nextRandom() % spread);
+    if (i % 13 == 0) {
+      stream[i] = (T)(long)(spread * 10);
+    }
+    hampel.add(stream[i]);
+
+    uint8_t count = i + 1 < N ? i + 1 : N;
+    bool expected = referenceOutlier(stream + i + 1 - count, count, stream[i],
+                                     scale, minDeviation);
+    TEST_ASSERT_EQUAL(expected, hampel.isOutlier(stream[i]));
+    outliers += expected;
+  }
+  TEST_ASSERT_GREATER_THAN(STREAM_LENGTH / 20, outliers);
+}
+
+void test_hampel_matches_reference() {
+  checkHampelDecisions<long, 5>(4, 2, 10);
+  checkHampelDecisions<long, 15>(3, 0, 50);
+  checkHampelDecisions<float, 5>(4.45, 0.5, 20);
+  checkHampelDecisions<float, 8>(4, 1, 20);
+}
+
+// Glitches injected into a clean signal, as in the weather node's readings:
+// every isolated spike is replaced, and no clean reading is touched
+void test_hampel_removes_injected_spikes() {
+  HampelFilter<float, 5> hampel(4, 1.0);
+  uint16_t spikes = 0;
+  uint16_t replaced = 0;
+  for (uint16_t i = 0; i < STREAM_LENGTH; i++) {
+    float clean = 22 + 8 * sin(i / 300.0) + 0.3 * noise();
+    bool spike = i > 5 && nextRandom() % 50 == 0;
+    float reading = spike ? (nextRandom() % 2 ? 85.0 : -8.0) : clean;
+    float filtered = hampel.filter(reading);
+
+    spikes += spike;
+    if (filtered != reading) {
+      replaced++;
+      TEST_ASSERT_TRUE(spike);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0, clean, filtered);
+  }
+  TEST_ASSERT_GREATER_THAN(20, spikes);
+  TEST_ASSERT_EQUAL(spikes, replaced);
+}
+
+void test_hampel_passes_a_lasting_step() {
+  HampelFilter<float, 5> hampel(4, 0.5);
+  for (uint8_t i = 0; i < 5; i++) {
+    hampel.filter(1013.0);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(1013.0, hampel.filter(1020.0));
+  TEST_ASSERT_EQUAL_FLOAT(1013.0, hampel.filter(1020.0));
+  // Half the window now
+  TEST_ASSERT_EQUAL_FLOAT(1020.0, hampel.filter(1020.0));
+}
+
+void test_hampel_floor_on_equal_readings() {
+  HampelFilter<uint16_t, 5> hampel(4, 2);
+  for (uint8_t i = 0; i < 5; i++) {
+    hampel.filter(55);
+  }
+  // MAD 0: the floor lets small changes through, a spike is still replaced
+  TEST_ASSERT_EQUAL_UINT16(56, hampel.filter(56));
+  TEST_ASSERT_EQUAL_UINT16(57, hampel.filter(57));
+  TEST_ASSERT_EQUAL_UINT16(56, hampel.filter(90));
+}
+
+// A burst of HM330X frames judged as a batch: the spike is caught wherever
+// it lies, even first
+void test_hampel_batch() {
+  HampelFilter<uint16_t, 5> burst(4, 10);
+  const uint16_t frames[5] = {400, 12, 13, 12, 14};
+  for (uint16_t frame : frames) {
+    burst.add(frame);
+  }
+  for (uint8_t i = 0; i < 5; i++) {
+    TEST_ASSERT_EQUAL(i == 0, burst.isOutlier(frames[i]));
+  }
+  TEST_ASSERT_EQUAL_UINT16(13, burst.median());
+}
+
+void test_hampel_fixed_point() {
+  HampelFilter<Q16_16, 5> hampel(Q16_16::fromInt(4), Q16_16::fromFloat(0.5));
+  HampelFilter<float, 5> reference(4, 0.5);
+  for (uint16_t i = 0; i < STREAM_LENGTH; i++) {
+    float reading = 1013.25 + noise() + (i % 17 == 0 ? 30 : 0);
+    float fixed = hampel.filter(Q16_16::fromFloat(reading)).toFloat();
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, reference.filter(reading), fixed);
+  }
+}
+
+void test_fewer_than_three_values_pass() {
+  HampelFilter<float, 5> hampel(4, 0.5);
+  TEST_ASSERT_EQUAL_FLOAT(10, hampel.filter(10));
+  TEST_ASSERT_EQUAL_FLOAT(500, hampel.filter(500));
+  RunningMedian<float, 5> median;
+  TEST_ASSERT_EQUAL_FLOAT(0, median.median());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_sorted_window_keeps_last_values);
+  RUN_TEST(test_running_median);
+  RUN_TEST(test_running_median_drops_spike_runs);
+  RUN_TEST(test_trimmed_mean);
+  RUN_TEST(test_hampel_matches_reference);
+  RUN_TEST(test_hampel_removes_injected_spikes);
+  RUN_TEST(test_hampel_passes_a_lasting_step);
+  RUN_TEST(test_hampel_floor_on_equal_readings);
+  RUN_TEST(test_hampel_batch);
+  RUN_TEST(test_hampel_fixed_point);
+  RUN_TEST(test_fewer_than_three_values_pass);
+  return UNITY_END();
+}
@@ -0,0 +1,153 @@
+#include <ArduinoHost.h>
+#include <EEPROM.h>
+#include <SnapshotStore.h>
+#include <unity.h>
+
+#define TEST_VERSION 2
+
+struct TestState {
+  uint32_t saves; // which save() wrote it
+  float estimate;
+};
+
+// Header, struct and CRC
+#define SLOT_SIZE (6 + sizeof(TestState) + 2)
+#define SLOT_COUNT ((HOST_EEPROM_SIZE - SNAPSHOT_ADDRESS) / SLOT_SIZE)
+
+static TestState state;
+static SnapshotStore store(&state, sizeof(state), TEST_VERSION);
+static uint32_t saveCount;
+
+static void save() {
+  state.saves = ++saveCount;
+  state.estimate = saveCount * 0.5;
+  store.save();
+}
+
+// What the next boot finds in EEPROM
+static bool reload() {
+  memset(&state, 0, sizeof(state));
+  store = SnapshotStore(&state, sizeof(state), TEST_VERSION);
+  return store.begin();
+}
+
+void setUp() {
+  ArduinoHost::reset();
+  ArduinoHost::setSerialOutput(false);
+  memset(EEPROM.cells, 0xFF, sizeof(EEPROM.cells));
+  saveCount = 0;
+  reload();
+}
+
+void tearDown() {}
+
+void test_cold_start_leaves_state() {
+  state.saves = 42;
+  SnapshotStore cold(&state, sizeof(state), TEST_VERSION);
+  TEST_ASSERT_FALSE(cold.begin());
+  TEST_ASSERT_EQUAL_UINT32(42, state.saves);
+}
+
+void test_newest_snapshot_is_loaded() {
+  save();
+  save();
+  save();
+  TEST_ASSERT_TRUE(reload());
+  TEST_ASSERT_EQUAL_UINT32(3, state.saves);
+  TEST_ASSERT_EQUAL_FLOAT(1.5, state.estimate);
+
+  // Saving after a restart carries on from there
+  saveCount = state.saves;
+  save();
+  TEST_ASSERT_TRUE(reload());
+  TEST_ASSERT_EQUAL_UINT32(4, state.saves);
+}
+
+void test_slots_rotate() {
+  for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+    save();
+  }
+  // Every slot has been written once
+  for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+    uint16_t magic;
+    EEPROM.get(SNAPSHOT_ADDRESS + slot * SLOT_SIZE, magic);
+    TEST_ASSERT_EQUAL_HEX16(SNAPSHOT_MAGIC, magic);
+  }
+  save();
+  TEST_ASSERT_TRUE(reload());
+  TEST_ASSERT_EQUAL_UINT32(SLOT_COUNT + 1, state.saves);
+}
+
+void test_other_version_is_ignored() {
+  save();
+  memset(&state, 0, sizeof(state));
+  SnapshotStore other(&state, sizeof(state), TEST_VERSION + 1);
+  TEST_ASSERT_FALSE(other.begin());
+}
+
+void test_clear_starts_cold() {
+  save();
+  save();
+  store.clear();
+  TEST_ASSERT_FALSE(reload());
+}
+
+// A reset after any number of the cells a save() changes were written: the
+// next boot gets the previous snapshot until the new one is complete
+void test_torn_write() {
+  for (uint8_t i = 0; i < SLOT_COUNT + 3; i++) {
+    save();
+  }
+  uint8_t before[HOST_EEPROM_SIZE];
+  memcpy(before, EEPROM.cells, sizeof(before));
+  save();
+  uint8_t after[HOST_EEPROM_SIZE];
+  memcpy(after, EEPROM.cells, sizeof(after));
+
+  uint16_t changed[SLOT_SIZE];
+  uint8_t changedCount = 0;
+  for (uint16_t i = 0; i < sizeof(after); i++) {
+    if (before[i] != after[i]) {
+      changed[changedCount++] = i;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(2, changedCount);
+
+  for (uint8_t written = 0; written <= changedCount; written++) {
+    memcpy(EEPROM.cells, before, sizeof(before));
+    for (uint8_t i = 0; i < written; i++) {
+      EEPROM.cells[changed[i]] = after[changed[i]];
+    }
+    TEST_ASSERT_TRUE(reload());
+    TEST_ASSERT_EQUAL_UINT32(written == changedCount ? saveCount
+                                                     : saveCount - 1,
+                             state.saves);
+    TEST_ASSERT_EQUAL_FLOAT(state.saves * 0.5, state.estimate);
+  }
+}
+
+// The 16-bit sequence number wraps after 65535 snapshots; the newest must
+// still win over the slots written just before the wrap
+void test_sequence_wrap() {
+  while (saveCount < 0xFFFF - SLOT_COUNT) {
+    save();
+  }
+  for (uint16_t i = 0; i < 2 * SLOT_COUNT; i++) {
+    save();
+    TEST_ASSERT_TRUE(reload());
+    TEST_ASSERT_EQUAL_UINT32(saveCount, state.saves);
+  }
+  TEST_ASSERT_GREATER_THAN(0x10000UL, saveCount);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_start_leaves_state);
+  RUN_TEST(test_newest_snapshot_is_loaded);
+  RUN_TEST(test_slots_rotate);
+  RUN_TEST(test_other_version_is_ignored);
+  RUN_TEST(test_clear_starts_cold);
+  RUN_TEST(test_torn_write);
+  RUN_TEST(test_sequence_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include <ArduinoHost.h>
+#include <WindowStats.h>
+#include <unity.h>
+
+static WindowStats stats;
+
+static uint32_t noiseState;
+
+// Uniform in [-1, 1)
+static double noise() {
+  noiseState = noiseState * 1103515245UL + 12345;
+  return ((noiseState >> 8) & 0xFFFF) / 32768.0 - 1;
+}
+
+// Two-pass reference in double over the values as float, as add() gets them
+static void checkAgainstTwoPass(const float *values, uint16_t count) {
+  double sum = 0;
+  double minimum = values[0];
+  double maximum = values[0];
+  for (uint16_t i = 0; i < count; i++) {
+    sum += values[i];
+    minimum = values[i] < minimum ? values[i] : minimum;
+    maximum = values[i] > maximum ? values[i] : maximum;
+  }
+  double mean = sum / count;
+  double squares = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    squares += (values[i] - mean) * (values[i] - mean);
+  }
+  double stdDev = sqrt(squares / count);
+
+  TEST_ASSERT_EQUAL(count, stats.getCount());
+  TEST_ASSERT_EQUAL_FLOAT(minimum, stats.getMin());
+  TEST_ASSERT_EQUAL_FLOAT(maximum, stats.getMax());
+  TEST_ASSERT_FLOAT_WITHIN(fabs(mean) * 1e-6, mean, stats.getMean());
+  TEST_ASSERT_FLOAT_WITHIN(stdDev * 1e-3 + 1e-6, stdDev, stats.getStdDev());
+}
+
+#define SERIES_LENGTH 1800
+
+static float series[SERIES_LENGTH];
+
+void setUp() {
+  stats.reset();
+  noiseState = 1;
+}
+
+void tearDown() {}
+
+void test_empty_window() {
+  TEST_ASSERT_EQUAL(0, stats.getCount());
+  TEST_ASSERT_TRUE(isnan(stats.getMin()));
+  TEST_ASSERT_TRUE(isnan(stats.getMax()));
+  TEST_ASSERT_TRUE(isnan(stats.getMean()));
+  TEST_ASSERT_TRUE(isnan(stats.getStdDev()));
+}
+
+void test_single_value() {
+  stats.add(-3.5);
+  TEST_ASSERT_EQUAL_FLOAT(-3.5, stats.getMin());
+  TEST_ASSERT_EQUAL_FLOAT(-3.5, stats.getMax());
+  TEST_ASSERT_EQUAL_FLOAT(-3.5, stats.getMean());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.getStdDev());
+}
+
+void test_constant_values_have_no_spread() {
+  for (uint16_t i = 0; i < 1000; i++) {
+    stats.add(1013.25);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(1013.25, stats.getMean());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.getStdDev());
+}
+
+void test_temperature_day() {
+  for (uint16_t i = 0; i < SERIES_LENGTH; i++) {
+    series[i] = 22 + 8 * sin(i / 300.0) + 0.3 * noise();
+    stats.add(series[i]);
+  }
+  checkAgainstTwoPass(series, SERIES_LENGTH);
+}
+
+// A large mean with a small spread, where a float sum of squares would lose
+// the spread to cancellation
+void test_pressure_far_from_zero() {
+  for (uint16_t i = 0; i < SERIES_LENGTH; i++) {
+    series[i] = 1013.25 + 0.05 * noise();
+    stats.add(series[i]);
+  }
+  checkAgainstTwoPass(series, SERIES_LENGTH);
+}
+
+void test_particle_spikes() {
+  for (uint16_t i = 0; i < 200; i++) {
+    series[i] = i % 37 == 0 ? 400 : 12 + 2 * noise();
+    stats.add(series[i]);
+  }
+  checkAgainstTwoPass(series, 200);
+}
+
+void test_nan_is_ignored() {
+  stats.add(NAN);
+  TEST_ASSERT_EQUAL(0, stats.getCount());
+  stats.add(1);
+  stats.add(NAN);
+  stats.add(3);
+  TEST_ASSERT_EQUAL(2, stats.getCount());
+  TEST_ASSERT_EQUAL_FLOAT(2, stats.getMean());
+  TEST_ASSERT_EQUAL_FLOAT(1, stats.getStdDev());
+}
+
+void test_reset_starts_a_new_window() {
+  stats.add(100);
+  stats.add(-100);
+  stats.reset();
+  stats.add(5);
+  TEST_ASSERT_EQUAL(1, stats.getCount());
+  TEST_ASSERT_EQUAL_FLOAT(5, stats.getMin());
+  TEST_ASSERT_EQUAL_FLOAT(5, stats.getMax());
+}
+
+void test_extremes_move_past_count_limit() {
+  for (uint32_t i = 0; i < 0xFFFF; i++) {
+    stats.add(10);
+  }
+  stats.add(50);
+  stats.add(-20);
+  TEST_ASSERT_EQUAL(0xFFFF, stats.getCount());
+  TEST_ASSERT_EQUAL_FLOAT(10, stats.getMean());
+  TEST_ASSERT_EQUAL_FLOAT(-20, stats.getMin());
+  TEST_ASSERT_EQUAL_FLOAT(50, stats.getMax());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_window);
+  RUN_TEST(test_single_value);
+  RUN_TEST(test_constant_values_have_no_spread);
+  RUN_TEST(test_temperature_day);
+  RUN_TEST(test_pressure_far_from_zero);
+  RUN_TEST(test_particle_spikes);
+  RUN_TEST(test_nan_is_ignored);
+  RUN_TEST(test_reset_starts_a_new_window);
+  RUN_TEST(test_extremes_move_past_count_limit);
+  return UNITY_END();
+}